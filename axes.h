@@ -0,0 +1,177 @@
+#ifndef AXES_H_
+#define AXES_H_
+
+#include <stddef.h> // size_t
+#include <stdint.h> // int64_t, uint64_t
+#include <stdbool.h>
+#include <stdio.h> // snprintf
+#include <math.h> // floor, log10, fabs
+
+#include <raylib.h> // Font
+
+#include "precision.h"
+#include "text.h"
+
+/*
+  grid lines and their labels for one axis of the viewport.
+  the major step is 1, 2 or 5 times a power of ten, the smallest that leaves `min_px`
+  between labelled lines, with 5 minor steps to it (4 for a step of 2). minor line `k` is at
+  `k * units * 10^(exponent - 1)`, a whole number of tenths of the decade. far from 0 `k` does
+  not fit a double, so the lines in view are numbered from a whole double-double `base`, the
+  major line at or below the low edge: line `i` is `base + i`. the offset of `base` from the
+  centre is taken once in double-double, the lines step from it in plain doubles, and the
+  label is written from the whole `k`, never from a rounded double.
+  a label only depends on its value and the decade, so the formatted strings and their
+  glyph runs stay cached while zooming within a decade, and panning formats the few that
+  scroll in
+ */
+
+#define AXIS_X_PX 100 // between labelled lines, the labels are side by side
+#define AXIS_Y_PX 60
+#define AXIS_MAX_INDEX 0x1p104 // minor lines from 0, further out `base` is not whole in double-double: no grid
+#define AXIS_FIXED_MIN -4 // steps from 10^-4 and values up to 10^6 are written without an exponent,
+#define AXIS_FIXED_MAX 6 // and so are values from 0.1 with up to `AXIS_FIXED_DIGITS` decimals
+#define AXIS_FIXED_DIGITS 10
+#define AXIS_LABEL_MAX 48 // 32 digits, a sign, a point and an exponent
+#define AXIS_LABELS 128 // cached per axis, power of 2
+
+typedef __int128 AxisIndex; // minor lines from 0, whole double-doubles convert exactly
+
+typedef struct {
+    double span, pixels;
+    int mantissa, exponent; // major step: mantissa * 10^exponent
+    int units, minors; // minor step in `unit`s (10^(exponent - 1)), minor steps per major one
+    AxisIndex base; // a major line
+    double origin, step; // of `base` from the centre, between minor lines
+    int64_t first, last; // minor lines in view from `base`, none if `first > last`
+} AxisTicks;
+
+typedef struct {
+    AxisIndex n; // the value is n * 10^exponent
+    bool used;
+    uint64_t generation; // of the text cache `run` is from
+    TextRun * run;
+    size_t len;
+    char str[AXIS_LABEL_MAX];
+} AxisLabel;
+
+typedef struct {
+    int exponent; // of the decade the labels are for
+    AxisLabel slots[AXIS_LABELS];
+    size_t formatted, hits; // over the run
+} AxisLabels;
+
+AxisTicks axis_ticks(ddouble centre, double span, double pixels, double min_px);
+bool axis_major(const AxisTicks * t, int64_t i);
+double axis_pixel(const AxisTicks * t, int64_t i); // from the low edge
+TextRun * axis_label(AxisLabels * labels, const AxisTicks * t, int64_t i, Font font, int size); // major lines only, NULL for 0
+
+AxisTicks axis_ticks(ddouble centre, double span, double pixels, double min_px) {
+    AxisTicks t = {.span = span, .pixels = pixels, .first = 1, .last = 0};
+    if (!(span > 0) || !(pixels > 0) || !isfinite(centre.hi)) return t;
+    double raw = span * min_px / pixels;
+    int e = (int)floor(log10(raw));
+    double f = raw / pow(10, e);
+    if (f > 5) f = 1, e += 1;
+    t.mantissa = f <= 1 ? 1 : f <= 2 ? 2 : 5;
+    t.exponent = e;
+    t.units = t.mantissa == 1 ? 2 : t.mantissa == 2 ? 5 : 10;
+    t.minors = t.mantissa * 10 / t.units;
+    ddouble minor = dd_mul_d(dd_powi(dd_from(10), e - 1), t.units);
+    ddouble first = dd_ceil(dd_div(dd_sub(centre, dd_from(span * 0.5)), minor));
+    ddouble last = dd_floor(dd_div(dd_add(centre, dd_from(span * 0.5)), minor));
+    if (!(fabs(first.hi) < AXIS_MAX_INDEX && fabs(last.hi) < AXIS_MAX_INDEX)) return t;
+    AxisIndex k0 = (AxisIndex)first.hi + (AxisIndex)first.lo;
+    AxisIndex k1 = (AxisIndex)last.hi + (AxisIndex)last.lo;
+    t.base = k0 - ((k0 % t.minors) + t.minors) % t.minors; // rounded down to a major line
+    double hi = (double)t.base;
+    ddouble base = {hi, (double)(t.base - (AxisIndex)hi)};
+    t.origin = dd_to_double(dd_sub(dd_mul(base, minor), centre));
+    t.step = dd_to_double(minor);
+    t.first = (int64_t)(k0 - t.base);
+    t.last = (int64_t)(k1 - t.base);
+    return t;
+}
+
+bool axis_major(const AxisTicks * t, int64_t i) {
+    return i % t->minors == 0;
+}
+
+double axis_pixel(const AxisTicks * t, int64_t i) {
+    return t->pixels * 0.5 + (t->origin + i * t->step) / t->span * t->pixels;
+}
+
+static size_t axis_append(char * out, size_t at, const char * s, size_t n) {
+    for (size_t k = 0; k < n && at + 1 < AXIS_LABEL_MAX; ++k) out[at++] = s[k];
+    out[at] = 0;
+    return at;
+}
+
+// n * 10^e: fixed point with -e decimals, all labels of a step alike, or else a mantissa
+// without trailing zeros and an exponent
+static size_t axis_format(char * out, AxisIndex n, int e) {
+    char digits[40];
+    unsigned __int128 u = n < 0 ? -(unsigned __int128)n : (unsigned __int128)n;
+    int nd = 0;
+    do { // printf has no 128 bit conversion, reversed below
+        digits[nd++] = '0' + (int)(u % 10);
+        u /= 10;
+    } while (u);
+    for (int k = 0; k < nd / 2; ++k) {
+        char c = digits[k];
+        digits[k] = digits[nd - 1 - k];
+        digits[nd - 1 - k] = c;
+    }
+    int lead = e + nd - 1; // decade of the leading digit
+    size_t at = axis_append(out, 0, "-", n < 0);
+    if (lead < AXIS_FIXED_MAX && (e >= AXIS_FIXED_MIN || (lead >= -1 && -e <= AXIS_FIXED_DIGITS))) {
+        if (e >= 0) {
+            at = axis_append(out, at, digits, nd);
+            for (int k = 0; k < e; ++k) at = axis_append(out, at, "0", 1);
+        } else if (nd > -e) {
+            at = axis_append(out, at, digits, nd + e);
+            at = axis_append(out, at, ".", 1);
+            at = axis_append(out, at, digits + nd + e, -e);
+        } else {
+            at = axis_append(out, at, "0.", 2);
+            for (int k = nd; k < -e; ++k) at = axis_append(out, at, "0", 1);
+            at = axis_append(out, at, digits, nd);
+        }
+        return at;
+    }
+    int sig = nd;
+    while (sig > 1 && digits[sig - 1] == '0') sig -= 1;
+    at = axis_append(out, at, digits, 1);
+    if (sig > 1) {
+        at = axis_append(out, at, ".", 1);
+        at = axis_append(out, at, digits + 1, sig - 1);
+    }
+    char exp[16];
+    return axis_append(out, at, exp, snprintf(exp, sizeof(exp), "e%d", lead));
+}
+
+// @algo: direct mapped by value; the lines in view are consecutive multiples of the
+// mantissa, and 64 of those (step 2) or 128 fit before two share a slot
+TextRun * axis_label(AxisLabels * labels, const AxisTicks * t, int64_t i, Font font, int size) {
+    if (labels->exponent != t->exponent) { // a new decade formats everything again
+        labels->exponent = t->exponent;
+        for (int k = 0; k < AXIS_LABELS; ++k) labels->slots[k].used = false;
+    }
+    AxisIndex n = (t->base + i) / t->minors * t->mantissa;
+    if (n == 0) return NULL; // where the axes cross
+    AxisLabel * l = labels->slots + (n & (AXIS_LABELS - 1));
+    if (!l->used || l->n != n) {
+        *l = (AxisLabel) {.n = n, .used = true};
+        l->len = axis_format(l->str, n, t->exponent);
+        labels->formatted += 1;
+    } else if (l->run && l->generation == text_cache_generation && l->run->size == size) {
+        labels->hits += 1;
+        return l->run;
+    }
+    // the run is looked up again after the text cache was cleared
+    l->run = text_layout(font, l->str, l->len, size);
+    l->generation = text_cache_generation;
+    return l->run;
+}
+
+#endif // AXES_H_
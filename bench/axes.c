@@ -0,0 +1,118 @@
+#include <stdio.h>
+
+#include "axes.h"
+#include "viewport.h"
+#include "bench.h"
+
+/*
+  the grid and its labels on a 1600x1000 plot, as `grapher_labels` walks them: the ticks of
+  both axes and a label for every major line, without drawing. a continuous zoom over six
+  decades around x = 1234.5678, then a pan. `uncached` formats and lays out every label
+  every frame, as a plain `axis_format` and `text_layout` would; the glyph runs stay in
+  the text cache either way
+ */
+
+#define BENCH_WIDTH 1600
+#define BENCH_HEIGHT 1000
+#define BENCH_ZOOM_FRAMES 1400
+#define BENCH_PAN_FRAMES 600
+#define BENCH_RUNS 5 // best of, the frames are a few microseconds
+
+static GlyphInfo bench_glyphs[128];
+static Rectangle bench_recs[128];
+
+// what text.h calls, nothing is drawn
+int GetGlyphIndex(Font font, int codepoint) { (void)font; return codepoint & 127; }
+bool rlCheckRenderBatchLimit(int count) { (void)count; return false; }
+void rlSetTexture(unsigned int id) { (void)id; }
+void rlBegin(int mode) { (void)mode; }
+void rlEnd(void) {}
+void rlColor4ub(unsigned char r, unsigned char g, unsigned char b, unsigned char a) { (void)r; (void)g; (void)b; (void)a; }
+void rlTexCoord2f(float x, float y) { (void)x; (void)y; }
+void rlVertex2f(float x, float y) { (void)x; (void)y; }
+
+typedef struct {
+    size_t frames, labels, formatted, hits;
+    double seconds;
+} BenchAxes;
+
+static volatile double bench_sink;
+
+static void bench_axis(AxisLabels * labels, const AxisTicks * t, Font font, bool cached, BenchAxes * b) {
+    for (int64_t i = t->first; i <= t->last; ++i) {
+        if (!axis_major(t, i)) continue;
+        bench_sink += axis_pixel(t, i);
+        TextRun * run;
+        if (cached) {
+            run = axis_label(labels, t, i, font, 14);
+        } else {
+            AxisIndex n = (t->base + i) / t->minors * t->mantissa;
+            if (n == 0) continue;
+            char str[AXIS_LABEL_MAX];
+            size_t len = axis_format(str, n, t->exponent);
+            run = text_layout(font, str, len, 14);
+            b->formatted += 1;
+        }
+        if (run) b->labels += 1;
+    }
+}
+
+static void bench_frame(AxisLabels labels[2], Viewport vp, Font font, bool cached, BenchAxes * b) {
+    double t = bench_now();
+    AxisTicks tx = axis_ticks(vp.cx, vp.span_x, BENCH_WIDTH, AXIS_X_PX);
+    AxisTicks ty = axis_ticks(vp.cy, vp.span_y, BENCH_HEIGHT, AXIS_Y_PX);
+    bench_axis(labels + 0, &tx, font, cached, b);
+    bench_axis(labels + 1, &ty, font, cached, b);
+    b->seconds += bench_now() - t;
+    b->frames += 1;
+}
+
+// best of `BENCH_RUNS`, counts from the first run, whose label cache starts empty
+static BenchAxes bench_sweep(Font font, bool cached, bool pan) {
+    BenchAxes best = {.seconds = INFINITY};
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        static AxisLabels labels[2];
+        labels[0] = labels[1] = (AxisLabels) {};
+        BenchAxes b = {};
+        Viewport vp = {.cx = dd_from(1234.5678), .cy = dd_from(-0.25), .span_x = 16, .span_y = 10};
+        if (pan) {
+            for (int f = 0; f < BENCH_PAN_FRAMES; ++f) {
+                bench_frame(labels, vp, font, cached, &b);
+                viewport_pan(&vp, vp.span_x * 0.01, vp.span_y * 0.003);
+            }
+        } else {
+            double factor = pow(1e-6, 1.0 / BENCH_ZOOM_FRAMES);
+            for (int f = 0; f < BENCH_ZOOM_FRAMES; ++f) {
+                bench_frame(labels, vp, font, cached, &b);
+                viewport_zoom(&vp, factor, 0, 0);
+            }
+        }
+        b.formatted += labels[0].formatted + labels[1].formatted;
+        b.hits = labels[0].hits + labels[1].hits;
+        if (run == 0) best = (BenchAxes) {b.frames, b.labels, b.formatted, b.hits, best.seconds};
+        if (b.seconds < best.seconds) best.seconds = b.seconds;
+    }
+    return best;
+}
+
+int main() {
+    Font font = {.baseSize = 20, .glyphCount = 128, .texture = {.id = 1, .width = 1024, .height = 20},
+                 .recs = bench_recs, .glyphs = bench_glyphs};
+    for (int i = 0; i < 128; ++i) {
+        bench_glyphs[i] = (GlyphInfo) {.value = i, .advanceX = 10};
+        bench_recs[i] = (Rectangle) {i * 8, 0, 8, 20};
+    }
+
+    printf("%-22s %8s %10s %10s %10s %12s\n", "1600x1000", "frames", "labels", "formatted", "cached", "us/frame");
+    for (int pan = 0; pan < 2; ++pan) {
+        for (int cached = 1; cached >= 0; --cached) {
+            BenchAxes b = bench_sweep(font, cached, pan);
+            char name[32];
+            snprintf(name, sizeof(name), "%s, %s", pan ? "pan" : "zoom 1e6", cached ? "cached" : "uncached");
+            printf("%-22s %8zu %10zu %10zu %10zu %12.3f\n", name, b.frames, b.labels, b.formatted, b.hits,
+                   b.seconds / b.frames * 1e6);
+        }
+    }
+    text_cache_clear();
+    return 0;
+}
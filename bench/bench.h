@@ -0,0 +1,40 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdbool.h>
+#include <stdio.h> // fflush
+#include <time.h> // clock_gettime
+#include <fcntl.h> // open
+#include <unistd.h> // dup, dup2, close
+
+/*
+  headless benchmarks: plain programs over the headers that need no window,
+  built and run by `make bench`, one table on stdout each
+ */
+
+double bench_now(); // seconds, monotonic
+void bench_quiet(bool quiet); // the parser traces every equation it reads on stdout
+
+double bench_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void bench_quiet(bool quiet) {
+    static int saved = -1;
+    fflush(stdout);
+    if (quiet && saved < 0) {
+        int null = open("/dev/null", O_WRONLY);
+        if (null < 0) return;
+        saved = dup(1);
+        dup2(null, 1);
+        close(null);
+    } else if (!quiet && saved >= 0) {
+        dup2(saved, 1);
+        close(saved);
+        saved = -1;
+    }
+}
+
+#endif // BENCH_H_
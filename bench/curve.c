@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "curve.h"
+#include "bench.h"
+
+/*
+  adaptive curve sampling against uniform steps in t with the same number of points,
+  on a 1200x600 canvas whose viewport is fitted to each curve.
+  the error is the largest distance from a dense reference, `BENCH_REFERENCE` uniform
+  samples, to the nearest segment of the polyline, in texture pixels
+ */
+
+#define BENCH_WIDTH 1200
+#define BENCH_HEIGHT 600
+#define BENCH_REFERENCE (1 << 16)
+#define BENCH_RUNS 100
+
+typedef struct {
+    const char * name;
+    CurveKind kind;
+    const char * fx, * fy;
+} BenchCurve;
+
+// `n` points uniform in t over the curve's range
+static void bench_uniform(Curve c, size_t n, Polyline * out) {
+    static CurvePoints pts = {};
+    CurvePoint * dst[EVAL_BLOCK];
+    double ts[EVAL_BLOCK];
+    pts.count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        da_append(&pts, ((CurvePoint) {.t = CURVE_T_MIN + (CURVE_T_MAX - CURVE_T_MIN) * i / (n - 1)}));
+    }
+    for (size_t i = 0; i < n; i += EVAL_BLOCK) {
+        size_t m = n - i < EVAL_BLOCK ? n - i : EVAL_BLOCK;
+        for (size_t j = 0; j < m; ++j) {
+            dst[j] = pts.items + i + j;
+            ts[j] = pts.items[i + j].t;
+        }
+        curve_eval_block(&c, dst, ts, m);
+    }
+    out->count = 0;
+    for (size_t i = 0; i < n; ++i) da_append(out, ((Vector2) {pts.items[i].x, pts.items[i].y}));
+}
+
+static double bench_segment_distance(Vector2 p, Vector2 a, Vector2 b) {
+    double dx = b.x - a.x, dy = b.y - a.y;
+    double len2 = dx * dx + dy * dy;
+    double u = len2 > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0;
+    u = u < 0 ? 0 : u > 1 ? 1 : u;
+    return hypot(p.x - a.x - u * dx, p.y - a.y - u * dy);
+}
+
+static double bench_error(Polyline * ref, Polyline * line) {
+    double worst = 0;
+    for (size_t i = 0; i < ref->count; ++i) {
+        double best = INFINITY;
+        for (size_t j = 0; j + 1 < line->count; ++j) {
+            double d = bench_segment_distance(ref->items[i], line->items[j], line->items[j + 1]);
+            if (d < best) best = d;
+        }
+        if (best > worst) worst = best;
+    }
+    return worst;
+}
+
+// the dense reference in graph units, so the viewport can be fitted to it
+static Viewport bench_fit(Curve c) {
+    c.vp = (Viewport) {.cx = dd_from(0), .cy = dd_from(0), .span_x = c.width, .span_y = c.height};
+    Polyline ref = {};
+    bench_uniform(c, BENCH_REFERENCE, &ref);
+    double x0 = INFINITY, x1 = -INFINITY, y0 = INFINITY, y1 = -INFINITY;
+    for (size_t i = 0; i < ref.count; ++i) {
+        x0 = fmin(x0, ref.items[i].x - c.width * 0.5);
+        x1 = fmax(x1, ref.items[i].x - c.width * 0.5);
+        y0 = fmin(y0, ref.items[i].y - c.height * 0.5);
+        y1 = fmax(y1, ref.items[i].y - c.height * 0.5);
+    }
+    da_free(&ref);
+    return (Viewport) {.cx = dd_from((x0 + x1) * 0.5), .cy = dd_from((y0 + y1) * 0.5),
+                       .span_x = (x1 - x0) * 1.1, .span_y = (y1 - y0) * 1.1};
+}
+
+int main() {
+    BenchCurve cases[] = {
+        {"localized bump", CURVE_PARAMETRIC, "t", "exp(-200 * (t - 3)^2)"},
+        {"rose, 7 petals", CURVE_POLAR, "3cos(7θ)", NULL},
+        {"lissajous 3:2", CURVE_PARAMETRIC, "cos(3t)", "sin(2t)"},
+        {"lissajous 5:4", CURVE_PARAMETRIC, "sin(5t)", "cos(4t)"},
+        {"circle", CURVE_PARAMETRIC, "cos(t)", "sin(t)"},
+    };
+    double params[PARAM_COUNT] = {};
+    Polyline ref = {}, adaptive = {}, uniform = {};
+
+    printf("%-20s %8s %8s %12s %12s %10s\n", "1200x600", "points", "evals", "adaptive px", "uniform px", "us");
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+        bench_quiet(true);
+        Program * fx = program_cache_get(cases[k].fx);
+        Program * fy = cases[k].fy ? program_cache_get(cases[k].fy) : NULL;
+        bench_quiet(false);
+        if (!fx->valid || (fy && !fy->valid)) {
+            printf("%-20s does not compile\n", cases[k].name);
+            program_release(fx);
+            if (fy) program_release(fy);
+            continue;
+        }
+        Curve c = {.kind = cases[k].kind, .fx = fx, .fy = fy, .params = params,
+                   .width = BENCH_WIDTH, .height = BENCH_HEIGHT};
+        c.vp = bench_fit(c);
+
+        size_t evals = curve_sample(c, &adaptive);
+        double t = bench_now();
+        for (int run = 0; run < BENCH_RUNS; ++run) curve_sample(c, &adaptive);
+        t = (bench_now() - t) / BENCH_RUNS;
+        bench_uniform(c, adaptive.count, &uniform);
+        bench_uniform(c, BENCH_REFERENCE, &ref);
+        printf("%-20s %8zu %8zu %12.2f %12.2f %10.1f\n", cases[k].name, adaptive.count, evals,
+               bench_error(&ref, &adaptive), bench_error(&ref, &uniform), t * 1e6);
+        program_release(fx);
+        if (fy) program_release(fy);
+    }
+    da_free(&ref);
+    da_free(&adaptive);
+    da_free(&uniform);
+    program_cache_free();
+    return 0;
+}
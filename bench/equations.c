@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "equations.h"
+#include "bench.h"
+
+/*
+  sidebar frame cost against the number of equations, with the workspace `--stress` builds:
+  the rows in view, as the sidebar lays them out, against every row, as it did before
+  virtualization; a remove and an add per frame, and the parameter rebuild they avoid
+ */
+
+#define BENCH_ROWS 24 // in view
+#define BENCH_FRAMES 2000
+#define BENCH_COLS 64
+
+// what the sidebar reads of a row, minus the drawing
+static size_t bench_row(Equations * eqs, size_t row) {
+    size_t id = eqs_row_id(eqs, row);
+    Equation * eq = eqs_get(eqs, id);
+    char buf[BENCH_COLS];
+    int slot = eq->defines ? param_index(eq->defines) : -1;
+    bool has_slider = slot >= 0 && eq->state == ES_VALID &&
+        eqs->params.owner[slot] == id && !(eqs->params.derived >> slot & 1);
+    if (has_slider) return snprintf(buf, sizeof(buf), "%c = %.3g", eq->defines, eqs->params.values[slot]);
+    return string_copy_range(&eq->editor, 0, sizeof(buf), buf) + (id == eqs->selected);
+}
+
+static Equation bench_equation(int k) {
+    char text[64];
+    if (k == 0) snprintf(text, sizeof(text), "a = 1");
+    else snprintf(text, sizeof(text), "%d sin(x + %d) / %d + a", k % 7 + 1, k % 100, k % 13 + 1);
+    Equation eq = {.editor = string_createFrom(text)};
+    equation_commit(&eq);
+    return eq;
+}
+
+int main() {
+    printf("%8s %12s %12s %14s %12s\n", "rows", "view us", "all rows us", "remove+add us", "rebuild us");
+    size_t sizes[] = {100, 1000, 10000, 100000};
+    size_t sink = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        size_t n = sizes[s];
+        Equations eqs = {.selected = -1};
+        bench_quiet(true);
+        for (size_t k = 0; k < n; ++k) eqs_add(&eqs, bench_equation(k));
+        eqs_rebuild_params(&eqs);
+        Equation spare[BENCH_FRAMES];
+        for (int f = 0; f < BENCH_FRAMES; ++f) spare[f] = bench_equation(n + f);
+        bench_quiet(false);
+
+        // scroll a little every frame
+        double t = bench_now();
+        for (int f = 0; f < BENCH_FRAMES; ++f) {
+            size_t first = f * 7 % (n - BENCH_ROWS);
+            for (size_t row = first; row < first + BENCH_ROWS; ++row) sink += bench_row(&eqs, row);
+        }
+        double view = (bench_now() - t) / BENCH_FRAMES;
+
+        int all_frames = n > 10000 ? 20 : 200;
+        t = bench_now();
+        for (int f = 0; f < all_frames; ++f) {
+            for (size_t row = 0; row < eqs.order.count; ++row) sink += bench_row(&eqs, row);
+        }
+        double all = (bench_now() - t) / all_frames;
+
+        // the selected row goes, a new one comes in at the bottom
+        t = bench_now();
+        for (int f = 0; f < BENCH_FRAMES; ++f) {
+            eqs.selected = eqs_row_id(&eqs, 1 + f * 7919 % (eqs.order.count - 1));
+            eqs_remove(&eqs, eqs.selected);
+            eqs_add(&eqs, spare[f]);
+        }
+        double churn = (bench_now() - t) / BENCH_FRAMES;
+
+        int rebuilds = n > 10000 ? 10 : 100;
+        t = bench_now();
+        for (int f = 0; f < rebuilds; ++f) eqs_rebuild_params(&eqs);
+        double rebuild = (bench_now() - t) / rebuilds;
+
+        printf("%8zu %12.2f %12.2f %14.2f %12.2f\n", n, view * 1e6, all * 1e6, churn * 1e6, rebuild * 1e6);
+        eqs_free(&eqs);
+    }
+    return sink == 0;
+}
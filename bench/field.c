@@ -0,0 +1,77 @@
+#include <stdio.h>
+
+#include "equations.h"
+#include "field.h"
+#include "bench.h"
+
+/*
+  megapixels per second of the 2d engine, one cell per pixel of a 1280 x 960 plot:
+  the first frame within the 12 ms budget of main.c, the frames until every level is in,
+  and whole runs without a budget like `--export`, colouring included
+ */
+
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 960
+#define BENCH_BUDGET_MS 12.0
+#define BENCH_RUNS 5
+
+static const char * bench_fields[] = {
+    "z = sin(x * y) + x^2 / 4 - a * cos(y)",
+    "z = x < 0 ? sqrt(-x) * sin(3y) : x * y / 4",
+    "w = (z^2 - 1) / (z^2 + i)",
+    "w = exp(1 / z)",
+};
+
+int main() {
+    double params[PARAM_COUNT] = {};
+    params[param_index('a')] = 1.5;
+    Field f = {};
+    Viewport vp = viewport_default();
+    double mpx = BENCH_WIDTH * BENCH_HEIGHT * 1e-6;
+
+    printf("%-42s %10s %8s %10s %12s\n", "1280 x 960 cells", "first ms", "frames", "frames ms", "full Mpx/s");
+    for (size_t e = 0; e < sizeof(bench_fields) / sizeof(bench_fields[0]); ++e) {
+        Equation eq = {.editor = string_createFrom(bench_fields[e])};
+        bench_quiet(true);
+        equation_commit(&eq);
+        bench_quiet(false);
+        if (eq.state != ES_VALID || (eq.kind != EK_FIELD && eq.kind != EK_COMPLEX)) {
+            printf("%-42s is not a field\n", bench_fields[e]);
+            equation_free(&eq);
+            continue;
+        }
+        FieldJob job = {
+            .kind = eq.kind == EK_FIELD ? FIELD_HEAT : FIELD_COMPLEX,
+            .prog = eq.prog,
+            .params = params,
+            .vp = vp,
+            .width = BENCH_WIDTH,
+            .height = BENCH_HEIGHT,
+        };
+        // progressive, as on screen
+        field_reset(&f, job);
+        double t = bench_now();
+        field_step(&f, BENCH_BUDGET_MS);
+        double first = bench_now() - t;
+        int frames = 1;
+        while (f.level >= 0) {
+            field_step(&f, BENCH_BUDGET_MS);
+            frames += 1;
+        }
+        double progressive = bench_now() - t;
+        // every level at once
+        t = bench_now();
+        for (int run = 0; run < BENCH_RUNS; ++run) {
+            field_reset(&f, job);
+            while (f.level >= 0) field_step(&f, INFINITY);
+        }
+        double full = (bench_now() - t) / BENCH_RUNS;
+        printf("%-42s %10.2f %8d %10.1f %12.1f\n", bench_fields[e], first * 1e3, frames, progressive * 1e3, mpx / full);
+        equation_free(&eq);
+    }
+    printf("%d threads\n", g_field_pool.count + 1);
+    field_free(&f);
+    program_cache_free();
+    field_pool_stop();
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dynarray.h"
+#include "gapbuffer.h"
+#include "bench.h"
+
+/*
+  cost per keystroke in a 100 KB editor text: the gap buffer against the flat,
+  null terminated string it replaced, whose insert and backspace shift the whole tail
+ */
+
+#define BENCH_BYTES (100 * 1024)
+#define BENCH_KEYS 2000
+
+// the String from before the gap buffer, as it was
+typedef struct {
+    char * items; // [!] keep this null terminated
+    size_t count;
+    size_t capacity;
+
+    size_t cursor;
+} FlatString;
+
+static void flat_insert(FlatString * str, char c) {
+    for (size_t i = str->count - 1; i > str->cursor; --i) {
+        str->items[i] = str->items[i-1];
+    }
+    str->items[str->cursor] = c;
+    str->cursor += 1;
+    da_append(str, 0);
+}
+
+static void flat_backspace(FlatString * str) {
+    if (str->cursor == 0) return;
+    for (size_t i = str->cursor; i < str->count; ++i) {
+        str->items[i-1] = str->items[i];
+    }
+    str->cursor -= 1;
+    str->count -= 1;
+}
+
+static FlatString flat_create(const char * text, size_t n) {
+    FlatString str = {};
+    for (size_t i = 0; i < n; ++i) da_append(&str, text[i]);
+    da_append(&str, 0);
+    return str;
+}
+
+typedef enum {
+    BENCH_TYPE, // at the middle, the cursor stays there
+    BENCH_ERASE, // backspace at the middle
+    BENCH_JUMP, // each key somewhere else, a click between keystrokes
+} BenchEdit;
+
+static size_t bench_at(BenchEdit edit, int key) {
+    return edit == BENCH_JUMP ? (size_t)key * 2654435761u % BENCH_BYTES : BENCH_BYTES / 2;
+}
+
+static double bench_gap(const char * text, BenchEdit edit) {
+    String str = string_createFrom(text);
+    string_move_cursor(&str, bench_at(edit, 0), false);
+    double t = bench_now();
+    for (int key = 0; key < BENCH_KEYS; ++key) {
+        if (edit == BENCH_JUMP) string_move_cursor(&str, bench_at(edit, key), false);
+        if (edit == BENCH_ERASE) string_backspace(&str);
+        else string_insert(&str, 'a' + key % 26);
+    }
+    t = bench_now() - t;
+    string_free(&str);
+    return t / BENCH_KEYS;
+}
+
+static double bench_flat(const char * text, BenchEdit edit) {
+    FlatString str = flat_create(text, BENCH_BYTES);
+    str.cursor = bench_at(edit, 0);
+    double t = bench_now();
+    for (int key = 0; key < BENCH_KEYS; ++key) {
+        if (edit == BENCH_JUMP) str.cursor = bench_at(edit, key);
+        if (edit == BENCH_ERASE) flat_backspace(&str);
+        else flat_insert(&str, 'a' + key % 26);
+    }
+    t = bench_now() - t;
+    free(str.items);
+    return t / BENCH_KEYS;
+}
+
+int main() {
+    static char text[BENCH_BYTES + 1];
+    for (int i = 0; i < BENCH_BYTES; ++i) text[i] = "sin(x) + 2 * cos(3x) "[i % 21];
+    const char * names[] = {"type at the middle", "backspace at the middle", "type anywhere"};
+
+    printf("%-26s %12s %12s\n", "us per key, 100 KB", "flat", "gap buffer");
+    for (BenchEdit edit = BENCH_TYPE; edit <= BENCH_JUMP; ++edit) {
+        double flat = bench_flat(text, edit);
+        double gap = bench_gap(text, edit);
+        printf("%-26s %12.3f %12.3f\n", names[edit], flat * 1e6, gap * 1e6);
+    }
+    return 0;
+}
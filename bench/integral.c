@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "integral.h"
+#include "bench.h"
+
+/*
+  function evaluations per integral to `INTEGRAL_TOL`: the adaptive Gauss–Kronrod of
+  integral.h against fixed step Simpson that doubles its steps until two passes agree,
+  over smooth, peaked and singular integrands, with the true error of each and the
+  time of a miss and a hit of the integral cache
+ */
+
+#define BENCH_SIMPSON_MAX (1 << 21) // steps
+#define BENCH_HITS 100000
+
+typedef struct {
+    const char * kind, * f;
+    double a, b, exact;
+} BenchIntegral;
+
+static double * bench_xs, * bench_ys;
+
+// composite simpson over `n` steps, `n` even
+static double bench_simpson(Program * prog, const double * params, double a, double b, size_t n) {
+    double h = (b - a) / n, sum = 0;
+    for (size_t i = 0; i <= n; ++i) bench_xs[i] = a + i * h;
+    program_eval_batch_d(prog, params, bench_xs, bench_ys, n + 1);
+    for (size_t i = 0; i <= n; ++i) sum += bench_ys[i] * (i == 0 || i == n ? 1 : i % 2 ? 4 : 2);
+    return sum * h / 3;
+}
+
+// evaluations of the last pass, which has every node of the ones before; 0 if it gave up
+static size_t bench_simpson_evals(Program * prog, const double * params, double a, double b, double * value) {
+    double last = bench_simpson(prog, params, a, b, 2);
+    for (size_t n = 4; n <= BENCH_SIMPSON_MAX; n *= 2) {
+        *value = bench_simpson(prog, params, a, b, n);
+        if (!isfinite(*value)) return 0;
+        if (fabs(*value - last) <= INTEGRAL_TOL * fabs(*value)) return n + 1;
+        last = *value;
+    }
+    return 0;
+}
+
+int main() {
+    BenchIntegral cases[] = {
+        {"smooth", "sin(x)", 0, M_PI, 2},
+        {"smooth", "exp(-x^2)", -3, 3, sqrt(M_PI) * erf(3)},
+        {"smooth", "x^5 - 3x^3 + x", -1, 2, 63.0 / 6 - 45.0 / 4 + 1.5},
+        {"peaked", "1 / (1 + 25x^2)", -1, 1, 0.4 * atan(5)},
+        {"peaked", "1 / (0.0001 + (x - 0.3)^2)", 0, 1, 100 * (atan(70) + atan(30))},
+        {"peaked", "sin(10x)^2", 0, 3, 1.5 - sin(60) / 40},
+        {"kink", "x < 0 ? -x : x", -1, 2, 2.5},
+        {"singular", "sqrt(x)", 0, 1, 2.0 / 3},
+        {"singular", "log(x)", 0, 1, -1},
+        {"singular", "1 / sqrt(x)", 0, 1, 2},
+        {"singular", "1 / x^0.9", 0, 1, 10},
+    };
+    double params[PARAM_COUNT] = {};
+    bench_xs = malloc((BENCH_SIMPSON_MAX + 1) * sizeof(double));
+    bench_ys = malloc((BENCH_SIMPSON_MAX + 1) * sizeof(double));
+    if (!bench_xs || !bench_ys) exit(1);
+
+    printf("%-9s %-28s %8s %9s %8s %9s %9s %9s\n", "", "evaluations to 1e-10", "gk", "gk err", "simpson",
+           "simp err", "miss us", "hit us");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+        BenchIntegral * k = cases + c;
+        bench_quiet(true);
+        Program * prog = program_cache_get(k->f);
+        bench_quiet(false);
+        if (!prog->valid) {
+            printf("%-9s %-28s does not compile\n", k->kind, k->f);
+            program_release(prog);
+            continue;
+        }
+        double t = bench_now();
+        IntegralResult gk = integral_cached(prog, params, k->a, k->b, INTEGRAL_TOL);
+        double miss = bench_now() - t;
+        t = bench_now();
+        for (int i = 0; i < BENCH_HITS; ++i) integral_cached(prog, params, k->a, k->b, INTEGRAL_TOL);
+        double hit = (bench_now() - t) / BENCH_HITS;
+        double simpson = NAN;
+        size_t evals = bench_simpson_evals(prog, params, k->a, k->b, &simpson);
+        char gk_evals[16], simpson_evals[16], simpson_err[16];
+        snprintf(gk_evals, sizeof(gk_evals), gk.converged ? "%zu" : "%zu!", gk.evals);
+        snprintf(simpson_evals, sizeof(simpson_evals), evals ? "%zu" : "-", evals);
+        snprintf(simpson_err, sizeof(simpson_err), evals ? "%.1e" : "-", fabs(simpson - k->exact));
+        printf("%-9s %-28s %8s %9.1e %8s %9s %9.2f %9.3f\n", k->kind, k->f, gk_evals, fabs(gk.value - k->exact),
+               simpson_evals, simpson_err, miss * 1e6, hit * 1e6);
+        program_release(prog);
+    }
+    printf("! ran out of intervals, - simpson did not agree within %d steps or hit a pole\n", BENCH_SIMPSON_MAX);
+    free(bench_xs);
+    free(bench_ys);
+    program_cache_free();
+    return 0;
+}
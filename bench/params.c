@@ -0,0 +1,95 @@
+#include <stdio.h>
+
+#include "equations.h"
+#include "bench.h"
+
+/*
+  frame cost of 20 parameters driving 100 graphs, next to 100 graphs reading none:
+  the sliders step, the changes propagate, and only the dirty graphs are sampled again,
+  one float evaluation every other pixel column of a 1600 px plot like `grapher_sample`.
+  the last row samples every graph every frame, as if nothing tracked the dependencies
+ */
+
+#define BENCH_PARAMS "abcdfghjklmnopqsuvAB" // `A` and `B` are derived
+#define BENCH_CURVES 100
+#define BENCH_STATIC 100
+#define BENCH_WIDTH 1600
+#define BENCH_FRAMES 600
+
+static float bench_xs[BENCH_WIDTH / 2], bench_ys[BENCH_WIDTH / 2];
+
+static void bench_add(Equations * eqs, const char * text) {
+    Equation eq = {.editor = string_createFrom(text)};
+    equation_commit(&eq);
+    eqs_add(eqs, eq);
+}
+
+// propagate and sample one frame, return the graphs sampled
+static size_t bench_frame(Equations * eqs, uint64_t moving, bool everything, double * propagate_s) {
+    double t = bench_now();
+    Params * ps = &eqs->params;
+    ps->animating = moving;
+    eqs_animate(eqs, 1.0f / 60);
+    *propagate_s += bench_now() - t;
+    size_t sampled = 0;
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        Equation * eq = eqs->items + eqs->order.items[row];
+        if (!eq->dirty && !everything) continue;
+        eq->dirty = false;
+        if (eq->state != ES_VALID || eq->defines) continue;
+        program_eval_batch_f(eq->prog, ps->values, bench_xs, bench_ys, BENCH_WIDTH / 2);
+        sampled += 1;
+    }
+    return sampled;
+}
+
+int main() {
+    Equations eqs = {.selected = -1};
+    const char * names = BENCH_PARAMS;
+    char text[64];
+    bench_quiet(true);
+    for (int p = 0; p < 18; ++p) {
+        snprintf(text, sizeof(text), "%c = %d", names[p], p + 1);
+        bench_add(&eqs, text);
+    }
+    bench_add(&eqs, "A = a + b");
+    bench_add(&eqs, "B = A * c");
+    for (int k = 0; k < BENCH_CURVES; ++k) {
+        snprintf(text, sizeof(text), "%c * sin(x + %c) / 20", names[k % 20], names[k * 7 % 20]);
+        bench_add(&eqs, text);
+    }
+    for (int k = 0; k < BENCH_STATIC; ++k) {
+        snprintf(text, sizeof(text), "sin(x * %d) + %d", k % 9 + 1, k);
+        bench_add(&eqs, text);
+    }
+    eqs_rebuild_params(&eqs);
+    bench_quiet(false);
+    for (int i = 0; i < BENCH_WIDTH / 2; ++i) bench_xs[i] = -10 + 20.0f * i / (BENCH_WIDTH / 2);
+
+    uint64_t one = 1ull << param_index('a');
+    uint64_t all = eqs.params.defined & ~eqs.params.derived;
+    struct {
+        const char * name;
+        uint64_t moving;
+        bool everything;
+    } cases[] = {
+        {"1 slider moving", one, false},
+        {"18 sliders moving", all, false},
+        {"18 moving, sample all", all, true},
+    };
+    printf("%-24s %10s %14s %10s\n", "per frame", "graphs", "propagate us", "frame us");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c) {
+        double propagate = 0;
+        bench_frame(&eqs, cases[c].moving, cases[c].everything, &propagate); // whatever the last case left dirty
+        propagate = 0;
+        size_t sampled = 0;
+        double t = bench_now();
+        for (int f = 0; f < BENCH_FRAMES; ++f) sampled += bench_frame(&eqs, cases[c].moving, cases[c].everything, &propagate);
+        t = bench_now() - t;
+        printf("%-24s %10.1f %14.2f %10.1f\n", cases[c].name, (double)sampled / BENCH_FRAMES,
+               propagate / BENCH_FRAMES * 1e6, t / BENCH_FRAMES * 1e6);
+    }
+    eqs_free(&eqs);
+    program_cache_free();
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+
+#include "compile.h"
+#include "bench.h"
+
+/*
+  polynomial folding: each expression compiled node by node (`g_poly_fold` off) and
+  folded into OP_POLY, with the tree nodes against the ops emitted (OP_COEF not counted)
+  and nanoseconds per point of the batch and the scalar double evaluators
+ */
+
+#define BENCH_POINTS (1 << 16)
+#define BENCH_SECONDS 0.2 // per evaluator and variant
+
+static const char * bench_exprs[] = {
+    "3x x x - 2x x + x - 7",
+    "x^7 - x^6 + x^5 - x^4 + x^3 - x^2 + x - 1",
+    "(x^2 + 1) / (x^3 - 2x)",
+    "(x - 1)(x - 2)(x - 3)(x - 4)(x - 5)(x - 6)(x - 7)(x - 8)",
+};
+
+static double bench_xs[BENCH_POINTS], bench_ys[BENCH_POINTS];
+
+static double bench_batch(Program * prog, const double * params) {
+    volatile double sink = 0;
+    size_t evals = 0;
+    double t = bench_now(), dt;
+    do {
+        program_eval_batch_d(prog, params, bench_xs, bench_ys, BENCH_POINTS);
+        sink += bench_ys[evals % BENCH_POINTS];
+        evals += BENCH_POINTS;
+    } while ((dt = bench_now() - t) < BENCH_SECONDS);
+    return dt / evals * 1e9;
+}
+
+static double bench_scalar(Program * prog, const double * params) {
+    volatile double sink = 0;
+    size_t evals = 0;
+    double t = bench_now(), dt;
+    do {
+        for (int i = 0; i < BENCH_POINTS; ++i) sink += program_eval_d(prog, params, bench_xs[i]);
+        evals += BENCH_POINTS;
+    } while ((dt = bench_now() - t) < BENCH_SECONDS);
+    return dt / evals * 1e9;
+}
+
+int main() {
+    for (int i = 0; i < BENCH_POINTS; ++i) bench_xs[i] = -4 + 8.0 * i / BENCH_POINTS;
+    double params[PARAM_COUNT] = {};
+
+    printf("%-56s %6s %10s %16s %16s\n", "double, 64k points", "nodes", "ops", "batch ns/pt", "scalar ns/pt");
+    for (size_t e = 0; e < sizeof(bench_exprs) / sizeof(bench_exprs[0]); ++e) {
+        size_t nodes = 0, ops[2] = {};
+        double batch[2] = {}, scalar[2] = {};
+        bool valid = true;
+        for (int fold = 0; fold < 2 && valid; ++fold) {
+            g_poly_fold = fold;
+            size_t before_nodes = g_program_cache.nodes, before_ops = g_program_cache.ops;
+            bench_quiet(true);
+            Program * prog = program_cache_get(bench_exprs[e]);
+            bench_quiet(false);
+            valid = prog->valid;
+            if (valid) {
+                nodes = g_program_cache.nodes - before_nodes;
+                ops[fold] = g_program_cache.ops - before_ops;
+                batch[fold] = bench_batch(prog, params);
+                scalar[fold] = bench_scalar(prog, params);
+            }
+            program_release(prog);
+            program_cache_free(); // the text is compiled again with the other setting
+        }
+        if (!valid) {
+            printf("%-56s does not compile\n", bench_exprs[e]);
+            continue;
+        }
+        printf("%-56s %6zu %4zu -> %-2zu %6.1f -> %-6.1f %6.1f -> %-6.1f\n", bench_exprs[e], nodes, ops[0], ops[1],
+               batch[0], batch[1], scalar[0], scalar[1]);
+    }
+    g_poly_fold = true;
+    return 0;
+}
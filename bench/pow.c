@@ -0,0 +1,65 @@
+#include <stdio.h>
+
+#include "compile.h"
+#include "bench.h"
+
+/*
+  powers in the batch double evaluator: a literal integer exponent is one OP_POWI, against
+  the same power written out as products and a non-integer exponent through pow.
+  `nodes` compiles node by node, as before polynomial folding, `folded` is the default,
+  where a product of inputs becomes one OP_POWI too
+ */
+
+#define BENCH_POINTS (1 << 16)
+#define BENCH_SECONDS 0.2 // per expression and variant
+
+static const char * bench_exprs[] = {
+    "x*x*x",
+    "x^3",
+    "x*x*x*x*x*x*x*x",
+    "x^8",
+    "x^2.5",
+    "sin(x)^3",
+};
+
+static double bench_xs[BENCH_POINTS], bench_ys[BENCH_POINTS];
+
+static double bench_batch(Program * prog, const double * params) {
+    volatile double sink = 0;
+    size_t evals = 0;
+    double t = bench_now(), dt;
+    do {
+        program_eval_batch_d(prog, params, bench_xs, bench_ys, BENCH_POINTS);
+        sink += bench_ys[evals % BENCH_POINTS];
+        evals += BENCH_POINTS;
+    } while ((dt = bench_now() - t) < BENCH_SECONDS);
+    return dt / evals * 1e9;
+}
+
+int main() {
+    for (int i = 0; i < BENCH_POINTS; ++i) bench_xs[i] = 0.5 + 3.0 * i / BENCH_POINTS; // pow needs x > 0
+    double params[PARAM_COUNT] = {};
+
+    printf("%-24s %14s %14s\n", "batch double, ns/pt", "nodes", "folded");
+    for (size_t e = 0; e < sizeof(bench_exprs) / sizeof(bench_exprs[0]); ++e) {
+        double ns[2] = {};
+        bool valid = true;
+        for (int fold = 0; fold < 2 && valid; ++fold) {
+            g_poly_fold = fold;
+            bench_quiet(true);
+            Program * prog = program_cache_get(bench_exprs[e]);
+            bench_quiet(false);
+            valid = prog->valid;
+            if (valid) ns[fold] = bench_batch(prog, params);
+            program_release(prog);
+            program_cache_free(); // the text is compiled again with the other setting
+        }
+        if (!valid) {
+            printf("%-24s does not compile\n", bench_exprs[e]);
+            continue;
+        }
+        printf("%-24s %14.2f %14.2f\n", bench_exprs[e], ns[0], ns[1]);
+    }
+    g_poly_fold = true;
+    return 0;
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "compile.h"
+#include "bench.h"
+
+/*
+  evaluations per second of each precision tier, as the sampler calls them:
+  float and double in blocks, double-double one point at a time.
+  then conditionals in double: blocks that go both ways (random x) against blocks that
+  all agree (sorted x), which run one side only, and the OP_END blend as a bit mask
+  against the plain `?:` it replaced
+ */
+
+#define BENCH_POINTS 4096
+#define BENCH_SECONDS 0.2 // per tier and expression
+#define BENCH_COND_POINTS (1 << 16)
+#define BENCH_MASKS 64 // blocks of random masks, too many for the branch predictor to learn
+
+static const char * bench_exprs[] = {
+    "x^3 - 2x + 1",
+    "sin(x) * exp(-x^2 / 4)",
+    "sqrt(abs(x)) + log(1 + x^2) / (1 + cos(x)^2)",
+    "x < 0 ? -x : x^2",
+};
+
+static const char * bench_cond_exprs[] = {
+    "x < 0 ? -x : x",
+    "abs(x)", // the same, for reference
+    "sin(x) > 0 ? exp(sin(x)) : cos(x)^2",
+};
+
+static uint64_t bench_rng = 0x9E3779B97F4A7C15ull;
+
+static double bench_random() { // xorshift, in [0, 1)
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 7;
+    bench_rng ^= bench_rng << 17;
+    return (bench_rng >> 11) * 0x1p-53;
+}
+
+static double bench_cond_batch(Program * prog, const double * params, const double * xs, double * ys) {
+    volatile double sink = 0;
+    size_t evals = 0;
+    double t = bench_now(), dt;
+    do {
+        program_eval_batch_d(prog, params, xs, ys, BENCH_COND_POINTS);
+        sink += ys[evals % BENCH_COND_POINTS];
+        evals += BENCH_COND_POINTS;
+    } while ((dt = bench_now() - t) < BENCH_SECONDS);
+    return dt / evals * 1e9;
+}
+
+static double bench_cond_scalar(Program * prog, const double * params, const double * xs) {
+    volatile double sink = 0;
+    size_t evals = 0;
+    double t = bench_now(), dt;
+    do {
+        for (int i = 0; i < BENCH_COND_POINTS; ++i) sink += program_eval_d(prog, params, xs[i]);
+        evals += BENCH_COND_POINTS;
+    } while ((dt = bench_now() - t) < BENCH_SECONDS);
+    return dt / evals * 1e9;
+}
+
+// the blend before the bit mask, kept out of line like `program_blend_double`
+static __attribute__((noinline)) void bench_blend_select(double * c, const double * a, const double * b, size_t m) {
+    for (size_t i = 0; i < m; ++i) c[i] = expr_truthy(c[i]) ? a[i] : b[i];
+}
+
+// ns per lane of blending one block, `c` restored from the next block of `masks` each time
+static double bench_blend(bool select, const double * masks, double * c, const double * a, const double * b) {
+    size_t lanes = 0;
+    double t = bench_now(), dt;
+    do {
+        for (int k = 0; k < BENCH_MASKS; ++k) {
+            memcpy(c, masks + k * EVAL_BLOCK, EVAL_BLOCK * sizeof(double));
+            if (select) bench_blend_select(c, a, b, EVAL_BLOCK);
+            else program_blend_double(c, a, b, EVAL_BLOCK);
+            lanes += EVAL_BLOCK;
+        }
+    } while ((dt = bench_now() - t) < BENCH_SECONDS);
+    return dt / lanes * 1e9;
+}
+
+static void bench_conditionals(const double * params) {
+    static double sorted[BENCH_COND_POINTS], shuffled[BENCH_COND_POINTS], ys[BENCH_COND_POINTS];
+    for (int i = 0; i < BENCH_COND_POINTS; ++i) {
+        sorted[i] = -4 + 8.0 * i / BENCH_COND_POINTS;
+        shuffled[i] = -4 + 8.0 * bench_random();
+    }
+    printf("\n%-46s %14s %14s %14s\n", "double, ns per point", "batch mixed", "batch uniform", "scalar");
+    for (size_t e = 0; e < sizeof(bench_cond_exprs) / sizeof(bench_cond_exprs[0]); ++e) {
+        bench_quiet(true);
+        Program * prog = program_cache_get(bench_cond_exprs[e]);
+        bench_quiet(false);
+        if (!prog->valid) {
+            printf("%-46s does not compile\n", bench_cond_exprs[e]);
+            program_release(prog);
+            continue;
+        }
+        double mixed = bench_cond_batch(prog, params, shuffled, ys);
+        double uniform = bench_cond_batch(prog, params, sorted, ys);
+        double scalar = bench_cond_scalar(prog, params, shuffled);
+        printf("%-46s %14.2f %14.2f %14.2f\n", bench_cond_exprs[e], mixed, uniform, scalar);
+        program_release(prog);
+    }
+
+    static double mask_random[BENCH_MASKS * EVAL_BLOCK], mask_uniform[BENCH_MASKS * EVAL_BLOCK];
+    static double c[EVAL_BLOCK], a[EVAL_BLOCK], b[EVAL_BLOCK];
+    for (int i = 0; i < BENCH_MASKS * EVAL_BLOCK; ++i) {
+        mask_random[i] = bench_random() < 0.5;
+        mask_uniform[i] = 1;
+    }
+    for (int i = 0; i < EVAL_BLOCK; ++i) {
+        a[i] = i;
+        b[i] = -i;
+    }
+    printf("\n%-46s %14s %14s\n", "blend of a block, ns per lane", "random mask", "uniform mask");
+    printf("%-46s %14.2f %14.2f\n", "bit mask, program_blend_double", bench_blend(false, mask_random, c, a, b),
+           bench_blend(false, mask_uniform, c, a, b));
+    printf("%-46s %14.2f %14.2f\n", "c ? a : b, before", bench_blend(true, mask_random, c, a, b),
+           bench_blend(true, mask_uniform, c, a, b));
+}
+
+int main() {
+    static float xf[BENCH_POINTS], yf[BENCH_POINTS];
+    static double xd[BENCH_POINTS], yd[BENCH_POINTS];
+    static ddouble xdd[BENCH_POINTS];
+    for (int i = 0; i < BENCH_POINTS; ++i) {
+        xd[i] = -4 + 8.0 * i / BENCH_POINTS;
+        xf[i] = xd[i];
+        xdd[i] = dd_add(dd_from(1), dd_from(xd[i] * 1e-20)); // deep zoom around 1
+    }
+    double params[PARAM_COUNT] = {};
+    volatile double sink = 0; // keeps the loops
+
+    printf("%-46s %14s %14s %14s\n", "evaluations per second", "float", "double", "double-double");
+    for (size_t e = 0; e < sizeof(bench_exprs) / sizeof(bench_exprs[0]); ++e) {
+        bench_quiet(true);
+        Program * prog = program_cache_get(bench_exprs[e]);
+        bench_quiet(false);
+        if (!prog->valid) {
+            printf("%-46s does not compile\n", bench_exprs[e]);
+            program_release(prog);
+            continue;
+        }
+        double rate[3];
+        for (int tier = 0; tier < 3; ++tier) {
+            size_t evals = 0;
+            double t = bench_now(), dt;
+            do {
+                if (tier == 0) {
+                    program_eval_batch_f(prog, params, xf, yf, BENCH_POINTS);
+                    sink += yf[evals % BENCH_POINTS];
+                } else if (tier == 1) {
+                    program_eval_batch_d(prog, params, xd, yd, BENCH_POINTS);
+                    sink += yd[evals % BENCH_POINTS];
+                } else {
+                    for (int i = 0; i < BENCH_POINTS; ++i) sink += program_eval_dd(prog, params, xdd[i]).lo;
+                }
+                evals += BENCH_POINTS;
+            } while ((dt = bench_now() - t) < BENCH_SECONDS);
+            rate[tier] = evals / dt;
+        }
+        printf("%-46s %14.3g %14.3g %14.3g\n", bench_exprs[e], rate[0], rate[1], rate[2]);
+        program_release(prog);
+    }
+    bench_conditionals(params);
+    program_cache_free();
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "raster.h"
+#include "bench.h"
+
+/*
+  the 2d plot rasterized at 1x with analytic coverage against the same primitives at the
+  old 2x size, the resolution the `RenderTexture` path drew at: ms per frame and the bytes
+  the raster holds. curves come in half pixels like `grapher_sample` gives them, one point
+  every other column of the 2x canvas, with the axes and their arrowheads on top
+ */
+
+#define BENCH_WIDTH 1200
+#define BENCH_HEIGHT 900
+#define BENCH_RUNS 10
+
+typedef struct {
+    Vector2 * items;
+    size_t count;
+    size_t capacity;
+} BenchCurve;
+
+static BenchCurve bench_curves[40];
+
+// `n` curves over the 2x canvas, `waves` periods across it
+static void bench_scene(int n, double waves) {
+    int w = 2 * BENCH_WIDTH, h = 2 * BENCH_HEIGHT;
+    for (int c = 0; c < n; ++c) {
+        BenchCurve * p = bench_curves + c;
+        p->count = 0;
+        for (int i = 0; i < (w + 1) / 2; ++i) {
+            double x = 2.0 * i / w, amp = h * (0.1 + 0.3 * c / n);
+            da_append(p, ((Vector2) {2 * i, h * 0.5f + amp * sin(2 * M_PI * waves * x + c)}));
+        }
+    }
+}
+
+// `k` takes the 2x sample space to pixels, like `grapher_compose`
+static void bench_frame(Raster * r, int n, float k) {
+    int w = BENCH_WIDTH * 2 * k, h = BENCH_HEIGHT * 2 * k;
+    raster_begin(r, w, h, NULL, 0xFFFFFFFF);
+    raster_rule(r, true, w * 0.5f, 2 * k, BLACK);
+    raster_rule(r, false, h * 0.5f, 2 * k, BLACK);
+    Vector2 arrows[] = {{2390, 1790}, {2400, 1800}, {2380, 1800}, {2390, 10}, {2400, 0}, {2380, 0}};
+    raster_strip(r, arrows, 3, k, BLACK);
+    raster_strip(r, arrows + 3, 3, k, BLACK);
+    for (int c = 0; c < n; ++c) raster_polyline(r, bench_curves[c].items, bench_curves[c].count, k, c == 0 ? 4 : 2, BLUE);
+    raster_end(r);
+}
+
+static double bench_bytes(Raster * r) {
+    size_t bins = 0;
+    for (int t = 0; t < r->bin_capacity; ++t) bins += r->bins[t].capacity * sizeof(uint32_t);
+    return (double)r->capacity * sizeof(uint32_t) + r->prims.capacity * sizeof(RasterPrim) +
+        r->bin_capacity * sizeof(RasterBin) + bins;
+}
+
+int main() {
+    struct {
+        const char * name;
+        int curves;
+        double waves;
+    } scenes[] = {
+        {"6 curves and axes", 6, 3},
+        {"40 oscillating curves", 40, 60},
+    };
+    printf("%-24s %10s %8s %12s %10s\n", "1200 x 900", "size", "ms", "raster MiB", "segments");
+    for (size_t s = 0; s < sizeof(scenes) / sizeof(scenes[0]); ++s) {
+        bench_scene(scenes[s].curves, scenes[s].waves);
+        for (int old = 0; old < 2; ++old) {
+            Raster r = {};
+            float k = old ? 1 : 0.5f;
+            bench_frame(&r, scenes[s].curves, k); // allocates
+            double t = bench_now();
+            for (int run = 0; run < BENCH_RUNS; ++run) bench_frame(&r, scenes[s].curves, k);
+            t = (bench_now() - t) / BENCH_RUNS;
+            printf("%-24s %10s %8.2f %12.1f %10zu\n", scenes[s].name, old ? "2x" : "1x", t * 1e3,
+                   bench_bytes(&r) / (1 << 20), r.prims.count);
+            raster_free(&r);
+        }
+    }
+    // the old target on the gpu: colour and a depth renderbuffer, 4 bytes each per texel
+    printf("the 2x RenderTexture held %.1f MiB on the gpu, the 1x texture holds %.1f MiB\n",
+           4.0 * BENCH_WIDTH * BENCH_HEIGHT * 8 / (1 << 20), 4.0 * BENCH_WIDTH * BENCH_HEIGHT / (1 << 20));
+    for (size_t c = 0; c < sizeof(bench_curves) / sizeof(bench_curves[0]); ++c) da_free(&bench_curves[c]);
+    field_pool_stop();
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "series.h"
+#include "bench.h"
+
+/*
+  a data series of 1 GiB (or the MiB given as the first argument): a random walk written
+  as a raw `.f64` file, mapped and its pyramid built, then frames of a 2400 px wide plot
+  zooming from the whole series into a few samples and panning across a hundredth of it.
+  the file goes into $TMPDIR and is removed at the end; the open runs on a warm page cache
+ */
+
+#define BENCH_WIDTH 2400
+#define BENCH_HEIGHT 1800
+#define BENCH_ZOOM_FRAMES 200
+#define BENCH_PAN_FRAMES 300
+#define BENCH_CHUNK (1 << 16) // pairs per write
+
+static uint64_t bench_rng = 0x9E3779B97F4A7C15ull;
+
+static double bench_step() { // xorshift, in [-0.5, 0.5)
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 7;
+    bench_rng ^= bench_rng << 17;
+    return (bench_rng >> 11) * 0x1p-53 - 0.5;
+}
+
+static int bench_write(const char * path, size_t count) {
+    FILE * f = fopen(path, "wb");
+    if (!f) return 1;
+    static double pairs[2 * BENCH_CHUNK];
+    double y = 0;
+    int err = 0;
+    for (size_t i = 0; i < count && !err;) {
+        size_t n = 0;
+        for (; n < BENCH_CHUNK && i < count; ++n, ++i) {
+            y += bench_step();
+            pairs[2 * n] = i * 1e-3;
+            pairs[2 * n + 1] = y;
+        }
+        err = fwrite(pairs, 2 * sizeof(double), n, f) != n;
+    }
+    return fclose(f) != 0 || err;
+}
+
+typedef struct {
+    double total, worst;
+    size_t points, frames;
+} BenchFrames;
+
+static void bench_frame(Series * s, Viewport vp, Polyline * out, BenchFrames * b) {
+    double t = bench_now();
+    series_sample(s, vp, BENCH_WIDTH, BENCH_HEIGHT, out);
+    t = bench_now() - t;
+    b->total += t;
+    if (t > b->worst) b->worst = t;
+    if (out->count > b->points) b->points = out->count;
+    b->frames += 1;
+}
+
+static void bench_report(const char * name, BenchFrames * b) {
+    printf("%-34s %10.3f %10.3f %10zu\n", name, b->total / b->frames * 1e3, b->worst * 1e3, b->points);
+}
+
+int main(int argc, char ** argv) {
+    size_t mib = argc > 1 ? strtoul(argv[1], NULL, 10) : 1024;
+    size_t count = mib * (1 << 20) / (2 * sizeof(double));
+    const char * dir = getenv("TMPDIR");
+    char path[SERIES_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/grapher-bench-series.f64", dir ? dir : "/tmp");
+
+    double t = bench_now();
+    if (count == 0 || bench_write(path, count)) {
+        printf("Failed to write %s\n", path);
+        remove(path);
+        return 1;
+    }
+    printf("wrote %zu samples (%zu MiB) in %.2f s\n", count, mib, bench_now() - t);
+    Series s;
+    t = bench_now();
+    if (series_open(path, &s)) {
+        printf("Failed to open %s\n", path);
+        remove(path);
+        return 1;
+    }
+    printf("open + pyramid: %.1f ms, %d levels\n", (bench_now() - t) * 1e3, s.n_levels);
+
+    double x0, x1, y0, y1;
+    series_bounds(&s, &x0, &x1, &y0, &y1);
+    Viewport whole = {.cx = dd_from((x0 + x1) * 0.5), .cy = dd_from((y0 + y1) * 0.5),
+                      .span_x = (x1 - x0) * 1.1, .span_y = (y1 - y0) * 1.1};
+    Polyline out = {};
+    printf("%-34s %10s %10s %10s\n", "per frame", "mean ms", "worst ms", "points");
+
+    // into a span of about 50 samples, anchored off centre
+    BenchFrames zoom = {};
+    Viewport vp = whole;
+    double factor = pow(0.05 / whole.span_x, 1.0 / BENCH_ZOOM_FRAMES);
+    for (int f = 0; f < BENCH_ZOOM_FRAMES; ++f) {
+        bench_frame(&s, vp, &out, &zoom);
+        viewport_zoom(&vp, factor, vp.span_x * 0.13, 0);
+    }
+    bench_report("zoom in, whole series to 50", &zoom);
+
+    // a hundredth of the series in view, a twentieth of the view per frame
+    BenchFrames pan = {};
+    vp = whole;
+    viewport_zoom(&vp, 0.01, -whole.span_x * 0.4, 0);
+    for (int f = 0; f < BENCH_PAN_FRAMES; ++f) {
+        bench_frame(&s, vp, &out, &pan);
+        viewport_pan(&vp, vp.span_x * 0.05, 0);
+    }
+    bench_report("pan, a hundredth in view", &pan);
+
+    da_free(&out);
+    series_close(&s);
+    remove(path);
+    return 0;
+}
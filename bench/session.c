@@ -0,0 +1,91 @@
+#include <stdio.h>
+
+#include "input.h"
+
+/*
+  writes the input session `make idle` replays paced, through the recorder itself:
+  raylib is replaced by a script of 60 frames a second, about 13 s of mostly idle time
+  around a click into the sidebar, typing an equation, a drag and a zoom in the plot
+ */
+
+#define SESSION_FRAMES 800
+#define SESSION_TEXT "sin(3x) / x"
+
+typedef struct {
+    Vector2 mouse, delta, wheel;
+    bool down, pressed, released; // left button
+    int key; // pressed this frame, held the next
+    bool key_down;
+    int c; // typed
+} SessionFrame;
+
+static SessionFrame g_frame;
+
+// what input.h calls, scripted
+int GetScreenWidth(void) { return 800; }
+int GetScreenHeight(void) { return 600; }
+void SetWindowSize(int width, int height) { (void)width; (void)height; }
+bool WindowShouldClose(void) { return false; }
+bool IsWindowResized(void) { return false; }
+Vector2 GetMousePosition(void) { return g_frame.mouse; }
+Vector2 GetMouseDelta(void) { return g_frame.delta; }
+Vector2 GetMouseWheelMoveV(void) { return g_frame.wheel; }
+bool IsMouseButtonDown(int button) { return button == MOUSE_BUTTON_LEFT && g_frame.down; }
+bool IsMouseButtonPressed(int button) { return button == MOUSE_BUTTON_LEFT && g_frame.pressed; }
+bool IsMouseButtonReleased(int button) { return button == MOUSE_BUTTON_LEFT && g_frame.released; }
+bool IsKeyDown(int key) { return key == g_frame.key && g_frame.key_down; }
+bool IsKeyPressed(int key) { return key == g_frame.key && g_frame.key_down; } // held one frame
+bool IsKeyReleased(int key) { return key != 0 && key == g_frame.key && !g_frame.key_down; }
+bool IsKeyPressedRepeat(int key) { (void)key; return false; }
+int GetCharPressed(void) { int c = g_frame.c; g_frame.c = 0; return c; }
+const char * GetClipboardText(void) { return NULL; }
+void SetClipboardText(const char * text) { (void)text; }
+float GetFrameTime(void) { return INPUT_REPLAY_DT; }
+double GetTime(void) { return 0; }
+void WaitTime(double seconds) { (void)seconds; }
+void EnableEventWaiting(void) {}
+void DisableEventWaiting(void) {}
+
+static void session_frame(int f) {
+    Vector2 mouse = g_frame.mouse;
+    g_frame = (SessionFrame) {.mouse = mouse};
+    int typed = (f - 150) / 8;
+    if (f == 120) { // select the first equation
+        g_frame.mouse = (Vector2) {100, 65};
+        g_frame.down = g_frame.pressed = true;
+    } else if (f == 121) {
+        g_frame.released = true;
+    } else if (f >= 150 && (f - 150) % 8 == 0 && typed < (int)sizeof(SESSION_TEXT) - 1) {
+        g_frame.c = SESSION_TEXT[typed];
+    } else if (f == 250 || f == 251) { // commit
+        g_frame.key = KEY_ENTER;
+        g_frame.key_down = f == 250;
+    } else if (f == 430) { // drag the plot
+        g_frame.mouse = (Vector2) {500, 350};
+        g_frame.down = g_frame.pressed = true;
+    } else if (f > 430 && f <= 490) {
+        g_frame.delta = (Vector2) {3, 1};
+        g_frame.mouse = (Vector2) {mouse.x + 3, mouse.y + 1};
+        g_frame.down = true;
+    } else if (f == 491) {
+        g_frame.released = true;
+    } else if (f >= 610 && f < 620) { // zoom out
+        g_frame.wheel = (Vector2) {0, -1};
+    }
+}
+
+int main(int argc, char ** argv) {
+    const char * path = argc > 1 ? argv[1] : "bench/session.gir";
+    if (input_record(path)) {
+        printf("Failed to open %s\n", path);
+        return 1;
+    }
+    for (int f = 0; f < SESSION_FRAMES; ++f) {
+        session_frame(f);
+        input_begin_frame();
+        input_end_frame();
+    }
+    input_close();
+    printf("%s: %d frames, %.1f s paced\n", path, SESSION_FRAMES, SESSION_FRAMES * INPUT_REPLAY_DT);
+    return 0;
+}
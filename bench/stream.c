@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "stream.h"
+#include "bench.h"
+
+/*
+  live ingest through a pipe: a writer thread prints `x y` lines at a fixed rate (or as
+  fast as it goes), x its monotonic clock, into the reader of `stream_start`; the render
+  loop is a 60 Hz sleep, a drain and the 2400 px decimation of `grapher`.
+  latency is from the line being written to the frame that drained it, so it includes
+  the wait for the next frame, half of one on average
+ */
+
+#define BENCH_SECONDS 1.0 // per rate
+#define BENCH_WIDTH 2400
+#define BENCH_HEIGHT 1800
+#define BENCH_BATCH 256 // lines per write at most
+
+typedef struct {
+    int fd;
+    double rate; // lines per second, 0: as fast as the pipe takes them
+    size_t written;
+} BenchWriter;
+
+typedef struct {
+    double * items;
+    size_t count;
+    size_t capacity;
+} BenchLatencies;
+
+static void bench_sleep(double seconds) {
+    struct timespec ts = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+    nanosleep(&ts, NULL);
+}
+
+static void * bench_writer(void * arg) {
+    BenchWriter * w = arg;
+    static char buf[BENCH_BATCH * 64];
+    double t0 = bench_now(), now;
+    while ((now = bench_now()) - t0 < BENCH_SECONDS) {
+        size_t due = w->rate > 0 ? (size_t)((now - t0) * w->rate) : w->written + BENCH_BATCH;
+        if (due <= w->written) {
+            bench_sleep(2e-4);
+            continue;
+        }
+        size_t len = 0, n = 0;
+        for (; w->written + n < due && n < BENCH_BATCH; ++n) {
+            len += snprintf(buf + len, sizeof(buf) - len, "%.9f %zu\n", bench_now(), w->written + n);
+        }
+        if (write(w->fd, buf, len) != (ssize_t)len) break;
+        w->written += n;
+    }
+    close(w->fd);
+    return NULL;
+}
+
+static int bench_cmp(const void * a, const void * b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main() {
+    static Stream s; // the ring is too big for the stack
+    static BenchLatencies lat;
+    Polyline out = {};
+    double rates[] = {1e3, 1e5, 0};
+    printf("%-12s %10s %12s %8s %10s %10s %10s %10s\n", "rate", "written", "consumed/s", "dropped",
+           "p50 ms", "p99 ms", "max ms", "frame max");
+    for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); ++r) {
+        int fds[2];
+        if (pipe(fds) != 0) return 1;
+        memset(&s, 0, sizeof(s));
+        if (stream_start(&s, fds[0])) return 1;
+        BenchWriter w = {fds[1], rates[r], 0};
+        pthread_t writer;
+        if (pthread_create(&writer, NULL, bench_writer, &w) != 0) return 1;
+
+        lat.count = 0;
+        size_t consumed = 0;
+        double t0 = bench_now(), next = t0, frame_max = 0;
+        while (!atomic_load(&s.eof) || !stream_idle(&s)) {
+            next += 1.0 / 60;
+            double now = bench_now();
+            if (next > now) bench_sleep(next - now);
+            double t = bench_now();
+            size_t n = stream_drain(&s);
+            for (size_t i = s.history_count - (n < s.history_count ? n : s.history_count); i < s.history_count; ++i) {
+                da_append(&lat, t - s.history[(s.history_begin + i) & (STREAM_HISTORY - 1)].x);
+            }
+            consumed += n;
+            StreamSample last;
+            if (stream_last(&s, &last)) {
+                Viewport vp = {.cx = dd_from(last.x - 0.4), .cy = dd_from(0), .span_x = 1, .span_y = 2e6};
+                stream_sample(&s, vp, BENCH_WIDTH, BENCH_HEIGHT, &out);
+            }
+            t = bench_now() - t;
+            if (t > frame_max) frame_max = t;
+        }
+        double elapsed = bench_now() - t0;
+        pthread_join(writer, NULL);
+        size_t dropped = atomic_load(&s.dropped);
+        stream_stop(&s);
+        close(fds[0]);
+
+        char name[16];
+        snprintf(name, sizeof(name), rates[r] > 0 ? "%.0f/s" : "unthrottled", rates[r]);
+        qsort(lat.items, lat.count, sizeof(double), bench_cmp);
+        double p50 = lat.count ? lat.items[lat.count / 2] : NAN, p99 = lat.count ? lat.items[lat.count * 99 / 100] : NAN;
+        double max = lat.count ? lat.items[lat.count - 1] : NAN;
+        printf("%-12s %10zu %12.0f %8zu %10.2f %10.2f %10.2f %10.2f\n", name, w.written, consumed / elapsed, dropped,
+               p50 * 1e3, p99 * 1e3, max * 1e3, frame_max * 1e3);
+    }
+    da_free(&lat);
+    da_free(&out);
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "surface.h"
+#include "bench.h"
+
+/*
+  the 3d surface without a window: `release` is NULL, so the meshes stay cpu arrays.
+  checks the triangle count against the chunk details, which updates rebuild what,
+  and that neighbouring chunks meet along every seam, stitched edges included;
+  exits with 1 if anything is off
+ */
+
+#define BENCH_SEAM_TOL 1e-5 // world units
+
+static int g_failed = 0;
+
+static void bench_check(bool ok, const char * what) {
+    printf("%-52s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) g_failed = 1;
+}
+
+static SurfaceChunk * bench_chunk(Surface * s, int64_t i, int64_t j) {
+    for (size_t k = 0; k < s->count; ++k) {
+        if (s->items[k].used && s->items[k].i == i && s->items[k].j == j) return s->items + k;
+    }
+    return NULL;
+}
+
+// world position of vertex `a, b` of a chunk
+static Vector3 bench_vertex(Surface * s, SurfaceChunk * c, int a, int b) {
+    float ox, oz;
+    surface_chunk_offset(s, c, &ox, &oz);
+    int n = SURFACE_CHUNK_QUADS >> c->lod;
+    float * v = c->mesh.vertices + 3 * (b * (n + 1) + a);
+    return (Vector3) {ox + v[0], v[1], oz + v[2]};
+}
+
+// every vertex on the edge of `c` lies on the other chunk's edge, linear between its vertices;
+// `vertical`: the edge is the column `a` (else the row `b`) of `c` at `at`, of `o` at `o_at`
+static double bench_seam(Surface * s, SurfaceChunk * c, int at, SurfaceChunk * o, int o_at, bool vertical) {
+    int n = SURFACE_CHUNK_QUADS >> c->lod, m = SURFACE_CHUNK_QUADS >> o->lod;
+    double worst = 0;
+    for (int k = 0; k <= n; ++k) {
+        double t = (double)k * m / n;
+        int k0 = (int)floor(t), k1 = k0 < m ? k0 + 1 : m;
+        double f = t - k0;
+        Vector3 p = vertical ? bench_vertex(s, c, at, k) : bench_vertex(s, c, k, at);
+        Vector3 q0 = vertical ? bench_vertex(s, o, o_at, k0) : bench_vertex(s, o, k0, o_at);
+        Vector3 q1 = vertical ? bench_vertex(s, o, o_at, k1) : bench_vertex(s, o, k1, o_at);
+        double d[3] = {p.x - (q0.x + (q1.x - q0.x) * f), p.y - (q0.y + (q1.y - q0.y) * f), p.z - (q0.z + (q1.z - q0.z) * f)};
+        for (int e = 0; e < 3; ++e) worst = fmax(worst, fabs(d[e]));
+    }
+    return worst;
+}
+
+static double bench_seams(Surface * s, size_t * seams, size_t * stitched) {
+    double worst = 0;
+    *seams = *stitched = 0;
+    for (size_t k = 0; k < s->count; ++k) {
+        SurfaceChunk * c = s->items + k;
+        if (!c->used) continue;
+        int n = SURFACE_CHUNK_QUADS >> c->lod;
+        SurfaceChunk * right = bench_chunk(s, c->i + 1, c->j), * up = bench_chunk(s, c->i, c->j + 1);
+        if (right) {
+            worst = fmax(worst, fmax(bench_seam(s, c, n, right, 0, true), bench_seam(s, right, 0, c, n, true)));
+            *seams += 1;
+            *stitched += right->lod != c->lod;
+        }
+        if (up) {
+            worst = fmax(worst, fmax(bench_seam(s, c, n, up, 0, false), bench_seam(s, up, 0, c, n, false)));
+            *seams += 1;
+            *stitched += up->lod != c->lod;
+        }
+    }
+    return worst;
+}
+
+static size_t bench_expected_triangles(Surface * s) {
+    size_t t = 0;
+    for (size_t k = 0; k < s->count; ++k) {
+        if (!s->items[k].used) continue;
+        size_t n = SURFACE_CHUNK_QUADS >> s->items[k].lod;
+        t += 2 * n * n;
+    }
+    return t;
+}
+
+int main() {
+    double params[PARAM_COUNT] = {};
+    bench_quiet(true);
+    Program * prog = program_cache_get("sin(x * y) + cos(x) / 2");
+    bench_quiet(false);
+    Surface s = {};
+    Viewport vp = viewport_default();
+    Vector3 camera = {1.7f, 1.8f, 2.1f}; // the default orbit, about
+
+    surface_update(&s, (SurfaceJob) {prog, params, vp, camera});
+    printf("first build: %zu chunks, %zu triangles in %.2f ms\n", s.chunks, s.triangles, s.build_ms);
+    bench_check(s.rebuilt == s.chunks, "every chunk built");
+    bench_check(s.triangles == bench_expected_triangles(&s), "triangles: 2 per quad at each chunk's detail");
+    size_t seams, stitched;
+    double worst = bench_seams(&s, &seams, &stitched);
+    char line[128];
+    snprintf(line, sizeof(line), "%zu seams meet (%zu stitched), worst %.1e", seams, stitched, worst);
+    bench_check(stitched > 0 && worst < BENCH_SEAM_TOL, line);
+
+    surface_update(&s, (SurfaceJob) {prog, params, vp, camera});
+    bench_check(s.rebuilt == 0, "same view: nothing rebuilt");
+
+    viewport_pan(&vp, ldexp(1, s.ex) * 0.25, 0);
+    surface_update(&s, (SurfaceJob) {prog, params, vp, camera});
+    snprintf(line, sizeof(line), "pan a quarter chunk: %zu of %zu rebuilt in %.2f ms", s.rebuilt, s.chunks, s.build_ms);
+    bench_check(s.rebuilt > 0 && s.rebuilt < s.chunks, line);
+    worst = bench_seams(&s, &seams, &stitched);
+    snprintf(line, sizeof(line), "after the pan, %zu seams meet, worst %.1e", seams, worst);
+    bench_check(worst < BENCH_SEAM_TOL, line);
+
+    camera.x += 0.05f;
+    surface_update(&s, (SurfaceJob) {prog, params, vp, camera});
+    snprintf(line, sizeof(line), "camera nudged: %zu of %zu rebuilt", s.rebuilt, s.chunks);
+    bench_check(s.rebuilt < s.chunks, line);
+
+    surface_invalidate(&s);
+    surface_update(&s, (SurfaceJob) {prog, params, vp, camera});
+    snprintf(line, sizeof(line), "invalidated: %zu of %zu rebuilt in %.2f ms", s.rebuilt, s.chunks, s.build_ms);
+    bench_check(s.rebuilt == s.chunks && s.triangles == bench_expected_triangles(&s), line);
+
+    surface_free(&s);
+    program_release(prog);
+    program_cache_free();
+    field_pool_stop();
+    return g_failed;
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "text.h"
+
+/*
+  text submissions and draw calls in a typical frame: the sidebar with 24 rows, the editor,
+  the axis labels and the stats overlay, in the order main.c draws them.
+  rlgl is replaced by counters that merge draws the way its render batch does: a new draw
+  call when the texture changes, and a flush at every scissor change.
+  before: one `DrawTexturePro` per glyph, as `DrawTextEx` did; after: one batch per string
+ */
+
+#define BENCH_FRAMES 100
+#define BENCH_TEX_SHAPES 1 // rlgl's white texture, rectangles
+#define BENCH_TEX_FONT 2
+#define BENCH_TEX_CANVAS 3 // the rasterized plot
+
+typedef struct {
+    size_t submissions; // rlBegin .. rlEnd
+    size_t draws; // draw calls the batch would issue
+    size_t vertices;
+    unsigned int texture; // of the current draw, 0 for none
+} BenchGL;
+
+static BenchGL g_gl;
+static GlyphInfo bench_glyphs[128];
+static Rectangle bench_recs[128];
+
+// what text.h calls, counted
+int GetGlyphIndex(Font font, int codepoint) { (void)font; return codepoint & 127; }
+bool rlCheckRenderBatchLimit(int count) { (void)count; return false; }
+void rlSetTexture(unsigned int id) {
+    if (id == 0 || id == g_gl.texture) return;
+    g_gl.draws += 1;
+    g_gl.texture = id;
+}
+void rlBegin(int mode) { (void)mode; g_gl.submissions += 1; }
+void rlEnd(void) {}
+void rlColor4ub(unsigned char r, unsigned char g, unsigned char b, unsigned char a) { (void)r; (void)g; (void)b; (void)a; }
+void rlTexCoord2f(float x, float y) { (void)x; (void)y; }
+void rlVertex2f(float x, float y) { (void)x; (void)y; g_gl.vertices += 1; }
+
+static void bench_flush() { // `BeginScissorMode` and `EndScissorMode` draw what is batched
+    g_gl.texture = 0;
+}
+
+static void bench_quad(unsigned int texture) { // `DrawRectangle`, `DrawTexturePro`
+    rlSetTexture(texture);
+    rlBegin(RL_QUADS);
+    for (int k = 0; k < 4; ++k) rlVertex2f(0, 0);
+    rlEnd();
+    rlSetTexture(0);
+}
+
+static void bench_text(Font font, const char * str, Vector2 pos, int size, bool before) {
+    if (!before) {
+        text_draw(font, str, strlen(str), pos, size, BLACK);
+        return;
+    }
+    for (const char * c = str; *c; ++c) {
+        if (*c != ' ' && *c != '\t') bench_quad(BENCH_TEX_FONT);
+    }
+}
+
+static const char * bench_rows[] = {
+    "sin(x)", "a = 2.000", "x^2 - 3x + 1 | 0, 2", "(cos(3t), sin(2t))", "r = 1 + cos(theta)",
+    "a * exp(-x^2 / 2)", "x < 0 ? -x : x", "z = sin(x * y)",
+};
+
+static const char * bench_overlay[] = {
+    "60 frames in the last second, ui 1.204 ms, 24 equations, polling",
+    "text: 106 batches for 860 glyph quads, one submission each before",
+    "text layouts: 0 new this frame",
+    "program cache: 312 hits, 24 misses, 24 entries",
+    "compiled: 211 tree nodes into 148 ops",
+    "curves: 3 resampled (2400 points), 21 drawn",
+    "data: 0 samples in view, 0 points drawn",
+    "raster: 64 primitives in 0.81 ms",
+    "axes: 14 labels in 0.004 ms, 14 formatted, 13986 cached draws",
+    "fields: 0 cells in 0.00 ms (0.0 Mpx/s)",
+    "integrals: 2100 hits, 1 misses, 341 evaluations",
+    "surface: 0 chunks, 0 rebuilt, 0 triangles in 0.00 ms",
+    "stream: 0 lines, 0 dropped, 0 kept, 0 in view",
+};
+
+static const char * bench_labels[] = {
+    "-10", "-5", "5", "10", "-7.5", "-2.5", "2.5", "7.5", "-4", "-2", "2", "4", "-6", "6",
+};
+
+static void bench_frame(Font font, bool before) {
+    int row_size = 20, size = 14;
+    // sidebar
+    bench_flush();
+    bench_quad(BENCH_TEX_SHAPES);
+    bench_text(font, "+", (Vector2) {8, 8}, row_size, before);
+    bench_quad(BENCH_TEX_SHAPES);
+    bench_text(font, "-", (Vector2) {40, 8}, row_size, before);
+    bench_flush();
+    for (int row = 0; row < 24; ++row) {
+        const char * text = bench_rows[row % (sizeof(bench_rows) / sizeof(bench_rows[0]))];
+        bench_quad(BENCH_TEX_SHAPES);
+        if (strchr(text, '|')) bench_text(font, "= 0.666667", (Vector2) {120, row * 28.0f}, row_size, before);
+        if (text[0] == 'a') { // slider and its play button
+            bench_quad(BENCH_TEX_SHAPES);
+            bench_quad(BENCH_TEX_SHAPES);
+            bench_text(font, ">", (Vector2) {170, row * 28.0f}, row_size, before);
+        }
+        bench_text(font, text, (Vector2) {16, row * 28.0f}, row_size, before);
+    }
+    bench_flush();
+    bench_flush();
+    bench_quad(BENCH_TEX_SHAPES); // separator
+    // editor
+    bench_flush();
+    bench_text(font, "x^2 - 3x + 1 | 0, 2", (Vector2) {210, 10}, row_size, before);
+    bench_quad(BENCH_TEX_SHAPES); // cursor
+    bench_flush();
+    bench_quad(BENCH_TEX_SHAPES);
+    // plot, its labels and the overlay
+    bench_quad(BENCH_TEX_CANVAS);
+    bench_text(font, "float", (Vector2) {760, 580}, size, before);
+    for (size_t i = 0; i < sizeof(bench_labels) / sizeof(bench_labels[0]); ++i) {
+        bench_text(font, bench_labels[i], (Vector2) {300 + i * 30.0f, 400}, size, before);
+    }
+    for (size_t i = 0; i < sizeof(bench_overlay) / sizeof(bench_overlay[0]); ++i) {
+        bench_text(font, bench_overlay[i], (Vector2) {208, 108 + i * 14.0f}, size, before);
+    }
+    bench_flush();
+}
+
+int main() {
+    Font font = {.baseSize = 20, .glyphCount = 128, .texture = {.id = BENCH_TEX_FONT, .width = 1024, .height = 20},
+                 .recs = bench_recs, .glyphs = bench_glyphs};
+    for (int i = 0; i < 128; ++i) {
+        bench_glyphs[i] = (GlyphInfo) {.value = i, .advanceX = 10};
+        bench_recs[i] = (Rectangle) {i * 8, 0, 8, 20};
+    }
+
+    printf("%-10s %12s %12s %10s\n", "per frame", "submissions", "draw calls", "vertices");
+    for (int before = 1; before >= 0; --before) {
+        bench_frame(font, before); // lays out every string once
+        g_gl = (BenchGL) {};
+        for (int f = 0; f < BENCH_FRAMES; ++f) bench_frame(font, before);
+        printf("%-10s %12zu %12zu %10zu\n", before ? "before" : "after", g_gl.submissions / BENCH_FRAMES,
+               g_gl.draws / BENCH_FRAMES, g_gl.vertices / BENCH_FRAMES);
+    }
+    text_cache_clear();
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "workspace.h"
+#include "bench.h"
+
+/*
+  cold start of a workspace of 10k equations: the binary file, whose programs are mapped
+  into the cache, against the text file, which parses and compiles every line again.
+  cold means an empty program cache; the files are in the page cache, written just before.
+  the parser's traces go to /dev/null during the loads, as they would without a terminal
+ */
+
+#define BENCH_EQUATIONS 10000
+#define BENCH_RUNS 5
+
+static void bench_add(Equations * eqs, const char * text) {
+    Equation eq = {.editor = string_createFrom(text)};
+    equation_commit(&eq);
+    eqs_add(eqs, eq);
+}
+
+// best of `BENCH_RUNS` cold loads, with the cache misses of the last one
+static double bench_load(const char * path, bool text, size_t * misses, size_t * loaded) {
+    double best = INFINITY;
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        Equations eqs = {.selected = -1};
+        Viewport vp = viewport_default();
+        size_t before = g_program_cache.misses;
+        bench_quiet(true);
+        double t = bench_now();
+        int failed = (text ? workspace_load_text : workspace_load)(path, &eqs, &vp);
+        t = bench_now() - t;
+        bench_quiet(false);
+        if (failed) return NAN;
+        if (t < best) best = t;
+        *misses = g_program_cache.misses - before;
+        *loaded = eqs.order.count;
+        eqs_free(&eqs);
+        program_cache_free();
+        workspace_unmap_all();
+    }
+    return best;
+}
+
+int main() {
+    const char * dir = getenv("TMPDIR");
+    char bin[512], txt[512];
+    snprintf(bin, sizeof(bin), "%s/grapher-bench.gws", dir ? dir : "/tmp");
+    snprintf(txt, sizeof(txt), "%s/grapher-bench.gws.txt", dir ? dir : "/tmp");
+
+    Equations eqs = {.selected = -1};
+    char text[128];
+    bench_quiet(true);
+    bench_add(&eqs, "a = 1");
+    bench_add(&eqs, "b = a / 2");
+    bench_add(&eqs, "sin(x"); // invalid, cached as such
+    for (int k = 3; k < BENCH_EQUATIONS; ++k) {
+        snprintf(text, sizeof(text), "%d sin(x + %d) / %d + a * x^%d - b", k % 7 + 1, k, k % 13 + 1, k % 5);
+        bench_add(&eqs, text);
+    }
+    eqs_rebuild_params(&eqs);
+    bench_quiet(false);
+    Viewport vp = viewport_default();
+    if (workspace_save(bin, &eqs, vp) || workspace_save_text(txt, &eqs, vp)) {
+        printf("Failed to write the workspaces to %s\n", dir ? dir : "/tmp");
+        return 1;
+    }
+    eqs_free(&eqs);
+    program_cache_free();
+
+    printf("%-22s %10s %10s %12s\n", "10k equations, cold", "ms", "misses", "equations");
+    size_t misses = 0, loaded = 0;
+    double t = bench_load(bin, false, &misses, &loaded);
+    printf("%-22s %10.2f %10zu %12zu\n", "binary, mapped", t * 1e3, misses, loaded);
+    t = bench_load(txt, true, &misses, &loaded);
+    printf("%-22s %10.2f %10zu %12zu\n", "text, reparsed", t * 1e3, misses, loaded);
+    remove(bin);
+    remove(txt);
+    return 0;
+}
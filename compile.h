@@ -0,0 +1,1110 @@
+#ifndef COMPILE_H_
+#define COMPILE_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t, uint64_t
+#include <stdlib.h> // malloc, free
+#include <string.h> // strlen, strcmp, memcpy
+#include <math.h>
+#include <complex.h>
+
+#include "dynarray.h"
+#include "precision.h"
+#include "equation.h"
+
+
+/* Program */
+
+// flat postfix form of an `ExprNode` tree, evaluated on a value stack
+typedef enum {
+    OP_CONST, // push imm, arg: 0 for a literal, 1 + BVarType for a named constant
+    OP_X, // the input, see `inputs`
+    OP_Y, // second input, only the field evaluator has one
+    OP_VAR, // arg: parameter slot, read from the `params` passed to eval
+    OP_FUNC, // arg: BFuncType
+    OP_POWI, // integer power by repeated multiplication, arg: exponent as int32_t
+    OP_POLY, // push a polynomial in the input, arg: degree n, the n + 1 OP_COEF that follow hold c0..cn
+    // binary, pop two push one
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD,
+    OP_LT, OP_LE, OP_EQ, OP_NE, OP_AND, OP_OR, // 1 or 0, `a > b` is emitted as `b < a`
+    OP_FUNC2, // arg: BFuncType, n-ary builtins are chained: min(a, b, c) = min(min(a, b), c)
+    OP_NEG, OP_NOT,
+    // `c ? a : b` is `c OP_IF a OP_ELSE b OP_END`, arg: forward distance to the matching
+    // OP_ELSE / OP_END. scalar evaluators branch, see `program_eval_batch` for blocks
+    OP_IF, OP_ELSE, OP_END,
+    OP_COEF, // data for OP_POLY, never dispatched
+} OpCode;
+#define op_is_binary(op) ((op) >= OP_ADD && (op) <= OP_FUNC2)
+
+typedef struct {
+    uint32_t op;
+    uint32_t arg;
+    double imm;
+} Instr;
+
+enum {
+    INPUT_X = 1,
+    INPUT_T = 2, // `t` or `θ`
+    INPUT_Y = 4, // fields only, always `OP_Y`
+};
+
+#define PROGRAM_MAX_DEPTH 32 // value stack, also bounds the batch scratch space
+#define PROGRAM_POWI_MAX 64 // larger literal exponents go through pow
+#define POLY_MAX_DEGREE 32
+#define POLY_MAX_NESTING 64 // deeper trees are compiled as they are
+#define EVAL_BLOCK 256 // batch evaluation block
+
+typedef struct Program {
+    Instr * items;
+    size_t count;
+    size_t capacity;
+
+    size_t max_depth;
+    uint64_t deps; // bit i set if parameter slot i is read
+    uint32_t inputs; // INPUT_*, which names `OP_X` was compiled from
+    bool valid; // invalid programs are cached too, so bad text is not reparsed
+    bool mapped; // `items` and `text` point into a workspace mapping, see workspace.h
+
+    // cache bookkeeping
+    uint64_t hash;
+    char * text;
+    size_t refs;
+} Program;
+
+int program_compile(Program * prog, ExprNode node); // return 1 on failure
+// `params`: PARAM_COUNT values, indexed by parameter slot
+float program_eval_f(Program * prog, const double * params, float x);
+double program_eval_d(Program * prog, const double * params, double x);
+ddouble program_eval_dd(Program * prog, const double * params, ddouble x);
+void program_eval_batch_f(Program * prog, const double * params, const float * xs, float * ys, size_t n);
+void program_eval_batch_d(Program * prog, const double * params, const double * xs, double * ys, size_t n);
+void program_eval_field_d(Program * prog, const double * params, const double * xs, const double * ys, double * out, size_t n);
+double complex program_eval_c(Program * prog, const double * params, double complex z);
+int program_verify(Program * prog); // return 1 if `prog` could read out of bounds when evaluated
+void program_free(Program * prog);
+
+static int program_emit(Program * prog, ExprNode node, size_t depth);
+static int program_emit_cond(Program * prog, ExprNode node, size_t depth);
+
+// integer literal, possibly negated: x^3, x^-2, pow(x, 4)
+static bool program_int_literal(ExprNode node, int * n) {
+    int sign = 1;
+    while (node.self.type == TT_UNPRECOP && node.count == 1) {
+        if (node.self.as.unprecop == UPOP_MINUS) sign = -sign;
+        node = node.items[0];
+    }
+    if (node.self.type != TT_NUMBER) return false;
+    double v = node.self.as.number;
+    if (v != floor(v) || fabs(v) > PROGRAM_POWI_MAX) return false;
+    *n = sign * (int)v;
+    return true;
+}
+
+/*
+  polynomial detection: a subtree built from the input, constants, + - *, division by a
+  constant and integer powers is folded into coefficients, then evaluated in one op
+  instead of multiplying the input over and over (expanded form, see `poly_mul`).
+  a rational function p / q ends up as two OP_POLY and an OP_DIV, since the division
+  node itself is not a polynomial. coefficients are folded in double, including `pi` and `e`
+ */
+typedef struct {
+    double c[POLY_MAX_DEGREE + 1]; // c[k] x^k
+    int degree;
+    uint32_t inputs; // INPUT_*, 0 for a constant
+    size_t nodes; // tree nodes covered
+} Poly;
+
+bool g_poly_fold = true; // false compiles polynomials node by node, to compare against
+
+static void poly_trim(Poly * p) {
+    while (p->degree > 0 && p->c[p->degree] == 0) p->degree -= 1;
+}
+
+static bool poly_is_monomial(const Poly * p) {
+    int terms = 0;
+    for (int k = 0; k <= p->degree; ++k) terms += p->c[k] != 0;
+    return terms <= 1;
+}
+
+// products of sums are not expanded: (x-1)(x-2)...(x-8) in expanded form cancels badly
+// near its roots, in float visibly so. they stay products of smaller polynomials
+static bool poly_mul(Poly * a, const Poly * b) {
+    if (a->degree + b->degree > POLY_MAX_DEGREE) return false;
+    if (!poly_is_monomial(a) && !poly_is_monomial(b)) return false;
+    double c[POLY_MAX_DEGREE + 1] = {};
+    for (int i = 0; i <= a->degree; ++i) {
+        for (int j = 0; j <= b->degree; ++j) c[i + j] += a->c[i] * b->c[j];
+    }
+    a->degree += b->degree;
+    memcpy(a->c, c, sizeof(c));
+    a->inputs |= b->inputs;
+    a->nodes += b->nodes;
+    poly_trim(a);
+    return true;
+}
+
+// return false if `node` is not a polynomial with constant coefficients
+static bool poly_of(ExprNode node, Poly * p, int nesting) {
+    if (nesting > POLY_MAX_NESTING) return false;
+    *p = (Poly) {.nodes = 1};
+    switch (node.self.type) {
+    case TT_NONE:
+        if (node.count != 1) return false;
+        return poly_of(node.items[0], p, nesting + 1);
+    case TT_NUMBER:
+        p->c[0] = node.self.as.number;
+        return true;
+    case TT_BVAR:
+        switch (node.self.as.bvar) {
+        case BVAR_PI: p->c[0] = M_PI; return true;
+        case BVAR_E: p->c[0] = M_E; return true;
+        case BVAR_X: p->inputs = INPUT_X; break;
+        case BVAR_T: case BVAR_THETA: case BVAR_THETA_SYM: p->inputs = INPUT_T; break;
+        default: return false;
+        }
+        p->c[1] = 1;
+        p->degree = 1;
+        return true;
+    case TT_UNPRECOP:
+        if (node.count != 1 || node.self.as.unprecop == UPOP_NOT ||
+            !poly_of(node.items[0], p, nesting + 1)) return false;
+        if (node.self.as.unprecop == UPOP_MINUS) {
+            for (int k = 0; k <= p->degree; ++k) p->c[k] = -p->c[k];
+        }
+        p->nodes += 1;
+        return true;
+    case TT_BFUNC:
+        if (node.self.as.bfunc != BFUNC_POW || node.count != 2) return false;
+        // fallthrough
+    case TT_BINOP: {
+        if (node.count != 2) return false;
+        bool is_pow = node.self.type == TT_BFUNC || node.self.as.binop == BINOP_POW;
+        int n;
+        if (is_pow) {
+            if (!program_int_literal(node.items[1], &n) || n < 0 ||
+                !poly_of(node.items[0], p, nesting + 1)) return false;
+            Poly base = *p;
+            base.nodes = 0;
+            *p = (Poly) {.c = {1}, .inputs = base.inputs, .nodes = 2 + p->nodes};
+            for (int k = 0; k < n; ++k) {
+                if (!poly_mul(p, &base)) return false;
+            }
+            return true;
+        }
+        Poly r;
+        if (!poly_of(node.items[0], p, nesting + 1) || !poly_of(node.items[1], &r, nesting + 1)) return false;
+        switch (node.self.as.binop) {
+        case BINOP_PLUS: case BINOP_MINUS: {
+            double sign = node.self.as.binop == BINOP_PLUS ? 1 : -1;
+            if (r.degree > p->degree) {
+                for (int k = p->degree + 1; k <= r.degree; ++k) p->c[k] = 0;
+                p->degree = r.degree;
+            }
+            for (int k = 0; k <= r.degree; ++k) p->c[k] += sign * r.c[k];
+            p->inputs |= r.inputs;
+            p->nodes += r.nodes;
+            poly_trim(p);
+        } break;
+        case BINOP_MULT:
+            if (!poly_mul(p, &r)) return false;
+            break;
+        case BINOP_DIV:
+            if (r.inputs || r.c[0] == 0) return false; // rational, handled by the caller
+            for (int k = 0; k <= p->degree; ++k) p->c[k] /= r.c[0];
+            p->nodes += r.nodes;
+            break;
+        default: return false;
+        }
+        p->nodes += 1;
+        return true;
+    }
+    default: return false;
+    }
+}
+
+static int program_emit_pow(Program * prog, ExprNode base, ExprNode exponent, size_t depth) {
+    int n;
+    if (program_int_literal(exponent, &n)) {
+        // the batch kernel keeps the running square one slot above
+        if (depth + 2 > PROGRAM_MAX_DEPTH) return 1;
+        if (depth + 2 > prog->max_depth) prog->max_depth = depth + 2;
+        if (program_emit(prog, base, depth)) return 1;
+        da_append(prog, ((Instr) {OP_POWI, (uint32_t)n}));
+        return 0;
+    }
+    if (program_emit(prog, base, depth) || program_emit(prog, exponent, depth + 1)) return 1;
+    da_append(prog, ((Instr) {OP_FUNC2, BFUNC_POW}));
+    return 0;
+}
+
+// a single term `c x^n` as OP_POWI, which squares where Horner would take n passes
+static int program_emit_monomial(Program * prog, const Poly * p, size_t depth) {
+    if (depth + 2 > PROGRAM_MAX_DEPTH) return 1;
+    if (depth + 2 > prog->max_depth) prog->max_depth = depth + 2;
+    da_append(prog, ((Instr) {OP_X}));
+    da_append(prog, ((Instr) {OP_POWI, (uint32_t)p->degree}));
+    if (p->c[p->degree] != 1) {
+        da_append(prog, ((Instr) {OP_CONST, 0, p->c[p->degree]}));
+        da_append(prog, ((Instr) {OP_MUL}));
+    }
+    prog->inputs |= p->inputs;
+    return 0;
+}
+
+// `a` and `b` are emitted one and two slots above `c`: a block with lanes going both
+// ways keeps all three on the stack and blends them at OP_END
+static int program_emit_cond(Program * prog, ExprNode node, size_t depth) {
+    if ((node.count != 2 && node.count != 3) || program_emit(prog, node.items[0], depth)) return 1;
+    size_t at_if = prog->count;
+    da_append(prog, ((Instr) {OP_IF}));
+    if (program_emit(prog, node.items[1], depth + 1)) return 1;
+    size_t at_else = prog->count;
+    da_append(prog, ((Instr) {OP_ELSE}));
+    if (node.count == 3 ? program_emit(prog, node.items[2], depth + 2)
+        : program_emit(prog, (ExprNode) {.self = {TT_NUMBER, {.number = NAN}}}, depth + 2)) return 1;
+    prog->items[at_if].arg = at_else - at_if;
+    prog->items[at_else].arg = prog->count - at_else;
+    da_append(prog, ((Instr) {OP_END}));
+    return 0;
+}
+
+static int program_emit(Program * prog, ExprNode node, size_t depth) {
+    if (depth + 1 > PROGRAM_MAX_DEPTH) return 1;
+    if (depth + 1 > prog->max_depth) prog->max_depth = depth + 1;
+
+    // a lone input or constant stays as it is, anything bigger in the input becomes one op
+    Poly poly;
+    if (g_poly_fold && node.count > 0 && poly_of(node, &poly, 0) && poly.inputs && poly.nodes > 1 &&
+        (poly.degree > 1 || !poly_is_monomial(&poly))) { // `2x` or `x / 3` are fine as they are
+        if (poly_is_monomial(&poly)) return program_emit_monomial(prog, &poly, depth);
+        da_append(prog, ((Instr) {OP_POLY, poly.degree}));
+        for (int k = 0; k <= poly.degree; ++k) da_append(prog, ((Instr) {OP_COEF, 0, poly.c[k]}));
+        prog->inputs |= poly.inputs;
+        return 0;
+    }
+
+    switch (node.self.type) {
+    case TT_NONE: // redundant layer
+        if (node.count != 1) return 1;
+        return program_emit(prog, node.items[0], depth);
+    case TT_NUMBER:
+        da_append(prog, ((Instr) {OP_CONST, 0, node.self.as.number}));
+        return 0;
+    case TT_BVAR:
+        switch (node.self.as.bvar) {
+        case BVAR_PI: da_append(prog, ((Instr) {OP_CONST, 1 + BVAR_PI, M_PI})); return 0;
+        case BVAR_E: da_append(prog, ((Instr) {OP_CONST, 1 + BVAR_E, M_E})); return 0;
+        // one input slot per program: `x` for graphs, `t` or `θ` for curves
+        case BVAR_X:
+            da_append(prog, ((Instr) {OP_X}));
+            prog->inputs |= INPUT_X;
+            return 0;
+        case BVAR_T: case BVAR_THETA: case BVAR_THETA_SYM:
+            da_append(prog, ((Instr) {OP_X}));
+            prog->inputs |= INPUT_T;
+            return 0;
+        case BVAR_Y:
+            da_append(prog, ((Instr) {OP_Y}));
+            prog->inputs |= INPUT_Y;
+            return 0;
+        default: return 1;
+        }
+    case TT_VAR:
+        da_append(prog, ((Instr) {OP_VAR, node.self.as.var}));
+        prog->deps |= 1ull << node.self.as.var;
+        return 0;
+    case TT_BFUNC: {
+        int arity = bfunc_arity(node.self.as.bfunc);
+        if (arity > 0 ? (int)node.count != arity : node.count < 2) return 1;
+        if (arity == 1) {
+            if (program_emit(prog, node.items[0], depth)) return 1;
+            da_append(prog, ((Instr) {OP_FUNC, node.self.as.bfunc}));
+            return 0;
+        }
+        if (node.self.as.bfunc == BFUNC_POW) return program_emit_pow(prog, node.items[0], node.items[1], depth);
+        if (program_emit(prog, node.items[0], depth)) return 1;
+        for (size_t i = 1; i < node.count; ++i) {
+            if (program_emit(prog, node.items[i], depth + 1)) return 1;
+            da_append(prog, ((Instr) {OP_FUNC2, node.self.as.bfunc}));
+        }
+        return 0;
+    }
+    case TT_BINOP: {
+        if (node.count == 2 && node.self.as.binop == BINOP_POW) {
+            return program_emit_pow(prog, node.items[0], node.items[1], depth);
+        }
+        if (node.self.as.binop == BINOP_COND) return program_emit_cond(prog, node, depth);
+        // operands swapped, the stack does not care which side is evaluated first
+        bool swap = node.self.as.binop == BINOP_GE || node.self.as.binop == BINOP_GT;
+        if (node.count != 2 || node.self.as.binop > BINOP_OR ||
+            program_emit(prog, node.items[swap], depth) ||
+            program_emit(prog, node.items[!swap], depth + 1)) return 1;
+        static const OpCode binops[] = {
+            [BINOP_PLUS] = OP_ADD, [BINOP_MINUS] = OP_SUB,
+            [BINOP_MULT] = OP_MUL, [BINOP_DIV] = OP_DIV, [BINOP_MOD] = OP_MOD,
+            [BINOP_LE] = OP_LE, [BINOP_GE] = OP_LE, [BINOP_LT] = OP_LT, [BINOP_GT] = OP_LT,
+            [BINOP_EQ] = OP_EQ, [BINOP_NE] = OP_NE, [BINOP_AND] = OP_AND, [BINOP_OR] = OP_OR,
+        };
+        da_append(prog, ((Instr) {binops[node.self.as.binop]}));
+        return 0;
+    }
+    case TT_UNPRECOP:
+        if (node.count != 1 || program_emit(prog, node.items[0], depth)) return 1;
+        if (node.self.as.unprecop == UPOP_MINUS) da_append(prog, ((Instr) {OP_NEG}));
+        if (node.self.as.unprecop == UPOP_NOT) da_append(prog, ((Instr) {OP_NOT}));
+        return 0;
+    default: return 1;
+    }
+}
+
+int program_compile(Program * prog, ExprNode node) {
+    prog->count = 0;
+    prog->max_depth = 0;
+    prog->deps = 0;
+    prog->inputs = 0;
+    return program_emit(prog, node, 0);
+}
+
+// scalar, one evaluation per call
+#define program_eval_scalar(T, F)                                       \
+    do {                                                                \
+        T stack[PROGRAM_MAX_DEPTH];                                     \
+        size_t sp = 0;                                                  \
+        for (Instr * in = prog->items; in < prog->items + prog->count; ++in) { \
+            switch (in->op) {                                           \
+            case OP_CONST: stack[sp++] = in->imm; break;                \
+            case OP_X: stack[sp++] = x; break;                          \
+            case OP_Y: stack[sp++] = NAN; break;                        \
+            case OP_VAR: stack[sp++] = params[in->arg]; break;          \
+            case OP_FUNC: stack[sp-1] = program_bfunc_##T(in->arg, stack[sp-1]); break; \
+            case OP_POWI: stack[sp-1] = program_powi_##T(stack[sp-1], (int32_t)in->arg); break; \
+            case OP_POLY: stack[sp++] = program_poly_##T(in + 1, in->arg, x); in += in->arg + 1; break; \
+            case OP_FUNC2: sp -= 1; stack[sp-1] = program_bfunc2_##T(in->arg, stack[sp-1], stack[sp]); break; \
+            case OP_ADD: sp -= 1; stack[sp-1] = stack[sp-1] + stack[sp]; break; \
+            case OP_SUB: sp -= 1; stack[sp-1] = stack[sp-1] - stack[sp]; break; \
+            case OP_MUL: sp -= 1; stack[sp-1] = stack[sp-1] * stack[sp]; break; \
+            case OP_DIV: sp -= 1; stack[sp-1] = stack[sp-1] / stack[sp]; break; \
+            case OP_MOD: sp -= 1; stack[sp-1] = F(fmod)(stack[sp-1], stack[sp]); break; \
+            case OP_LT: sp -= 1; stack[sp-1] = stack[sp-1] < stack[sp]; break; \
+            case OP_LE: sp -= 1; stack[sp-1] = stack[sp-1] <= stack[sp]; break; \
+            case OP_EQ: sp -= 1; stack[sp-1] = stack[sp-1] == stack[sp]; break; \
+            case OP_NE: sp -= 1; stack[sp-1] = stack[sp-1] != stack[sp]; break; \
+            case OP_AND: sp -= 1; stack[sp-1] = expr_truthy(stack[sp-1]) && expr_truthy(stack[sp]); break; \
+            case OP_OR: sp -= 1; stack[sp-1] = expr_truthy(stack[sp-1]) || expr_truthy(stack[sp]); break; \
+            case OP_NEG: stack[sp-1] = -stack[sp-1]; break;             \
+            case OP_NOT: stack[sp-1] = !expr_truthy(stack[sp-1]); break; \
+            case OP_IF: sp -= 1; if (!expr_truthy(stack[sp])) in += in->arg; break; \
+            case OP_ELSE: in += in->arg; break;                         \
+            case OP_END: break;                                         \
+            }                                                           \
+        }                                                               \
+        return sp == 1 ? stack[0] : NAN;                                \
+    } while (0)
+
+#define F_float(fn) fn##f
+#define F_double(fn) fn
+
+static inline float program_bfunc_float(uint32_t f, float t) {
+    switch (f) {
+    case BFUNC_SINH: return sinhf(t);
+    case BFUNC_COSH: return coshf(t);
+    case BFUNC_TANH: return tanhf(t);
+    case BFUNC_ASIN: return asinf(t);
+    case BFUNC_ACOS: return acosf(t);
+    case BFUNC_ATAN: return atanf(t);
+    case BFUNC_SIN: return sinf(t);
+    case BFUNC_COS: return cosf(t);
+    case BFUNC_TAN: return tanf(t);
+    case BFUNC_EXP: return expf(t);
+    case BFUNC_LOG: return logf(t);
+    case BFUNC_SQRT: return sqrtf(t);
+    case BFUNC_FLOOR: return floorf(t);
+    case BFUNC_CEIL: return ceilf(t);
+    case BFUNC_ROUND: return roundf(t);
+    case BFUNC_ABS: return fabsf(t);
+    case BFUNC_SGN: return (t > 0) - (t < 0);
+    default: return NAN;
+    }
+}
+static inline double program_bfunc_double(uint32_t f, double t) {
+    switch (f) {
+    case BFUNC_SINH: return sinh(t);
+    case BFUNC_COSH: return cosh(t);
+    case BFUNC_TANH: return tanh(t);
+    case BFUNC_ASIN: return asin(t);
+    case BFUNC_ACOS: return acos(t);
+    case BFUNC_ATAN: return atan(t);
+    case BFUNC_SIN: return sin(t);
+    case BFUNC_COS: return cos(t);
+    case BFUNC_TAN: return tan(t);
+    case BFUNC_EXP: return exp(t);
+    case BFUNC_LOG: return log(t);
+    case BFUNC_SQRT: return sqrt(t);
+    case BFUNC_FLOOR: return floor(t);
+    case BFUNC_CEIL: return ceil(t);
+    case BFUNC_ROUND: return round(t);
+    case BFUNC_ABS: return fabs(t);
+    case BFUNC_SGN: return (t > 0) - (t < 0);
+    default: return NAN;
+    }
+}
+static inline ddouble program_bfunc_ddouble(uint32_t f, ddouble t) {
+    switch (f) {
+    case BFUNC_SINH: return dd_sinh(t);
+    case BFUNC_COSH: return dd_cosh(t);
+    case BFUNC_TANH: return dd_tanh(t);
+    case BFUNC_ASIN: return dd_asin(t);
+    case BFUNC_ACOS: return dd_acos(t);
+    case BFUNC_ATAN: return dd_atan(t);
+    case BFUNC_SIN: return dd_sin(t);
+    case BFUNC_COS: return dd_cos(t);
+    case BFUNC_TAN: return dd_tan(t);
+    case BFUNC_EXP: return dd_exp(t);
+    case BFUNC_LOG: return dd_log(t);
+    case BFUNC_SQRT: return dd_sqrt(t);
+    case BFUNC_FLOOR: return dd_floor(t);
+    case BFUNC_CEIL: return dd_ceil(t);
+    case BFUNC_ROUND: return dd_round(t);
+    case BFUNC_ABS: return t.hi < 0 ? dd_neg(t) : t;
+    case BFUNC_SGN: return dd_from((t.hi > 0) - (t.hi < 0));
+    default: return dd_from(NAN);
+    }
+}
+
+static inline float program_bfunc2_float(uint32_t f, float a, float b) {
+    switch (f) {
+    case BFUNC_ATAN2: return atan2f(a, b);
+    case BFUNC_POW: return powf(a, b);
+    case BFUNC_HYPOT: return hypotf(a, b);
+    case BFUNC_MIN: return fminf(a, b);
+    case BFUNC_MAX: return fmaxf(a, b);
+    default: return NAN;
+    }
+}
+static inline double program_bfunc2_double(uint32_t f, double a, double b) {
+    switch (f) {
+    case BFUNC_ATAN2: return atan2(a, b);
+    case BFUNC_POW: return pow(a, b);
+    case BFUNC_HYPOT: return hypot(a, b);
+    case BFUNC_MIN: return fmin(a, b);
+    case BFUNC_MAX: return fmax(a, b);
+    default: return NAN;
+    }
+}
+static inline ddouble program_bfunc2_ddouble(uint32_t f, ddouble a, ddouble b) {
+    bool less = a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+    switch (f) {
+    case BFUNC_ATAN2: return dd_atan2(a, b);
+    case BFUNC_POW: return dd_pow(a, b);
+    case BFUNC_HYPOT: return dd_hypot(a, b);
+    case BFUNC_MIN: return isnan(b.hi) || less ? a : b;
+    case BFUNC_MAX: return isnan(a.hi) || less ? b : a;
+    default: return dd_from(NAN);
+    }
+}
+
+// square and multiply, the exponent is a compile time constant
+static inline float program_powi_float(float a, int n) {
+    float r = 1;
+    for (unsigned m = n < 0 ? -n : n; m; m >>= 1, a *= a) {
+        if (m & 1) r *= a;
+    }
+    return n < 0 ? 1 / r : r;
+}
+static inline double program_powi_double(double a, int n) {
+    double r = 1;
+    for (unsigned m = n < 0 ? -n : n; m; m >>= 1, a *= a) {
+        if (m & 1) r *= a;
+    }
+    return n < 0 ? 1 / r : r;
+}
+
+// @algo: Estrin's scheme, pairs of terms first, then pairs of pairs with x^2, x^4, ...
+// the levels are independent multiply-adds, where Horner is one long dependency chain.
+// only worth it for one point at a time, the batch kernel gets its parallelism from the block
+#define program_poly_scalar(T)                                          \
+    do {                                                                \
+        if (n < 4) {                                                    \
+            T r = coef[n].imm;                                          \
+            for (int k = n - 1; k >= 0; --k) r = r * x + (T)coef[k].imm; \
+            return r;                                                   \
+        }                                                               \
+        T p[POLY_MAX_DEGREE / 2 + 1];                                   \
+        int m = (n + 2) / 2;                                            \
+        for (int j = 0; j < m; ++j) {                                   \
+            p[j] = 2 * j + 1 <= n ? (T)coef[2 * j].imm + (T)coef[2 * j + 1].imm * x : (T)coef[2 * j].imm; \
+        }                                                               \
+        for (T xx = x * x; m > 1; xx *= xx) {                           \
+            for (int j = 0; j < m / 2; ++j) p[j] = p[2 * j] + p[2 * j + 1] * xx; \
+            if (m & 1) p[m / 2] = p[m - 1];                             \
+            m = (m + 1) / 2;                                            \
+        }                                                               \
+        return p[0];                                                    \
+    } while (0)
+
+static inline float program_poly_float(const Instr * coef, int n, float x) {
+    program_poly_scalar(float);
+}
+static inline double program_poly_double(const Instr * coef, int n, double x) {
+    program_poly_scalar(double);
+}
+
+float program_eval_f(Program * prog, const double * params, float x) {
+    program_eval_scalar(float, F_float);
+}
+double program_eval_d(Program * prog, const double * params, double x) {
+    program_eval_scalar(double, F_double);
+}
+
+// literals are only double accurate, `x` carries the extra digits
+ddouble program_eval_dd(Program * prog, const double * params, ddouble x) {
+    ddouble stack[PROGRAM_MAX_DEPTH];
+    size_t sp = 0;
+    for (Instr * in = prog->items; in < prog->items + prog->count; ++in) {
+        switch (in->op) {
+        case OP_CONST:
+            // the named constants get their full digits back
+            stack[sp++] = in->arg == 1 + BVAR_PI ? DD_PI
+                : in->arg == 1 + BVAR_E ? DD_E
+                : dd_from(in->imm);
+            break;
+        case OP_X: stack[sp++] = x; break;
+        case OP_Y: stack[sp++] = dd_from(NAN); break;
+        case OP_VAR: stack[sp++] = dd_from(params[in->arg]); break;
+        case OP_FUNC: stack[sp-1] = program_bfunc_ddouble(in->arg, stack[sp-1]); break;
+        case OP_POWI: stack[sp-1] = dd_powi(stack[sp-1], (int32_t)in->arg); break;
+        case OP_POLY: { // Horner, the extra digits only come from `x`
+            ddouble r = dd_from(in[1 + in->arg].imm);
+            for (int k = in->arg - 1; k >= 0; --k) r = dd_add(dd_mul(r, x), dd_from(in[1 + k].imm));
+            stack[sp++] = r;
+            in += in->arg + 1;
+        } break;
+        case OP_FUNC2: sp -= 1; stack[sp-1] = program_bfunc2_ddouble(in->arg, stack[sp-1], stack[sp]); break;
+        case OP_ADD: sp -= 1; stack[sp-1] = dd_add(stack[sp-1], stack[sp]); break;
+        case OP_SUB: sp -= 1; stack[sp-1] = dd_sub(stack[sp-1], stack[sp]); break;
+        case OP_MUL: sp -= 1; stack[sp-1] = dd_mul(stack[sp-1], stack[sp]); break;
+        case OP_DIV: sp -= 1; stack[sp-1] = dd_div(stack[sp-1], stack[sp]); break;
+        case OP_MOD: sp -= 1; stack[sp-1] = dd_fmod(stack[sp-1], stack[sp]); break;
+        case OP_LT: case OP_LE: case OP_EQ: case OP_NE: { // on the full value, hi first
+            sp -= 1;
+            ddouble a = stack[sp-1], b = stack[sp];
+            double d = a.hi != b.hi ? a.hi - b.hi : a.lo - b.lo; // NaN if either is
+            bool r = in->op == OP_LT ? d < 0 : in->op == OP_LE ? d <= 0 : in->op == OP_EQ ? d == 0 : !(d == 0);
+            stack[sp-1] = dd_from(r);
+        } break;
+        case OP_AND: sp -= 1; stack[sp-1] = dd_from(expr_truthy(stack[sp-1].hi) && expr_truthy(stack[sp].hi)); break;
+        case OP_OR: sp -= 1; stack[sp-1] = dd_from(expr_truthy(stack[sp-1].hi) || expr_truthy(stack[sp].hi)); break;
+        case OP_NEG: stack[sp-1] = dd_neg(stack[sp-1]); break;
+        case OP_NOT: stack[sp-1] = dd_from(!expr_truthy(stack[sp-1].hi)); break;
+        case OP_IF: sp -= 1; if (!expr_truthy(stack[sp].hi)) in += in->arg; break;
+        case OP_ELSE: in += in->arg; break;
+        case OP_END: break;
+        }
+    }
+    return sp == 1 ? stack[0] : dd_from(NAN);
+}
+
+static inline double complex program_bfunc_complex(uint32_t f, double complex t) {
+    switch (f) {
+    case BFUNC_SINH: return csinh(t);
+    case BFUNC_COSH: return ccosh(t);
+    case BFUNC_TANH: return ctanh(t);
+    case BFUNC_ASIN: return casin(t);
+    case BFUNC_ACOS: return cacos(t);
+    case BFUNC_ATAN: return catan(t);
+    case BFUNC_SIN: return csin(t);
+    case BFUNC_COS: return ccos(t);
+    case BFUNC_TAN: return ctan(t);
+    case BFUNC_EXP: return cexp(t);
+    case BFUNC_LOG: return clog(t);
+    case BFUNC_SQRT: return csqrt(t);
+    case BFUNC_FLOOR: return CMPLX(floor(creal(t)), floor(cimag(t)));
+    case BFUNC_CEIL: return CMPLX(ceil(creal(t)), ceil(cimag(t)));
+    case BFUNC_ROUND: return CMPLX(round(creal(t)), round(cimag(t)));
+    case BFUNC_ABS: return cabs(t);
+    case BFUNC_SGN: return t == 0 ? 0 : t / cabs(t);
+    default: return NAN;
+    }
+}
+
+static inline double complex program_bfunc2_complex(uint32_t f, double complex a, double complex b) {
+    switch (f) {
+    case BFUNC_POW: return cpow(a, b);
+    case BFUNC_HYPOT: return sqrt(creal(a * conj(a)) + creal(b * conj(b)));
+    default: return NAN; // no order on the complex plane
+    }
+}
+
+static inline double complex program_powi_complex(double complex a, int n) {
+    unsigned k = n < 0 ? -n : n;
+    double complex r = 1;
+    for (; k; k >>= 1, a *= a) if (k & 1) r *= a;
+    return n < 0 ? 1 / r : r;
+}
+
+static inline bool program_truthy_complex(double complex t) {
+    return expr_truthy(creal(t)) || expr_truthy(cimag(t));
+}
+
+// domain colouring: the programs are the ordinary ones, `z` and `i` are read as
+// parameters by the parser and only given their meaning here. `x` and `y` are NaN
+double complex program_eval_c(Program * prog, const double * params, double complex z) {
+    double complex stack[PROGRAM_MAX_DEPTH];
+    size_t sp = 0;
+    for (Instr * in = prog->items; in < prog->items + prog->count; ++in) {
+        switch (in->op) {
+        case OP_CONST: stack[sp++] = in->imm; break;
+        case OP_X: case OP_Y: stack[sp++] = NAN; break;
+        case OP_VAR:
+            stack[sp++] = in->arg == (uint32_t)param_index('z') ? z
+                : in->arg == (uint32_t)param_index('i') ? I
+                : params[in->arg];
+            break;
+        case OP_FUNC: stack[sp-1] = program_bfunc_complex(in->arg, stack[sp-1]); break;
+        case OP_POWI: stack[sp-1] = program_powi_complex(stack[sp-1], (int32_t)in->arg); break;
+        case OP_POLY: stack[sp++] = NAN; in += in->arg + 1; break; // polynomials are in `x`
+        case OP_FUNC2: sp -= 1; stack[sp-1] = program_bfunc2_complex(in->arg, stack[sp-1], stack[sp]); break;
+        case OP_ADD: sp -= 1; stack[sp-1] = stack[sp-1] + stack[sp]; break;
+        case OP_SUB: sp -= 1; stack[sp-1] = stack[sp-1] - stack[sp]; break;
+        case OP_MUL: sp -= 1; stack[sp-1] = stack[sp-1] * stack[sp]; break;
+        case OP_DIV: sp -= 1; stack[sp-1] = stack[sp-1] / stack[sp]; break;
+        case OP_MOD: sp -= 1; stack[sp-1] = NAN; break;
+        case OP_LT: case OP_LE: sp -= 1; stack[sp-1] = NAN; break; // no order, NaN is false
+        case OP_EQ: sp -= 1; stack[sp-1] = stack[sp-1] == stack[sp]; break;
+        case OP_NE: sp -= 1; stack[sp-1] = stack[sp-1] != stack[sp]; break;
+        // a complex value is true where it is nonzero, as in C
+        case OP_AND: sp -= 1; stack[sp-1] = program_truthy_complex(stack[sp-1]) && program_truthy_complex(stack[sp]); break;
+        case OP_OR: sp -= 1; stack[sp-1] = program_truthy_complex(stack[sp-1]) || program_truthy_complex(stack[sp]); break;
+        case OP_NEG: stack[sp-1] = -stack[sp-1]; break;
+        case OP_NOT: stack[sp-1] = !program_truthy_complex(stack[sp-1]); break;
+        case OP_IF: sp -= 1; if (!program_truthy_complex(stack[sp])) in += in->arg; break;
+        case OP_ELSE: in += in->arg; break;
+        case OP_END: break;
+        }
+    }
+    return sp == 1 ? stack[0] : NAN;
+}
+
+// @algo: batch evaluation runs each instruction over a whole block of inputs,
+// the dispatch is paid once per block and the inner loops are plain arrays
+// that the compiler can vectorize
+// conditionals cannot branch per lane: OP_IF counts the true lanes of the block. if they
+// all agree it behaves like the scalar evaluators and only one side runs, otherwise `c`
+// stays on the stack, both sides run over the whole block and OP_END blends them by mask.
+// `mixed` remembers which, per nesting level
+// `y_in`: second input, NULL outside fields
+#define program_eval_batch(T, F, y_in, out)                             \
+    do {                                                                \
+        T stack[PROGRAM_MAX_DEPTH][EVAL_BLOCK];                         \
+        bool mixed[PROGRAM_MAX_DEPTH];                                  \
+        for (size_t base = 0; base < n; base += EVAL_BLOCK) {           \
+            size_t m = n - base < EVAL_BLOCK ? n - base : EVAL_BLOCK;   \
+            const T * x = xs + base;                                    \
+            size_t sp = 0, nest = 0;                                    \
+            for (Instr * in = prog->items; in < prog->items + prog->count; ++in) { \
+                T * top = stack[sp > 0 ? sp - 1 : 0];                   \
+                T * a = stack[sp > 1 ? sp - 2 : 0]; /* binary operands */ \
+                T * b = top;                                            \
+                switch (in->op) {                                       \
+                case OP_CONST: for (size_t i = 0; i < m; ++i) stack[sp][i] = in->imm; sp += 1; break; \
+                case OP_X: memcpy(stack[sp], x, m * sizeof(T)); sp += 1; break; \
+                case OP_Y:                                              \
+                    if (y_in) memcpy(stack[sp], (y_in) + base, m * sizeof(T)); \
+                    else for (size_t i = 0; i < m; ++i) stack[sp][i] = NAN; \
+                    sp += 1;                                            \
+                    break;                                              \
+                case OP_VAR: for (size_t i = 0; i < m; ++i) stack[sp][i] = params[in->arg]; sp += 1; break; \
+                case OP_FUNC: program_bfunc_batch_##T(in->arg, top, m); break; \
+                case OP_POWI: program_powi_batch_##T(top, stack[sp], (int32_t)in->arg, m); break; \
+                case OP_POLY: program_poly_batch_##T(stack[sp], x, in + 1, in->arg, m); sp += 1; in += in->arg + 1; break; \
+                case OP_FUNC2: program_bfunc2_batch_##T(in->arg, a, b, m); break; \
+                case OP_ADD: for (size_t i = 0; i < m; ++i) a[i] = a[i] + b[i]; break; \
+                case OP_SUB: for (size_t i = 0; i < m; ++i) a[i] = a[i] - b[i]; break; \
+                case OP_MUL: for (size_t i = 0; i < m; ++i) a[i] = a[i] * b[i]; break; \
+                case OP_DIV: for (size_t i = 0; i < m; ++i) a[i] = a[i] / b[i]; break; \
+                case OP_MOD: for (size_t i = 0; i < m; ++i) a[i] = F(fmod)(a[i], b[i]); break; \
+                case OP_LT: for (size_t i = 0; i < m; ++i) a[i] = a[i] < b[i]; break; \
+                case OP_LE: for (size_t i = 0; i < m; ++i) a[i] = a[i] <= b[i]; break; \
+                case OP_EQ: for (size_t i = 0; i < m; ++i) a[i] = a[i] == b[i]; break; \
+                case OP_NE: for (size_t i = 0; i < m; ++i) a[i] = a[i] != b[i]; break; \
+                case OP_AND: for (size_t i = 0; i < m; ++i) a[i] = expr_truthy(a[i]) & expr_truthy(b[i]); break; \
+                case OP_OR: for (size_t i = 0; i < m; ++i) a[i] = expr_truthy(a[i]) | expr_truthy(b[i]); break; \
+                case OP_NEG: for (size_t i = 0; i < m; ++i) top[i] = -top[i]; break; \
+                case OP_NOT: for (size_t i = 0; i < m; ++i) top[i] = !expr_truthy(top[i]); break; \
+                case OP_IF: {                                           \
+                    size_t t = 0;                                       \
+                    for (size_t i = 0; i < m; ++i) t += expr_truthy(top[i]); \
+                    mixed[nest++] = t > 0 && t < m;                     \
+                    if (mixed[nest - 1]) break;                         \
+                    sp -= 1;                                            \
+                    if (t == 0) in += in->arg;                          \
+                } break;                                                \
+                case OP_ELSE: /* only reached from the true side */     \
+                    if (!mixed[nest - 1]) nest -= 1, in += in->arg;     \
+                    break;                                              \
+                case OP_END:                                            \
+                    if (mixed[--nest]) {                                \
+                        program_blend_##T(stack[sp - 3], a, b, m);      \
+                        sp -= 2;                                        \
+                    }                                                   \
+                    break;                                              \
+                }                                                       \
+                if (op_is_binary(in->op)) sp -= 1;                      \
+            }                                                           \
+            if (sp == 1) memcpy((out) + base, stack[0], m * sizeof(T)); \
+            else for (size_t i = 0; i < m; ++i) (out)[base + i] = NAN;  \
+        }                                                               \
+    } while (0)
+
+// c = c ? a : b lane by lane, as a bit mask: `?:` on doubles compiles to a branch,
+// which mispredicts on every other lane when the sides alternate
+#define program_blend(T, U)                                             \
+    do {                                                                \
+        for (size_t i = 0; i < m; ++i) {                                \
+            U ua, ub, mask = -(U)expr_truthy(c[i]);                     \
+            memcpy(&ua, a + i, sizeof(T));                              \
+            memcpy(&ub, b + i, sizeof(T));                              \
+            ua = (ua & mask) | (ub & ~mask);                            \
+            memcpy(c + i, &ua, sizeof(T));                              \
+        }                                                               \
+    } while (0)
+
+static void program_blend_float(float * c, const float * a, const float * b, size_t m) {
+    program_blend(float, uint32_t);
+}
+static void program_blend_double(double * c, const double * a, const double * b, size_t m) {
+    program_blend(double, uint64_t);
+}
+
+// the switch is hoisted out of the loop, one kernel per function
+#define program_bfunc_batch(T, F)                                       \
+    do {                                                                \
+        switch (f) {                                                    \
+        case BFUNC_SINH: for (size_t i = 0; i < m; ++i) a[i] = F(sinh)(a[i]); break; \
+        case BFUNC_COSH: for (size_t i = 0; i < m; ++i) a[i] = F(cosh)(a[i]); break; \
+        case BFUNC_TANH: for (size_t i = 0; i < m; ++i) a[i] = F(tanh)(a[i]); break; \
+        case BFUNC_ASIN: for (size_t i = 0; i < m; ++i) a[i] = F(asin)(a[i]); break; \
+        case BFUNC_ACOS: for (size_t i = 0; i < m; ++i) a[i] = F(acos)(a[i]); break; \
+        case BFUNC_ATAN: for (size_t i = 0; i < m; ++i) a[i] = F(atan)(a[i]); break; \
+        case BFUNC_SIN: for (size_t i = 0; i < m; ++i) a[i] = F(sin)(a[i]); break; \
+        case BFUNC_COS: for (size_t i = 0; i < m; ++i) a[i] = F(cos)(a[i]); break; \
+        case BFUNC_TAN: for (size_t i = 0; i < m; ++i) a[i] = F(tan)(a[i]); break; \
+        case BFUNC_EXP: for (size_t i = 0; i < m; ++i) a[i] = F(exp)(a[i]); break; \
+        case BFUNC_LOG: for (size_t i = 0; i < m; ++i) a[i] = F(log)(a[i]); break; \
+        case BFUNC_SQRT: for (size_t i = 0; i < m; ++i) a[i] = F(sqrt)(a[i]); break; \
+        case BFUNC_FLOOR: for (size_t i = 0; i < m; ++i) a[i] = F(floor)(a[i]); break; \
+        case BFUNC_CEIL: for (size_t i = 0; i < m; ++i) a[i] = F(ceil)(a[i]); break; \
+        case BFUNC_ROUND: for (size_t i = 0; i < m; ++i) a[i] = F(round)(a[i]); break; \
+        case BFUNC_ABS: for (size_t i = 0; i < m; ++i) a[i] = F(fabs)(a[i]); break; \
+        case BFUNC_SGN: for (size_t i = 0; i < m; ++i) a[i] = (a[i] > 0) - (a[i] < 0); break; \
+        default: for (size_t i = 0; i < m; ++i) a[i] = NAN;            \
+        }                                                               \
+    } while (0)
+
+static void program_bfunc_batch_float(uint32_t f, float * a, size_t m) {
+    program_bfunc_batch(float, F_float);
+}
+static void program_bfunc_batch_double(uint32_t f, double * a, size_t m) {
+    program_bfunc_batch(double, F_double);
+}
+
+#define program_bfunc2_batch(T, F)                                      \
+    do {                                                                \
+        switch (f) {                                                    \
+        case BFUNC_ATAN2: for (size_t i = 0; i < m; ++i) a[i] = F(atan2)(a[i], b[i]); break; \
+        case BFUNC_POW: for (size_t i = 0; i < m; ++i) a[i] = F(pow)(a[i], b[i]); break; \
+        case BFUNC_HYPOT: for (size_t i = 0; i < m; ++i) a[i] = F(hypot)(a[i], b[i]); break; \
+        case BFUNC_MIN: for (size_t i = 0; i < m; ++i) a[i] = F(fmin)(a[i], b[i]); break; \
+        case BFUNC_MAX: for (size_t i = 0; i < m; ++i) a[i] = F(fmax)(a[i], b[i]); break; \
+        default: for (size_t i = 0; i < m; ++i) a[i] = NAN;            \
+        }                                                               \
+    } while (0)
+
+static void program_bfunc2_batch_float(uint32_t f, float * a, const float * b, size_t m) {
+    program_bfunc2_batch(float, F_float);
+}
+static void program_bfunc2_batch_double(uint32_t f, double * a, const double * b, size_t m) {
+    program_bfunc2_batch(double, F_double);
+}
+
+// @algo: square and multiply over the whole block, one plain loop per step.
+// squares and cubes are one fused loop; otherwise `a` is squared in place up to the
+// lowest set bit, then `sq` keeps squaring and is multiplied in on the remaining set bits
+#define program_powi_batch(T)                                           \
+    do {                                                                \
+        unsigned k = n < 0 ? -n : n;                                    \
+        if (k == 0) for (size_t i = 0; i < m; ++i) a[i] = 1;            \
+        else if (k == 2) for (size_t i = 0; i < m; ++i) a[i] = a[i] * a[i]; \
+        else if (k == 3) for (size_t i = 0; i < m; ++i) a[i] = a[i] * a[i] * a[i]; \
+        else {                                                          \
+            for (; !(k & 1); k >>= 1) for (size_t i = 0; i < m; ++i) a[i] *= a[i]; \
+            if (k > 1) memcpy(sq, a, m * sizeof(T));                    \
+            while ((k >>= 1)) {                                         \
+                for (size_t i = 0; i < m; ++i) sq[i] *= sq[i];          \
+                if (k & 1) for (size_t i = 0; i < m; ++i) a[i] *= sq[i]; \
+            }                                                           \
+        }                                                               \
+        if (n < 0) for (size_t i = 0; i < m; ++i) a[i] = 1 / a[i];      \
+    } while (0)
+
+static void program_powi_batch_float(float * a, float * sq, int n, size_t m) {
+    program_powi_batch(float);
+}
+static void program_powi_batch_double(double * a, double * sq, int n, size_t m) {
+    program_powi_batch(double);
+}
+
+// Horner with the block as the inner loop: every step is one vectorized multiply-add
+#define program_poly_batch(T)                                           \
+    do {                                                                \
+        for (size_t i = 0; i < m; ++i) r[i] = coef[n].imm;              \
+        for (int k = n - 1; k >= 0; --k) {                              \
+            T c = coef[k].imm;                                          \
+            for (size_t i = 0; i < m; ++i) r[i] = r[i] * x[i] + c;      \
+        }                                                               \
+    } while (0)
+
+static void program_poly_batch_float(float * r, const float * x, const Instr * coef, int n, size_t m) {
+    program_poly_batch(float);
+}
+static void program_poly_batch_double(double * r, const double * x, const Instr * coef, int n, size_t m) {
+    program_poly_batch(double);
+}
+
+void program_eval_batch_f(Program * prog, const double * params, const float * xs, float * ys, size_t n) {
+    program_eval_batch(float, F_float, (const float *)NULL, ys);
+}
+void program_eval_batch_d(Program * prog, const double * params, const double * xs, double * ys, size_t n) {
+    program_eval_batch(double, F_double, (const double *)NULL, ys);
+}
+void program_eval_field_d(Program * prog, const double * params, const double * xs, const double * ys, double * out, size_t n) {
+    program_eval_batch(double, F_double, ys, out);
+}
+
+// for programs that did not come from `program_compile`: walks the stack effects once,
+// and recomputes `max_depth` from them
+int program_verify(Program * prog) {
+    size_t sp = 0, depth = 0;
+    struct ProgramVerifyCond { size_t next, sp; bool in_else; } conds[PROGRAM_MAX_DEPTH]; // open OP_IF, innermost last
+    size_t nest = 0;
+    for (size_t i = 0; i < prog->count; ++i) {
+        Instr in = prog->items[i];
+        switch (in.op) {
+        case OP_VAR:
+            if (in.arg >= PARAM_COUNT) return 1;
+            // fallthrough
+        case OP_CONST: case OP_X: case OP_Y:
+            sp += 1;
+            break;
+        case OP_POLY:
+            if (in.arg > POLY_MAX_DEGREE || i + in.arg + 1 >= prog->count) return 1;
+            for (size_t k = 1; k <= in.arg + 1; ++k) {
+                if (prog->items[i + k].op != OP_COEF) return 1;
+            }
+            i += in.arg + 1;
+            sp += 1;
+            break;
+        case OP_FUNC:
+            if (sp < 1 || in.arg >= n_builtin_funcs || bfunc_arity(in.arg) != 1) return 1;
+            break;
+        case OP_POWI:
+            if (sp < 1) return 1;
+            if (sp + 1 > depth) depth = sp + 1; // the batch kernel uses the slot above
+            break;
+        case OP_NEG: case OP_NOT:
+            if (sp < 1) return 1;
+            break;
+        case OP_FUNC2:
+            if (in.arg >= n_builtin_funcs || bfunc_arity(in.arg) == 1) return 1;
+            // fallthrough
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_LT: case OP_LE: case OP_EQ: case OP_NE: case OP_AND: case OP_OR:
+            if (sp < 2) return 1;
+            sp -= 1;
+            break;
+        // checked as the batch evaluator runs a mixed block, the other paths use less:
+        // `c` stays, each side pushes one, jumps land on the matching OP_ELSE / OP_END
+        case OP_IF:
+            if (sp < 1 || nest == PROGRAM_MAX_DEPTH || in.arg == 0 || i + in.arg >= prog->count) return 1;
+            conds[nest++] = (struct ProgramVerifyCond) {i + in.arg, sp, false};
+            break;
+        case OP_ELSE:
+            if (nest == 0 || conds[nest - 1].in_else || conds[nest - 1].next != i ||
+                sp != conds[nest - 1].sp + 1 || in.arg == 0 || i + in.arg >= prog->count) return 1;
+            conds[nest - 1].next = i + in.arg;
+            conds[nest - 1].in_else = true;
+            break;
+        case OP_END:
+            if (nest == 0 || !conds[nest - 1].in_else || conds[nest - 1].next != i ||
+                sp != conds[nest - 1].sp + 2) return 1;
+            nest -= 1;
+            sp -= 2;
+            break;
+        default: return 1;
+        }
+        if (sp > depth) depth = sp;
+        if (depth > PROGRAM_MAX_DEPTH) return 1;
+    }
+    if (sp != 1 || nest > 0) return 1;
+    prog->max_depth = depth;
+    return 0;
+}
+
+void program_free(Program * prog) {
+    if (prog->mapped) {
+        *prog = (Program) {};
+        return;
+    }
+    da_free(prog);
+    free(prog->text);
+    prog->text = NULL;
+}
+
+
+/* Program cache */
+
+/*
+  content addressed: text -> compiled program, shared by every equation with the same text.
+  programs are refcounted, unreferenced ones stay around until the table needs to grow,
+  so flipping back to a previously seen text is still a hit
+ */
+
+typedef struct {
+    Program ** slots; // open addressing, NULL for empty
+    size_t count;
+    size_t capacity; // power of 2
+
+    size_t hits, misses;
+    size_t nodes, ops; // syntax tree nodes in, ops out (without OP_COEF), over all misses
+} ProgramCache;
+
+ProgramCache g_program_cache;
+
+Program * program_cache_get(const char * text); // refs += 1, never NULL
+Program * program_cache_adopt(Program * prog); // takes a heap allocated program, return the cached one, refs += 1
+void program_release(Program * prog); // refs -= 1
+void program_cache_free();
+
+static size_t expr_count_nodes(ExprNode node) {
+    size_t n = node.self.type != TT_NONE;
+    for (size_t i = 0; i < node.count; ++i) n += expr_count_nodes(node.items[i]);
+    return n;
+}
+
+uint64_t program_hash(const char * text) { // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (; *text; ++text) {
+        h ^= (unsigned char)*text;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static void program_cache_insert(ProgramCache * cache, Program * prog) {
+    size_t slot = prog->hash & (cache->capacity - 1);
+    while (cache->slots[slot]) slot = (slot + 1) & (cache->capacity - 1);
+    cache->slots[slot] = prog;
+    cache->count += 1;
+}
+
+// drop unreferenced programs, then grow if still more than half full
+static void program_cache_rehash(ProgramCache * cache) {
+    Program ** old = cache->slots;
+    size_t old_capacity = cache->capacity;
+    size_t live = 0;
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old[i] && old[i]->refs == 0) {
+            program_free(old[i]);
+            free(old[i]);
+            old[i] = NULL;
+        }
+        live += old[i] != NULL;
+    }
+    size_t capacity = old_capacity ? old_capacity : 256;
+    while (live * 2 >= capacity) capacity *= 2;
+    cache->slots = calloc(capacity, sizeof(cache->slots[0]));
+    cache->capacity = capacity;
+    cache->count = 0;
+    for (size_t i = 0; i < old_capacity; ++i) {
+        if (old[i]) program_cache_insert(cache, old[i]);
+    }
+    free(old);
+}
+
+static Program * program_cache_find(ProgramCache * cache, const char * text, uint64_t h) {
+    if (!cache->capacity) return NULL;
+    size_t slot = h & (cache->capacity - 1);
+    for (Program * p; (p = cache->slots[slot]); slot = (slot + 1) & (cache->capacity - 1)) {
+        if (p->hash == h && strcmp(p->text, text) == 0) return p;
+    }
+    return NULL;
+}
+
+Program * program_cache_get(const char * text) {
+    ProgramCache * cache = &g_program_cache;
+    uint64_t h = program_hash(text);
+    Program * found = program_cache_find(cache, text, h);
+    if (found) {
+        cache->hits += 1;
+        found->refs += 1;
+        return found;
+    }
+
+    // miss: parse and compile, the tree is only needed until then
+    cache->misses += 1;
+    if ((cache->count + 1) * 2 > cache->capacity) program_cache_rehash(cache);
+    Program * prog = calloc(1, sizeof(Program));
+    prog->hash = h;
+    size_t len = strlen(text);
+    prog->text = malloc(len + 1);
+    memcpy(prog->text, text, len + 1);
+    prog->refs = 1;
+
+    ExprNode root = {};
+    char * buf = malloc(len + 1); // the tokenizer takes a mutable view
+    memcpy(buf, text, len + 1);
+    prog->valid = expr_parse_text(&root, buf) == 0 && program_compile(prog, root) == 0;
+    free(buf);
+    if (prog->valid) {
+        cache->nodes += expr_count_nodes(root);
+        for (size_t i = 0; i < prog->count; ++i) cache->ops += prog->items[i].op != OP_COEF;
+    }
+    expr_free_node(&root);
+
+    program_cache_insert(cache, prog);
+    return prog;
+}
+
+// already compiled elsewhere, e.g. loaded from a workspace
+Program * program_cache_adopt(Program * prog) {
+    ProgramCache * cache = &g_program_cache;
+    prog->hash = program_hash(prog->text);
+    Program * found = program_cache_find(cache, prog->text, prog->hash);
+    if (found) {
+        program_free(prog);
+        free(prog);
+        found->refs += 1;
+        return found;
+    }
+    if ((cache->count + 1) * 2 > cache->capacity) program_cache_rehash(cache);
+    prog->refs = 1;
+    program_cache_insert(cache, prog);
+    return prog;
+}
+
+void program_release(Program * prog) {
+    if (prog && prog->refs > 0) prog->refs -= 1;
+}
+
+void program_cache_free() {
+    ProgramCache * cache = &g_program_cache;
+    for (size_t i = 0; i < cache->capacity; ++i) {
+        if (!cache->slots[i]) continue;
+        program_free(cache->slots[i]);
+        free(cache->slots[i]);
+    }
+    free(cache->slots);
+    *cache = (ProgramCache) {};
+}
+
+#endif // COMPILE_H_
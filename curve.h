@@ -0,0 +1,171 @@
+#ifndef CURVE_H_
+#define CURVE_H_
+
+#include <stddef.h> // size_t
+#include <stdbool.h>
+#include <math.h> // hypot, atan2, isfinite
+
+#include <raylib.h> // Vector2
+
+#include "dynarray.h"
+#include "viewport.h"
+#include "compile.h"
+
+/*
+  curves over a parameter: `(f(t), g(t))` and `r = f(θ)`.
+  the parameter does not map to the screen, so the step is chosen from what the samples
+  look like on screen: short and straight segments are kept, long or bent ones are split
+*/
+
+typedef struct {
+    Vector2 * items;
+    size_t count;
+    size_t capacity;
+} Polyline;
+
+typedef enum {
+    CURVE_PARAMETRIC, // x = fx(t), y = fy(t)
+    CURVE_POLAR, // r = fx(θ)
+} CurveKind;
+
+#define CURVE_T_MIN 0.0
+#define CURVE_T_MAX (2 * M_PI)
+
+// tolerances in texture pixels
+#define CURVE_SEED 32 // uniform samples before any refinement
+#define CURVE_MAX_SEG 48.0 // longer chords are split whatever their shape, catches small loops
+#define CURVE_MIN_SEG 1.0 // shorter chords are never split
+#define CURVE_TOL 0.5 // allowed distance between the chord and the curve
+#define CURVE_MAX_POINTS 65536
+
+typedef struct {
+    double t;
+    double x, y; // texture pixels, NaN where the curve is undefined
+    bool pending; // not evaluated yet
+} CurvePoint;
+
+typedef struct {
+    CurvePoint * items;
+    size_t count;
+    size_t capacity;
+} CurvePoints;
+
+typedef struct {
+    CurveKind kind;
+    Program * fx, * fy; // `fy` unused for polar
+    const double * params;
+    Viewport vp;
+    int width, height;
+} Curve;
+
+size_t curve_sample(Curve c, Polyline * out); // return number of evaluations
+
+static bool curve_point_finite(CurvePoint p) {
+    return isfinite(p.x) && isfinite(p.y);
+}
+
+static void curve_eval_block(Curve * c, CurvePoint ** dst, const double * ts, size_t n) {
+    double a[EVAL_BLOCK], b[EVAL_BLOCK];
+    program_eval_batch_d(c->fx, c->params, ts, a, n);
+    if (c->kind == CURVE_PARAMETRIC) program_eval_batch_d(c->fy, c->params, ts, b, n);
+    double step_x = c->vp.span_x / c->width;
+    double step_y = c->vp.span_y / c->height;
+    for (size_t i = 0; i < n; ++i) {
+        double gx, gy;
+        if (c->kind == CURVE_POLAR) {
+            gx = a[i] * cos(ts[i]);
+            gy = a[i] * sin(ts[i]);
+        } else {
+            gx = a[i];
+            gy = b[i];
+        }
+        // relative to the centre first, like the graph sampler
+        dst[i]->x = c->width * 0.5 + ((gx - c->vp.cx.hi) - c->vp.cx.lo) / step_x;
+        dst[i]->y = c->height * 0.5 + ((gy - c->vp.cy.hi) - c->vp.cy.lo) / step_y;
+        dst[i]->pending = false;
+    }
+}
+
+// evaluate every pending point, a block at a time through the batch evaluator
+static size_t curve_eval_pending(Curve * c, CurvePoints * pts) {
+    CurvePoint * dst[EVAL_BLOCK];
+    double ts[EVAL_BLOCK];
+    size_t n = 0, total = 0;
+    for (size_t i = 0; i < pts->count; ++i) {
+        if (!pts->items[i].pending) continue;
+        dst[n] = pts->items + i;
+        ts[n] = pts->items[i].t;
+        if (++n == EVAL_BLOCK) {
+            curve_eval_block(c, dst, ts, n);
+            total += n;
+            n = 0;
+        }
+    }
+    if (n > 0) curve_eval_block(c, dst, ts, n);
+    return total + n;
+}
+
+// angle between the chords p->q and q->r
+static double curve_turn(CurvePoint p, CurvePoint q, CurvePoint r) {
+    if (!curve_point_finite(p) || !curve_point_finite(r)) return 0;
+    double ux = q.x - p.x, uy = q.y - p.y;
+    double vx = r.x - q.x, vy = r.y - q.y;
+    return fabs(atan2(ux * vy - uy * vx, ux * vx + uy * vy));
+}
+
+static bool curve_should_split(CurvePoints * pts, size_t i, double min_dt) {
+    CurvePoint a = pts->items[i], b = pts->items[i + 1];
+    if (b.t - a.t < min_dt) return false;
+    bool fa = curve_point_finite(a), fb = curve_point_finite(b);
+    if (fa != fb) return true; // close in on the edge of the domain
+    if (!fa) return false;
+    double len = hypot(b.x - a.x, b.y - a.y);
+    if (len > CURVE_MAX_SEG) return true;
+    if (len <= CURVE_MIN_SEG) return false;
+    // an arc turning by `turn` over the chord strays about len * turn / 8 from it,
+    // the turn is only known at the ends, so take the larger one and be generous
+    double turn = 0;
+    if (i > 0) turn = curve_turn(pts->items[i - 1], a, b);
+    if (i + 2 < pts->count) turn = fmax(turn, curve_turn(a, b, pts->items[i + 2]));
+    return len * turn / 4 > CURVE_TOL;
+}
+
+// @algo: breadth first subdivision. every pass marks the segments that are too long
+// or bend too much at either end, inserts their midpoints and evaluates all of them
+// in one batch, until nothing is split or the point budget runs out
+size_t curve_sample(Curve c, Polyline * out) {
+    static CurvePoints pts = {}, next = {};
+    double span = CURVE_T_MAX - CURVE_T_MIN;
+    double min_dt = span * 1e-9;
+
+    pts.count = 0;
+    for (int i = 0; i <= CURVE_SEED; ++i) {
+        da_append(&pts, ((CurvePoint) {.t = CURVE_T_MIN + span * i / CURVE_SEED, .pending = true}));
+    }
+    size_t evals = curve_eval_pending(&c, &pts);
+
+    while (pts.count < CURVE_MAX_POINTS) {
+        next.count = 0;
+        for (size_t i = 0; i + 1 < pts.count; ++i) {
+            da_append(&next, pts.items[i]);
+            if (curve_should_split(&pts, i, min_dt)) {
+                double t = (pts.items[i].t + pts.items[i + 1].t) * 0.5;
+                da_append(&next, ((CurvePoint) {.t = t, .pending = true}));
+            }
+        }
+        da_append(&next, pts.items[pts.count - 1]);
+        if (next.count == pts.count) break;
+        evals += curve_eval_pending(&c, &next);
+        CurvePoints tmp = pts;
+        pts = next;
+        next = tmp;
+    }
+
+    out->count = 0;
+    for (size_t i = 0; i < pts.count; ++i) {
+        da_append(out, ((Vector2) {pts.items[i].x, pts.items[i].y}));
+    }
+    return evals;
+}
+
+#endif // CURVE_H_
@@ -6,110 +6,76 @@
 #include <string.h> // strlen, cmp
 #include <stdbool.h>
 #include <stdio.h> // sscanf
-#include <math.h> // NAN, fmodf, and others
 
 #include "dynarray.h"
-
-
-/* String */
-
-typedef struct {
-    char * items; // [!] keep this null terminated
-    size_t count;
-    size_t capacity;
-
-    size_t cursor;
-} String;
-
-String string_createEmpty();
-void string_append(String * str, char c);
-void string_insert(String * str, char c);
-void string_backspace(String * str);
-
-// make sure to add initial 0
-String string_createEmpty() {
-    String str = {};
-    da_append(&str, 0);
-    return str;
-}
-
-void string_append(String * str, char c) {
-    str->items[str->count - 1] = c;
-    da_append(str, 0);
-}
-
-void string_insert(String * str, char c) {
-    for (size_t i = str->count - 1; i > str->cursor; --i) {
-        // @assert i > 0
-        str->items[i] = str->items[i-1];
-    }
-    str->items[str->cursor] = c;
-    str->cursor += 1;
-    da_append(str, 0);
-}
-void string_backspace(String * str) {
-    if (str->cursor == 0) return;
-    for (size_t i = str->cursor; i < str->count; ++i) {
-        str->items[i-1] = str->items[i];
-    }
-    str->cursor -= 1;
-    str->count -= 1;
-}
+#include "precision.h"
+#include "gapbuffer.h"
 
 
 /* register built-in tokens */
 
-// [!] keep the order the same
+// [!] keep the order the same, and longer names before their prefixes
 const char builtin_funcs[][6] = {
     "sinh", "cosh", "tanh",
-    "asin", "acos", "atan",
+    "asin", "acos", "atan2", "atan",
     "sin", "cos", "tan",
-    "exp", "log", /*"pow", */"sqrt",
+    "exp", "log", "pow", "sqrt",
     "floor", "ceil", "round",
-    "abs", "sgn", /*"hypot", "min", "max", */
+    "abs", "sgn", "hypot", "min", "max",
 };
 typedef enum {
     BFUNC_SINH, BFUNC_COSH, BFUNC_TANH,
-    BFUNC_ASIN, BFUNC_ACOS, BFUNC_ATAN,
+    BFUNC_ASIN, BFUNC_ACOS, BFUNC_ATAN2, BFUNC_ATAN,
     BFUNC_SIN, BFUNC_COS, BFUNC_TAN,
-    BFUNC_EXP, BFUNC_LOG, /*BFUNC_POW, */BFUNC_SQRT,
+    BFUNC_EXP, BFUNC_LOG, BFUNC_POW, BFUNC_SQRT,
     BFUNC_FLOOR, BFUNC_CEIL, BFUNC_ROUND,
-    BFUNC_ABS, BFUNC_SGN, /*BFUNC_HYPOT, BFUNC_MIN, BFUNC_MAX, */
+    BFUNC_ABS, BFUNC_SGN, BFUNC_HYPOT, BFUNC_MIN, BFUNC_MAX,
 } BFuncType;
-const char builtin_vars[][3] = {
+// number of arguments, 0 for the default of one, -1 for two or more
+const int builtin_func_arity[sizeof(builtin_funcs) / sizeof(builtin_funcs[0])] = {
+    [BFUNC_ATAN2] = 2, [BFUNC_POW] = 2, [BFUNC_HYPOT] = 2,
+    [BFUNC_MIN] = -1, [BFUNC_MAX] = -1,
+};
+#define bfunc_arity(f) (builtin_func_arity[f] ? builtin_func_arity[f] : 1)
+// "theta" before "t", the first prefix match wins
+const char builtin_vars[][6] = {
     "pi", "e", "x",
+    "theta", "\u03b8", "t",
+    "y",
 };
 typedef enum {
     BVAR_PI, BVAR_E, BVAR_X,
+    BVAR_THETA, BVAR_THETA_SYM, BVAR_T, // curve parameters
+    BVAR_Y, // second input of `z = f(x, y)`
 } BVarType;
-const char builtin_binops[][2] = {
-    "+", "-", "*", "/", "%",
+// "<=" before "<", the first prefix match wins
+const char builtin_binops[][3] = {
+    "+", "-", "*", "/", "%", "^",
+    "<=", ">=", "<", ">", "==", "!=",
+    "&&", "||",
+    "?", ":",
 };
 typedef enum {
-    BINOP_PLUS, BINOP_MINUS, BINOP_MULT, BINOP_DIV, BINOP_MOD,
+    BINOP_PLUS, BINOP_MINUS, BINOP_MULT, BINOP_DIV, BINOP_MOD, BINOP_POW,
+    BINOP_LE, BINOP_GE, BINOP_LT, BINOP_GT, BINOP_EQ, BINOP_NE, // 1 or 0
+    BINOP_AND, BINOP_OR,
+    // `c ? a : b`, `c ? a` is NaN where `c` is false. both end up as one BINOP_COND node
+    // with 2 or 3 children, BINOP_ELSE only lives on the parser's op stack
+    BINOP_COND, BINOP_ELSE,
 } BinopType;
 const char builtin_unprecops[][3] = {
-    "+", "-",
+    "+", "-", "!",
 };
 typedef enum {
-    UPOP_PLUS, UPOP_MINUS,
+    UPOP_PLUS, UPOP_MINUS, UPOP_NOT,
 } UnPrecOpType;
 const size_t n_builtin_funcs = sizeof(builtin_funcs) / sizeof(builtin_funcs[0]);
 const size_t n_builtin_vars = sizeof(builtin_vars) / sizeof(builtin_vars[0]);
 const size_t n_builtin_binops = sizeof(builtin_binops) / sizeof(builtin_binops[0]);
 const size_t n_builtin_unprecops = sizeof(builtin_unprecops) / sizeof(builtin_unprecops[0]);
 
-/*
-const char builtin_op_prec[][3][3] = { // with precedence info
-    {"*", "/", "%"},
-    {"+", "-"},
-    //{"<=", ">=", "<", ">"},
-    //{"="},
-    {"(", ")"}, // `)` shouldn't really have a precedence
-};
-const size_t n_builtin_op_precs = sizeof(builtin_op_prec) / sizeof(builtin_op_prec[0]);
-const size_t n_builtin_ops_per_prec = sizeof(builtin_op_prec[0]) / sizeof(builtin_op_prec[0][0]);
-*/
+// truth of a value for `!`, `&&`, `||` and `?`: nonzero, NaN is false like a failed comparison
+#define expr_truthy(v) (((v) < 0) | ((v) > 0)) // no short circuit, it stays a select in vector loops
 
 
 /* Token */
@@ -123,18 +89,14 @@ typedef enum {
     TT_BINOP, // binary operation
     TT_UNPRECOP, // unary preceding operation
     TT_LPARE, TT_RPARE,
+    TT_COMMA, // between function arguments
 } TokenType;
 
 typedef struct {
     TokenType type;
     union {
-        /*
-        struct {
-            char * begin;
-            size_t len;
-        } strview; // for VAR - now it is never used
-        */
-        float number;
+        int var; // parameter slot, see `param_index`
+        double number; // parsed once in double, narrowed per evaluation tier
         BinopType binop;
         UnPrecOpType unprecop;
         BVarType bvar;
@@ -148,9 +110,22 @@ typedef struct {
     size_t capacity;
 } Tokens;
 
+int param_index(char c);
 size_t expr_parse_token(Token * ret, char * begin, TokenType prev_type);
 char * trim_left(char * begin);
-int expr_tokenize(Tokens * tokens, String str);
+int expr_tokenize(Tokens * tokens, char * str);
+
+// single letter parameters: a-z then A-Z
+// letters taken by builtins (`x`, `y`, `e`, `t`) never get here, the builtin lists are tried first
+#define PARAM_COUNT 52
+int param_index(char c) {
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= 'A' && c <= 'Z') return 26 + c - 'A';
+    return -1;
+}
+char param_name(int index) {
+    return index < 26 ? 'a' + index : 'A' + index - 26;
+}
 
 // tokenize
 // @param prev_type: TT_NONE for start of expr
@@ -185,7 +160,7 @@ size_t expr_parse_token(Token * ret, char * begin, TokenType prev_type) { // ret
                 return len;
             }
         } break;
-    case TT_NONE: case TT_BINOP: case TT_UNPRECOP: case TT_LPARE:
+    case TT_NONE: case TT_BINOP: case TT_UNPRECOP: case TT_LPARE: case TT_COMMA:
         // unprecop
         for (size_t i = 0; i < n_builtin_unprecops; ++i) {
             int len = strlen(builtin_unprecops[i]);
@@ -199,20 +174,18 @@ size_t expr_parse_token(Token * ret, char * begin, TokenType prev_type) { // ret
     }
     
     // real number
-    float number;
+    double number;
     int numberlen;
-    if (sscanf(begin, "%f%n", &number, &numberlen) == 1) {
+    if (sscanf(begin, "%lf%n", &number, &numberlen) == 1) {
         *ret = (Token) {TT_NUMBER, {.number = number}};
         return numberlen;
     }
     
     // 1 character var
-    /*
-    if (isalpha((unsigned char)begin[0])) {
-        *ret = (Token) {TT_VAR, {.strview = {begin, 1}}};
+    if (param_index(begin[0]) >= 0) {
+        *ret = (Token) {TT_VAR, {.var = param_index(begin[0])}};
         return 1;
     }
-    */
 
     // pare
     if (begin[0] == '(') {
@@ -223,6 +196,10 @@ size_t expr_parse_token(Token * ret, char * begin, TokenType prev_type) { // ret
         *ret = (Token) {TT_RPARE};
         return 1;
     }
+    if (begin[0] == ',') {
+        *ret = (Token) {TT_COMMA};
+        return 1;
+    }
 
     // undefined token
     return 0;
@@ -233,10 +210,10 @@ char * trim_left(char * begin) { // non-mutating
     return begin;
 }
 
-int expr_tokenize(Tokens * tokens, String str) { // return 1 on failure
+int expr_tokenize(Tokens * tokens, char * str) { // return 1 on failure
     if (!tokens) return 1;
     
-    char * view = trim_left(str.items);
+    char * view = trim_left(str);
     Token tmp;
     TokenType prev_type = TT_NONE;
     while (*view != '\0') {
@@ -261,19 +238,6 @@ typedef struct ExprNode {
     size_t capacity;
 } ExprNode;
 
-typedef enum {
-    ES_NONE, // just after creation
-    ES_INVALID,
-    ES_VALID,
-} EquationState;
-
-typedef struct {
-    String editor;
-    String text; // internal copy of raw text
-    ExprNode expr; // references `text`
-    EquationState state;
-} Equation;
-
 typedef struct {
     // to which the successfully parsed tree should be attached, by the function called
     ExprNode * parent;
@@ -285,10 +249,8 @@ typedef struct {
 int build_op_node(ExprNode * operands, ExprNode operator);
 int expr_parse_BFUNC(Expr_Builder_Frame * frame); // responsible for deciding the end of subexpr
 int expr_parse(Expr_Builder_Frame * frame); // `frame` should already mark the end of this expr
-float expr_eval(ExprNode node, float x);
 void expr_free_node(ExprNode * node);
-int equation_parse(Equation * eq);
-void equation_free(Equation * eq);
+int expr_parse_text(ExprNode * root, char * text);
 
 // build tree
 #define tokstrcmp(tok, str) strncmp((tok).begin, str, (tok).len)
@@ -296,6 +258,14 @@ void equation_free(Equation * eq);
 int build_op_node(ExprNode * operands, ExprNode operator) {
     switch (operator.self.type) {
     case TT_BINOP:
+        if (operator.self.as.binop == BINOP_ELSE) { // a `?` that met its `:`
+            if (operands->count < 3) return 1;
+            operator.self.as.binop = BINOP_COND;
+            for (size_t i = operands->count - 3; i < operands->count; ++i) da_append(&operator, operands->items[i]);
+            operands->count -= 3;
+            da_append(operands, operator);
+            return 0;
+        }
         if (operands->count < 2) return 1;
         da_append(&operator, operands->items[operands->count - 2]);
         da_append(&operator, operands->items[operands->count - 1]);
@@ -315,22 +285,42 @@ int build_op_node(ExprNode * operands, ExprNode operator) {
 
 int get_op_prec(Token tok) { // -1 for not in list, op: BinopType | UnPrecOpType
     switch (tok.type) {
-    case TT_UNPRECOP:
-        // only +-
-        return 0;
     case TT_BINOP:
         switch (tok.as.binop) {
+        case BINOP_POW: // tighter than unary, -x^2 is -(x^2)
+            return 0;
         case BINOP_MULT: case BINOP_DIV: case BINOP_MOD:
-            return 1;
-        case BINOP_PLUS: case BINOP_MINUS:
             return 2;
+        case BINOP_PLUS: case BINOP_MINUS:
+            return 3;
+        case BINOP_LE: case BINOP_GE: case BINOP_LT: case BINOP_GT:
+            return 4;
+        case BINOP_EQ: case BINOP_NE:
+            return 5;
+        case BINOP_AND:
+            return 6;
+        case BINOP_OR:
+            return 7;
+        case BINOP_COND: case BINOP_ELSE:
+            return 8;
         }
+        return -1;
+    case TT_UNPRECOP:
+        // + - !
+        return 1;
     case TT_LPARE:
-        return 3;
+        return 9;
     default:
         return -1;
     }
 }
+bool is_op_right_assoc(Token tok) {
+    return tok.type == TT_BINOP &&
+        (tok.as.binop == BINOP_POW || tok.as.binop == BINOP_COND || tok.as.binop == BINOP_ELSE);
+}
+static bool is_op_open_cond(Token tok) { // a `?` still waiting for its `:`
+    return tok.type == TT_BINOP && tok.as.binop == BINOP_COND;
+}
 int expr_parse(Expr_Builder_Frame * frame) { // `frame` should contain the range of this expression
     if (frame->begin >= frame->end) return 1;
     
@@ -428,10 +418,28 @@ int expr_parse(Expr_Builder_Frame * frame) { // `frame` should contain the range
             da_append(&node, *elem);
             break;
             
-        case TT_BINOP: case TT_UNPRECOP: {
+        case TT_UNPRECOP:
+            // prefix, there is no left operand to pop for
+            da_append(&op_stack, *elem);
+            break;
+
+        case TT_BINOP: {
+            // `:` closes the middle operand like `)` does, then its `?` waits for the third
+            if (elem->self.as.binop == BINOP_ELSE) {
+                while (op_stack.count > 0 && !is_op_open_cond(op_stack.items[op_stack.count - 1].self)) {
+                    if (op_stack.items[op_stack.count - 1].self.type == TT_LPARE) error_cleanup();
+                    if (build_op_node(&node, op_stack.items[op_stack.count - 1])) error_cleanup();
+                    op_stack.count -= 1;
+                }
+                if (op_stack.count == 0) error_cleanup();
+                op_stack.items[op_stack.count - 1].self.as.binop = BINOP_ELSE;
+                break;
+            }
             int thisprec = get_op_prec(elem->self); // [!]
+            // right associative ops leave an equal one on the stack: a^b^c is a^(b^c)
+            int right = is_op_right_assoc(elem->self);
             while (op_stack.count > 0 &&
-                   thisprec >= get_op_prec(op_stack.items[op_stack.count - 1].self)) {
+                   thisprec - right >= get_op_prec(op_stack.items[op_stack.count - 1].self)) {
                 // pop
                 if (build_op_node(&node, op_stack.items[op_stack.count - 1])) error_cleanup();
                 op_stack.count -= 1;
@@ -492,20 +500,45 @@ int expr_parse_BFUNC(Expr_Builder_Frame * frame) {
     if (frame->begin + 1 >= frame->end || frame->begin->type != TT_BFUNC) return 1;
     ExprNode node = {.self = frame->begin[0]};
 
-    // f(expr)
+    int arity = bfunc_arity(node.self.as.bfunc);
+
+    // f(expr, expr, ...), every argument becomes a child
     if (frame->begin[1].type == TT_LPARE) {
+        Token * end = seek_expr_end(frame->begin + 2, frame->end);
+        if (end == NULL) return 1;
         Expr_Builder_Frame subframe = {
             .parent = &node,
             .begin = frame->begin + 2,
-            .end = seek_expr_end(frame->begin + 2, frame->end),
         };
-        if (subframe.end == NULL) return 1;
-        if (expr_parse(&subframe)) return 1; // node should not have anything in it anyway, freeing is redundant
-        // @assert subframe.begin == subframe.end
+        while (subframe.begin < end) {
+            // split at the commas outside of nested parentheses
+            size_t depth = 0;
+            subframe.end = subframe.begin;
+            while (subframe.end < end && (depth > 0 || subframe.end->type != TT_COMMA)) {
+                depth += (subframe.end->type == TT_LPARE) - (subframe.end->type == TT_RPARE);
+                subframe.end += 1;
+            }
+            Token * next = subframe.end + (subframe.end < end); // skip the comma
+            if (expr_parse(&subframe)) {
+                expr_free_node(&node);
+                return 1;
+            }
+            subframe.begin = next;
+            if (next == end && end[-1].type == TT_COMMA) { // trailing comma
+                expr_free_node(&node);
+                return 1;
+            }
+        }
+        if (arity > 0 ? (int)node.count != arity : node.count < 2) {
+            expr_free_node(&node);
+            return 1;
+        }
         da_append(frame->parent, node);
-        frame->begin = subframe.end + 1;
+        frame->begin = end + 1;
         return 0;
     }
+    // the forms without parentheses only take one argument
+    if (arity != 1) return 1;
 
     // ffx
     if (frame->begin[1].type == TT_BFUNC) {
@@ -540,72 +573,6 @@ int expr_parse_BFUNC(Expr_Builder_Frame * frame) {
 }
 
 
-// evaluate - demo, only one var
-//#define M_PI 3.14159265358979323846
-//#define M_E 2.7182818284590452354
-float expr_eval(ExprNode node, float x) {
-    switch (node.self.type) {
-    case TT_NONE: return expr_eval(node.items[0], x); // redundant layer
-    case TT_NUMBER: return node.self.as.number;
-    case TT_VAR: return NAN; // not implemented
-    case TT_BVAR:
-        switch (node.self.as.bvar) {
-        case BVAR_E: return M_E;
-        case BVAR_PI: return M_PI;
-        case BVAR_X: return x;
-        default: return NAN;
-        }
-    case TT_BFUNC: {
-        float t = expr_eval(node.items[0], x);
-        switch (node.self.as.bfunc) {
-        case BFUNC_SINH: return sinhf(t);
-        case BFUNC_COSH: return coshf(t);
-        case BFUNC_TANH: return tanhf(t);
-        case BFUNC_ASIN: return asinf(t);
-        case BFUNC_ACOS: return acosf(t);
-        case BFUNC_ATAN: return atanf(t);
-        case BFUNC_SIN: return sinf(t);
-        case BFUNC_COS: return cosf(t);
-        case BFUNC_TAN: return tanf(t);
-        case BFUNC_EXP: return expf(t);
-        case BFUNC_LOG: return logf(t);
-            //case BFUNC_POW: return pow(??);
-        case BFUNC_SQRT: return sqrtf(t);
-        case BFUNC_FLOOR: return floorf(t);
-        case BFUNC_CEIL: return ceilf(t);
-        case BFUNC_ROUND: return roundf(t);
-        case BFUNC_ABS: return fabsf(t);
-        case BFUNC_SGN: return (t > 0) - (t < 0);
-            //case BFUNC_HYPOT: return hypotf(??);
-            //case BFUNC_MIN: return ;
-            //case BFUNC_MAX: return ;
-        }
-    } break;
-    case TT_BINOP: {
-        float l = expr_eval(node.items[0], x);
-        float r = expr_eval(node.items[1], x);
-        switch (node.self.as.binop) {
-        case BINOP_PLUS: return l+r;
-        case BINOP_MINUS: return l-r;
-        case BINOP_MULT: return l*r;
-        case BINOP_DIV: return l/r;
-        case BINOP_MOD: return fmodf(l, r);
-        default: return NAN;
-        }
-    } break;
-    case TT_UNPRECOP: {
-        float t = expr_eval(node.items[0], x);
-        switch (node.self.as.unprecop) {
-        case UPOP_PLUS: return t;
-        case UPOP_MINUS: return -t;
-        default: return NAN;
-        }
-    } break;
-    default: return NAN;
-    }
-}
-
-
 void expr_free_node(ExprNode * node) {
     for (size_t i = 0; i < node->count; ++i) {
         expr_free_node(node->items + i);
@@ -622,7 +589,7 @@ void token_print(Token tok) {
         printf("Number (%f)", tok.as.number);
         break;
     case TT_VAR:
-        printf("Var");
+        printf("Var (%c)", param_name(tok.as.var));
         break;
     case TT_BVAR:
         printf("BuiltinVar");
@@ -637,12 +604,14 @@ void token_print(Token tok) {
                tok.as.binop == BINOP_MULT ? "mult" :
                tok.as.binop == BINOP_DIV ? "div" :
                tok.as.binop == BINOP_MOD ? "mod" :
-               "");
+               tok.as.binop == BINOP_POW ? "pow" :
+               builtin_binops[tok.as.binop]);
         break;
     case TT_UNPRECOP:
         printf("UnaryOp (%s)",
                tok.as.unprecop == UPOP_PLUS ? "plus" :
                tok.as.unprecop == UPOP_MINUS ? "minus" :
+               tok.as.unprecop == UPOP_NOT ? "not" :
                "");
         break;
     case TT_LPARE:
@@ -651,6 +620,9 @@ void token_print(Token tok) {
     case TT_RPARE:
         printf(")");
         break;
+    case TT_COMMA:
+        printf(",");
+        break;
     }
 }
 
@@ -667,14 +639,12 @@ void expr_print(ExprNode node, int indent) {
     printf("\n");
 }
 
-int equation_parse(Equation * eq) {
-    expr_free_node(&eq->expr); // cleanup old
-
-    printf("Parsing equation: %s\n", eq->text.items);
+// @param root: empty node, the tree gets attached under it
+int expr_parse_text(ExprNode * root, char * text) { // return 1 on failure
+    printf("Parsing equation: %s\n", text);
     
     Tokens tokens = {}; // shall not be referenced by expr tree
-    eq->state = expr_tokenize(&tokens, eq->text) == 0 ? ES_VALID : ES_INVALID;
-    if (eq->state == ES_INVALID) {
+    if (expr_tokenize(&tokens, text)) {
         da_free(&tokens);
         return 1;
     }
@@ -687,29 +657,22 @@ int equation_parse(Equation * eq) {
     printf("\n");
 
     Expr_Builder_Frame rootframe = {
-        &eq->expr,
+        root,
         tokens.items,
         tokens.items + tokens.count,
     };
-    eq->state = expr_parse(&rootframe) == 0 ? ES_VALID : ES_INVALID;
-    if (eq->state == ES_INVALID || rootframe.begin != rootframe.end) {
+    if (expr_parse(&rootframe) || rootframe.begin != rootframe.end) {
         da_free(&tokens);
-        // `expr` should have nothing in it
+        // `root` should have nothing in it
         return 1;
     }
 
     printf("Syntax tree:\n");
-    expr_print(eq->expr, 0);
+    expr_print(*root, 0);
     printf("\n\n");
 
     da_free(&tokens);
     return 0;
 }
 
-void equation_free(Equation * eq) {
-    da_free(&eq->editor);
-    da_free(&eq->text);
-    expr_free_node(&eq->expr);
-}
-
 #endif // EQUATION_H_
@@ -0,0 +1,462 @@
+#ifndef EQUATIONS_H_
+#define EQUATIONS_H_
+
+#include <stddef.h> // size_t
+#include <string.h> // memmove, memcpy, memcmp
+#include <math.h> // NAN, fabs
+
+#include "dynarray.h"
+#include "compile.h"
+
+typedef enum {
+    ES_NONE, // just after creation
+    ES_INVALID,
+    ES_VALID,
+} EquationState;
+
+typedef enum {
+    EK_GRAPH, // y = f(x)
+    EK_PARAMETRIC, // (f(t), g(t)), `prog` and `prog_y`
+    EK_POLAR, // r = f(θ)
+    EK_FIELD, // z = f(x, y), heatmap
+    EK_COMPLEX, // w = f(z), domain colouring
+} EquationKind;
+
+typedef struct {
+    String editor;
+    String text; // internal copy of raw text
+    Program * prog; // shared through `g_program_cache`, compiled from `text`
+    Program * prog_y; // second component of a parametric curve
+    Program * from, * to; // `f | a, b`: bounds of the shaded integral, constant expressions
+    EquationKind kind;
+    EquationState state;
+    char defines; // parameter name for `a = ...`, 0 for a curve; `prog` is then the right hand side
+    bool dirty; // curve needs to be sampled again
+
+    // slot bookkeeping for `Equations`
+    bool alive;
+    size_t row; // position in the sidebar, may be stale past `Equations.numbered`
+} Equation;
+
+int equation_parse(Equation * eq);
+bool equation_commit(Equation * eq); // return true if the text changed
+void equation_free(Equation * eq);
+
+// parsed and compiled, and the input matches the kind:
+// `x` means nothing on a curve, `t` nothing on a graph, `y` only something on a field,
+// a definition takes none of them and neither does `w = f(z)`, whose `z` is a parameter slot
+static bool equation_valid(Equation * eq) {
+    if (!eq->prog || !eq->prog->valid || (eq->prog_y && !eq->prog_y->valid)) return false;
+    if (eq->from && (eq->kind != EK_GRAPH || eq->defines || !eq->from->valid || !eq->to->valid ||
+                     eq->from->inputs || eq->to->inputs)) return false;
+    uint32_t inputs = eq->prog->inputs | (eq->prog_y ? eq->prog_y->inputs : 0);
+    if (eq->defines) return inputs == 0;
+    switch (eq->kind) {
+    case EK_GRAPH: return !(inputs & (INPUT_T | INPUT_Y));
+    case EK_FIELD: return !(inputs & INPUT_T);
+    case EK_COMPLEX: return inputs == 0;
+    default: return !(inputs & (INPUT_X | INPUT_Y));
+    }
+}
+
+// `(f, g)`: return the comma between the components, NULL for anything else
+static char * equation_find_pair(char * text, char ** close) {
+    if (*text != '(') return NULL;
+    int depth = 0;
+    char * comma = NULL;
+    for (char * p = text; *p; ++p) {
+        depth += (*p == '(') - (*p == ')');
+        if (*p == ',' && depth == 1 && !comma) comma = p;
+        if (depth == 0) {
+            *close = p;
+            return *trim_left(p + 1) == '\0' ? comma : NULL;
+        }
+    }
+    return NULL;
+}
+
+// `f | a, b`: return the `|`, not one of `||`, outside parentheses; `comma` splits the bounds
+static char * equation_find_bounds(char * text, char ** comma) {
+    int depth = 0;
+    char * bar = NULL;
+    *comma = NULL;
+    for (char * p = text; *p; ++p) {
+        depth += (*p == '(') - (*p == ')');
+        if (depth != 0) continue;
+        if (*p == '|' && p[1] != '|' && (p == text || p[-1] != '|') && !bar) bar = p;
+        else if (*p == ',' && bar && !*comma) *comma = p;
+    }
+    return bar && *comma ? bar : NULL;
+}
+
+int equation_parse(Equation * eq) {
+    char * text = trim_left(string_cstr(&eq->text));
+    eq->defines = 0;
+    eq->kind = EK_GRAPH;
+    Program * prog_y = NULL, * from = NULL, * to = NULL;
+
+    // the bounds are cut off first, whatever is left is parsed as usual
+    char * bounds_comma;
+    char * bar = equation_find_bounds(text, &bounds_comma);
+    if (bar) {
+        *bar = *bounds_comma = '\0';
+        from = program_cache_get(bar + 1);
+        to = program_cache_get(bounds_comma + 1);
+    }
+
+    // `a = expr` defines a parameter, any letter the tokenizer reads as a var,
+    // except `r = expr` which is a polar curve; `y = expr` is a graph like plain `expr`
+    char * eqsign = text[0] ? trim_left(text + 1) : text;
+    Token tok;
+    char * close;
+    char * comma = equation_find_pair(text, &close);
+    bool assign = eqsign[0] == '=' && eqsign[1] != '=' && expr_parse_token(&tok, text, TT_NONE) == 1;
+    if (assign && tok.type == TT_VAR) {
+        if (text[0] == 'r') eq->kind = EK_POLAR;
+        else eq->defines = text[0];
+        text = eqsign + 1;
+    } else if (assign && tok.type == TT_BVAR && tok.as.bvar == BVAR_Y) {
+        text = eqsign + 1;
+    } else if (comma) {
+        // the components go to the cache on their own, cut them out in place
+        eq->kind = EK_PARAMETRIC;
+        *comma = *close = '\0';
+        prog_y = program_cache_get(comma + 1);
+        text += 1;
+    }
+
+    Program * prog = program_cache_get(text);
+    if (comma && eq->kind == EK_PARAMETRIC) {
+        *comma = ',';
+        *close = ')';
+    }
+    if (bar) {
+        *bar = '|';
+        *bounds_comma = ',';
+    }
+    program_release(eq->prog);
+    program_release(eq->prog_y);
+    program_release(eq->from);
+    program_release(eq->to);
+    eq->prog = prog;
+    eq->prog_y = prog_y;
+    eq->from = from;
+    eq->to = to;
+
+    // `z = ...` reading `x` or `y` is a field, `w = ...` reading `z` is a complex map,
+    // otherwise both are plain definitions
+    if (eq->defines == 'z' && prog->inputs & (INPUT_X | INPUT_Y)) {
+        eq->kind = EK_FIELD;
+        eq->defines = 0;
+    }
+    if (eq->defines == 'w' && prog->deps >> param_index('z') & 1) {
+        eq->kind = EK_COMPLEX;
+        eq->defines = 0;
+    }
+
+    bool valid = equation_valid(eq);
+    eq->state = valid ? ES_VALID : ES_INVALID;
+    return !valid;
+}
+
+// unchanged text keeps its program, no hashing or parsing at all
+bool equation_commit(Equation * eq) {
+    if (eq->prog && eq->text.count == eq->editor.count &&
+        strcmp(string_cstr(&eq->text), string_cstr(&eq->editor)) == 0) return false;
+    string_copy(&eq->text, &eq->editor);
+    equation_parse(eq);
+    eq->dirty = true;
+    return true;
+}
+
+void equation_free(Equation * eq) {
+    string_free(&eq->editor);
+    string_free(&eq->text);
+    program_release(eq->prog);
+    program_release(eq->prog_y);
+    program_release(eq->from);
+    program_release(eq->to);
+    eq->prog = NULL;
+    eq->prog_y = NULL;
+    eq->from = NULL;
+    eq->to = NULL;
+}
+
+/*
+  equation store with stable ids:
+  an id is a slot index into `items` and never changes while the equation lives,
+  released slots are recycled through `free`,
+  the sidebar order is a separate list of ids
+ */
+
+typedef struct {
+    size_t * items;
+    size_t count;
+    size_t capacity;
+} Ids;
+
+/*
+  parameters: symbol table plus the dependency graph.
+  a definition is either a constant (gets a slider) or derived from other parameters,
+  curves read parameters at eval time, so a change never reparses anything
+ */
+typedef struct {
+    double values[PARAM_COUNT]; // passed to `program_eval_*` as is
+    uint64_t defined;
+    uint64_t derived; // defined through other parameters
+    size_t owner[PARAM_COUNT]; // id of the defining equation
+    Program * source[PARAM_COUNT]; // program the value came from
+    Ids dependents[PARAM_COUNT]; // ids of curves reading the parameter
+
+    // sliders, constant definitions only
+    double min[PARAM_COUNT], max[PARAM_COUNT];
+    uint64_t animating;
+    signed char dir[PARAM_COUNT];
+} Params;
+
+typedef struct {
+    Equation * items; // slots, indexed by id
+    size_t count;
+    size_t capacity;
+
+    Ids order; // ids in display order
+    Ids free; // released slots
+    size_t selected; // id, -1 for none
+    size_t numbered; // rows before this one hold their `row`, the rest are renumbered on demand
+
+    Params params;
+} Equations;
+
+size_t eqs_add(Equations * eqs, Equation eq); // return id, appended at the end of the order
+void eqs_remove(Equations * eqs, size_t id);
+Equation * eqs_get(Equations * eqs, size_t id); // NULL for none
+size_t eqs_row_id(Equations * eqs, size_t row);
+bool eqs_commit(Equations * eqs, size_t id); // return true if the text changed
+void eqs_rebuild_params(Equations * eqs);
+uint64_t eqs_propagate(Equations * eqs, uint64_t changed); // return every parameter affected
+void eqs_set_param(Equations * eqs, int slot, double value);
+bool eqs_animate(Equations * eqs, float dt); // return true if anything moved
+void eqs_free(Equations * eqs);
+
+size_t eqs_add(Equations * eqs, Equation eq) {
+    size_t id;
+    if (eqs->free.count > 0) {
+        id = eqs->free.items[--eqs->free.count];
+        eqs->items[id] = eq;
+    } else {
+        id = eqs->count;
+        da_append(eqs, eq);
+    }
+    eqs->items[id].alive = true;
+    eqs->items[id].dirty = true;
+    eqs->items[id].row = eqs->order.count;
+    if (eqs->numbered == eqs->order.count) eqs->numbered += 1;
+    da_append(&eqs->order, id);
+    return id;
+}
+
+// @algo: removal only shifts rows down, so a stale `row` is never below the real one and
+// any `row` under `numbered` is exact; otherwise walk on from `numbered` up to `id`
+static size_t eqs_row(Equations * eqs, size_t id) {
+    if (eqs->items[id].row < eqs->numbered) return eqs->items[id].row;
+    size_t r = eqs->numbered;
+    for (; eqs->order.items[r] != id; ++r) eqs->items[eqs->order.items[r]].row = r;
+    eqs->items[id].row = r;
+    eqs->numbered = r + 1;
+    return r;
+}
+
+// O(1) for the slot, the order closes the gap with one memmove of ids and the rows after it
+// are renumbered when asked for; the parameters are only rebuilt when the equation defined one
+void eqs_remove(Equations * eqs, size_t id) {
+    Equation * eq = eqs_get(eqs, id);
+    if (!eq) return;
+    size_t row = eqs_row(eqs, id);
+    Params * ps = &eqs->params;
+    int p = eq->defines ? param_index(eq->defines) : -1;
+    bool owner = p >= 0 && (ps->defined >> p & 1) && ps->owner[p] == id;
+    equation_free(eq);
+    *eq = (Equation) {};
+    da_append(&eqs->free, id);
+
+    memmove(eqs->order.items + row, eqs->order.items + row + 1,
+            (eqs->order.count - row - 1) * sizeof(eqs->order.items[0]));
+    eqs->order.count -= 1;
+    if (eqs->numbered > row) eqs->numbered = row;
+
+    if (eqs->selected == id) {
+        // select the neighbour above, like before
+        eqs->selected = eqs->order.count == 0 ? (size_t)-1
+            : eqs->order.items[row > 0 ? row - 1 : 0];
+    }
+    // a curve may stay in `dependents` until the next rebuild,
+    // marking its free or recycled slot dirty is harmless
+    if (owner) eqs_rebuild_params(eqs);
+}
+
+Equation * eqs_get(Equations * eqs, size_t id) {
+    if (id >= eqs->count || !eqs->items[id].alive) return NULL;
+    return eqs->items + id;
+}
+
+size_t eqs_row_id(Equations * eqs, size_t row) {
+    return row < eqs->order.count ? eqs->order.items[row] : (size_t)-1;
+}
+
+bool eqs_commit(Equations * eqs, size_t id) {
+    Equation * eq = eqs_get(eqs, id);
+    if (!eq || !equation_commit(eq)) return false;
+    eqs_rebuild_params(eqs);
+    return true;
+}
+
+// only after edits: rescans the definitions and the dependency graph
+void eqs_rebuild_params(Equations * eqs) {
+    Params * ps = &eqs->params;
+    double old_values[PARAM_COUNT];
+    uint64_t old_defined = ps->defined;
+    memcpy(old_values, ps->values, sizeof(old_values));
+    size_t old_owner[PARAM_COUNT];
+    Program * old_source[PARAM_COUNT];
+    memcpy(old_owner, ps->owner, sizeof(old_owner));
+    memcpy(old_source, ps->source, sizeof(old_source));
+
+    ps->defined = 0;
+    ps->derived = 0;
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        ps->dependents[p].count = 0;
+        ps->values[p] = NAN;
+    }
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        size_t id = eqs->order.items[row];
+        Equation * eq = eqs->items + id;
+        if (!equation_valid(eq)) continue;
+        eq->state = ES_VALID;
+        if (!eq->defines) {
+            uint64_t deps = eq->prog->deps | (eq->prog_y ? eq->prog_y->deps : 0) |
+                (eq->from ? eq->from->deps | eq->to->deps : 0);
+            for (int p = 0; p < PARAM_COUNT; ++p) {
+                if (deps >> p & 1) da_append(&ps->dependents[p], id);
+            }
+            continue;
+        }
+        int p = param_index(eq->defines);
+        uint64_t bit = 1ull << p;
+        if (ps->defined & bit) { // defined twice, first one wins
+            eq->state = ES_INVALID;
+            continue;
+        }
+        ps->defined |= bit;
+        ps->owner[p] = id;
+        ps->source[p] = eq->prog;
+        if (eq->prog->deps) {
+            ps->derived |= bit;
+            ps->animating &= ~bit;
+            continue;
+        }
+        // constant: keep the slider state if the definition did not change
+        if ((old_defined & bit) && old_owner[p] == id && old_source[p] == eq->prog) {
+            ps->values[p] = old_values[p];
+            continue;
+        }
+        double v = program_eval_d(eq->prog, ps->values, NAN);
+        ps->values[p] = v;
+        double r = fabs(v) > 10 ? 2 * fabs(v) : 10;
+        ps->min[p] = -r;
+        ps->max[p] = r;
+        ps->dir[p] = 1;
+        ps->animating &= ~bit;
+    }
+    ps->animating &= ps->defined;
+
+    // everything that appeared, vanished or moved counts as changed
+    uint64_t changed = ps->defined ^ old_defined;
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        if (memcmp(&ps->values[p], &old_values[p], sizeof(double)) != 0) changed |= 1ull << p;
+    }
+    eqs_propagate(eqs, changed | ps->derived);
+}
+
+// @algo: collect the closure of `changed` over derived parameters,
+// evaluate the affected ones in dependency order (a parameter is ready once none of
+// its inputs is still pending), then mark the curves reading any of them
+uint64_t eqs_propagate(Equations * eqs, uint64_t changed) {
+    Params * ps = &eqs->params;
+    uint64_t affected = changed;
+    for (bool grew = true; grew;) {
+        grew = false;
+        for (int p = 0; p < PARAM_COUNT; ++p) {
+            uint64_t bit = 1ull << p;
+            if ((ps->derived & bit) && !(affected & bit) && (ps->source[p]->deps & affected)) {
+                affected |= bit;
+                grew = true;
+            }
+        }
+    }
+
+    uint64_t pending = affected & ps->derived;
+    for (bool progress = true; pending && progress;) {
+        progress = false;
+        for (int p = 0; p < PARAM_COUNT; ++p) {
+            uint64_t bit = 1ull << p;
+            if (!(pending & bit) || (ps->source[p]->deps & pending)) continue;
+            ps->values[p] = program_eval_d(ps->source[p], ps->values, NAN);
+            pending &= ~bit;
+            progress = true;
+        }
+    }
+    // cycles never get ready
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        if (pending >> p & 1) {
+            ps->values[p] = NAN;
+            eqs->items[ps->owner[p]].state = ES_INVALID;
+        }
+    }
+
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        if (!(affected >> p & 1)) continue;
+        for (size_t i = 0; i < ps->dependents[p].count; ++i) {
+            eqs->items[ps->dependents[p].items[i]].dirty = true;
+        }
+    }
+    return affected;
+}
+
+void eqs_set_param(Equations * eqs, int slot, double value) {
+    if (eqs->params.values[slot] == value) return;
+    eqs->params.values[slot] = value;
+    eqs_propagate(eqs, 1ull << slot);
+}
+
+// sweep between the slider bounds in 4 seconds, bouncing at the ends
+bool eqs_animate(Equations * eqs, float dt) {
+    Params * ps = &eqs->params;
+    if (!ps->animating) return false;
+    uint64_t changed = 0;
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        if (!(ps->animating >> p & 1)) continue;
+        double v = ps->values[p] + ps->dir[p] * (ps->max[p] - ps->min[p]) / 4 * dt;
+        if (v > ps->max[p]) { v = ps->max[p]; ps->dir[p] = -1; }
+        if (v < ps->min[p]) { v = ps->min[p]; ps->dir[p] = 1; }
+        ps->values[p] = v;
+        changed |= 1ull << p;
+    }
+    eqs_propagate(eqs, changed);
+    return true;
+}
+
+void eqs_free(Equations * eqs) {
+    for (size_t i = 0; i < eqs->count; ++i) {
+        if (eqs->items[i].alive) equation_free(eqs->items + i);
+    }
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        da_free(&eqs->params.dependents[p]);
+    }
+    da_free(eqs);
+    da_free(&eqs->order);
+    da_free(&eqs->free);
+    eqs->selected = -1;
+    eqs->numbered = 0;
+}
+
+#endif // EQUATIONS_H_
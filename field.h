@@ -0,0 +1,404 @@
+#ifndef FIELD_H_
+#define FIELD_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t
+#include <stdbool.h>
+#include <stdlib.h> // malloc, free
+#include <string.h> // memset
+#include <stdatomic.h>
+#include <math.h> // floor, log2, isfinite
+#include <complex.h>
+#include <time.h> // clock_gettime
+#include <unistd.h> // sysconf
+#include <pthread.h>
+
+#include "viewport.h"
+#include "compile.h"
+
+/*
+  2d plots with one value per cell:
+  - `z = f(x, y)`: heatmap with contour bands
+  - `w = f(z)`: domain colouring, hue from the argument and bands from log2 |w|
+
+  the grid is split into FIELD_TILE² tiles, whose inputs and outputs fit in L2, and the
+  workers of `g_field_pool` claim them off an atomic counter.
+  progressive: a new view starts at a step of 2^FIELD_COARSE cells and every level halves
+  the step, each sample filling its step² block until a finer level covers it, so there is
+  always a whole picture. a frame spends at most its budget on it and continues next frame
+ */
+
+#define FIELD_TILE 64 // cells, 2 * 32 KiB of inputs and 32 KiB of values per tile
+#define FIELD_COARSE 3 // first level samples every 8th cell
+#define FIELD_BANDS 12 // heatmap colour bands
+#define FIELD_MAX_THREADS 16
+#define FIELD_NO_BAND 0xFF
+
+typedef enum {
+    FIELD_HEAT,
+    FIELD_COMPLEX,
+} FieldKind;
+
+typedef struct {
+    FieldKind kind;
+    Program * prog;
+    const double * params;
+    Viewport vp;
+    int width, height; // cells
+} FieldJob;
+
+typedef struct {
+    FieldJob job;
+    double * re, * im; // width * height, `im` for complex only
+    uint32_t * pixels; // RGBA8, row 0 at the bottom of the view
+    uint8_t * band; // heatmap band per cell, FIELD_NO_BAND where undefined
+    uint8_t * dirty; // per tile, evaluated since the last colouring
+    int capacity; // cells allocated
+    int tile_capacity;
+
+    int level; // step 2^level of the samples being added, -1 when done
+    atomic_int next_tile; // claimed so far in this level
+    int tiles_x, tiles_y;
+    double lo, hi; // heatmap range, from the first level
+    double deadline; // for the workers, monotonic seconds
+    atomic_size_t evals; // this frame
+} Field;
+
+void field_reset(Field * f, FieldJob job);
+bool field_step(Field * f, double budget_ms); // return true if the picture changed
+void field_free(Field * f);
+
+static double field_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+  fork / join pool: `field_pool_run` wakes every worker on `fn`, runs it on the calling
+  thread too and returns once all of them are back, so nothing is shared between frames
+ */
+typedef struct {
+    pthread_t threads[FIELD_MAX_THREADS];
+    int count; // workers, besides the caller
+    pthread_mutex_t lock;
+    pthread_cond_t wake, idle;
+    unsigned round;
+    int busy;
+    bool quit;
+    void (*fn)(void *);
+    void * ctx;
+} FieldPool;
+
+static FieldPool g_field_pool = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .idle = PTHREAD_COND_INITIALIZER};
+
+void field_pool_run(void (*fn)(void *), void * ctx);
+void field_pool_stop();
+
+static void * field_worker(void * arg) {
+    (void)arg;
+    FieldPool * p = &g_field_pool;
+    unsigned seen = 0;
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->quit && p->round == seen) pthread_cond_wait(&p->wake, &p->lock);
+        if (p->quit) break;
+        seen = p->round;
+        pthread_mutex_unlock(&p->lock);
+        p->fn(p->ctx);
+        pthread_mutex_lock(&p->lock);
+        if (--p->busy == 0) pthread_cond_signal(&p->idle);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+// workers start on first use, one per core besides the caller
+void field_pool_run(void (*fn)(void *), void * ctx) {
+    FieldPool * p = &g_field_pool;
+    static bool started = false;
+    if (!started) {
+        started = true;
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        int n = cores > FIELD_MAX_THREADS ? FIELD_MAX_THREADS : cores > 1 ? cores - 1 : 0;
+        for (int i = 0; i < n; ++i) {
+            if (pthread_create(&p->threads[p->count], NULL, field_worker, NULL) != 0) break;
+            p->count += 1;
+        }
+    }
+    pthread_mutex_lock(&p->lock);
+    p->fn = fn;
+    p->ctx = ctx;
+    p->busy = p->count;
+    p->round += 1;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+    fn(ctx);
+    pthread_mutex_lock(&p->lock);
+    while (p->busy > 0) pthread_cond_wait(&p->idle, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+void field_pool_stop() {
+    FieldPool * p = &g_field_pool;
+    pthread_mutex_lock(&p->lock);
+    p->quit = true;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+    for (int i = 0; i < p->count; ++i) pthread_join(p->threads[i], NULL);
+    p->count = 0;
+}
+
+void field_reset(Field * f, FieldJob job) {
+    int cells = job.width * job.height;
+    if (cells > f->capacity) {
+        f->capacity = cells;
+        f->re = reallocf(f->re, cells * sizeof(double));
+        f->im = reallocf(f->im, cells * sizeof(double));
+        f->pixels = reallocf(f->pixels, cells * sizeof(uint32_t));
+        f->band = reallocf(f->band, cells);
+        if (!f->re || !f->im || !f->pixels || !f->band) exit(1);
+    }
+    f->job = job;
+    f->level = FIELD_COARSE;
+    atomic_store(&f->next_tile, 0);
+    f->tiles_x = (job.width + FIELD_TILE - 1) / FIELD_TILE;
+    f->tiles_y = (job.height + FIELD_TILE - 1) / FIELD_TILE;
+    if (f->tiles_x * f->tiles_y > f->tile_capacity) {
+        f->tile_capacity = f->tiles_x * f->tiles_y;
+        f->dirty = reallocf(f->dirty, f->tile_capacity);
+        if (!f->dirty) exit(1);
+    }
+}
+
+void field_free(Field * f) {
+    free(f->re);
+    free(f->im);
+    free(f->pixels);
+    free(f->band);
+    free(f->dirty);
+    *f = (Field) {};
+}
+
+typedef struct {
+    double xs[EVAL_BLOCK], ys[EVAL_BLOCK], out[EVAL_BLOCK];
+    int at[EVAL_BLOCK]; // cell index of each sample
+    size_t n;
+} FieldBatch;
+
+// evaluate the batch and fill the block each sample stands for, clipped to the tile
+static void field_flush(Field * f, FieldBatch * b, int step, int x1, int y1) {
+    FieldJob * j = &f->job;
+    if (j->kind == FIELD_HEAT) program_eval_field_d(j->prog, j->params, b->xs, b->ys, b->out, b->n);
+    for (size_t i = 0; i < b->n; ++i) {
+        double re = b->out[i], im = 0;
+        if (j->kind == FIELD_COMPLEX) {
+            double complex w = program_eval_c(j->prog, j->params, CMPLX(b->xs[i], b->ys[i]));
+            re = creal(w);
+            im = cimag(w);
+        }
+        int x0 = b->at[i] % j->width, y0 = b->at[i] / j->width;
+        int bx = x0 + step < x1 ? x0 + step : x1, by = y0 + step < y1 ? y0 + step : y1;
+        for (int y = y0; y < by; ++y) {
+            for (int x = x0; x < bx; ++x) {
+                f->re[y * j->width + x] = re;
+                f->im[y * j->width + x] = im;
+            }
+        }
+    }
+    atomic_fetch_add_explicit(&f->evals, b->n, memory_order_relaxed);
+    b->n = 0;
+}
+
+// the samples of level `level` inside tile `t`: every cell on the 2^level lattice that
+// no coarser level has taken, which is all of them on the first level
+static void field_eval_tile(Field * f, int t) {
+    FieldJob * j = &f->job;
+    int step = 1 << f->level;
+    bool first = f->level == FIELD_COARSE;
+    int x0 = t % f->tiles_x * FIELD_TILE, y0 = t / f->tiles_x * FIELD_TILE;
+    int x1 = x0 + FIELD_TILE < j->width ? x0 + FIELD_TILE : j->width;
+    int y1 = y0 + FIELD_TILE < j->height ? y0 + FIELD_TILE : j->height;
+    double sx = j->vp.span_x / j->width, sy = j->vp.span_y / j->height;
+    double cx = dd_to_double(j->vp.cx), cy = dd_to_double(j->vp.cy);
+
+    FieldBatch b;
+    b.n = 0;
+    for (int y = y0; y < y1; y += step) {
+        for (int x = x0; x < x1; x += step) {
+            if (!first && (x & step) == 0 && (y & step) == 0) continue; // on the coarser lattice
+            // cell centres, offsets from the centre of the view like the graph sampler
+            b.xs[b.n] = cx + (x + 0.5 - j->width * 0.5) * sx;
+            b.ys[b.n] = cy + (y + 0.5 - j->height * 0.5) * sy;
+            b.at[b.n++] = y * j->width + x;
+            if (b.n == EVAL_BLOCK) field_flush(f, &b, step, x1, y1);
+        }
+    }
+    if (b.n > 0) field_flush(f, &b, step, x1, y1);
+}
+
+// the first level always completes, it sets the colour range and is cheap
+static void field_eval_worker(void * arg) {
+    Field * f = arg;
+    int tiles = f->tiles_x * f->tiles_y;
+    while (f->level == FIELD_COARSE || field_now() < f->deadline) {
+        int t = atomic_fetch_add(&f->next_tile, 1);
+        if (t >= tiles) break;
+        field_eval_tile(f, t);
+        f->dirty[t] = 1;
+    }
+}
+
+static uint32_t field_rgba(double r, double g, double b) {
+    uint32_t R = r * 255 + 0.5, G = g * 255 + 0.5, B = b * 255 + 0.5;
+    return R | G << 8 | B << 16 | 0xFFu << 24; // bytes in memory: r g b a
+}
+
+// a short perceptual ramp, dark blue to yellow, t in [0, 1]
+static uint32_t field_ramp(double t, double shade) {
+    static const double ramp[][3] = {
+        {0.27, 0.00, 0.33}, {0.23, 0.32, 0.55}, {0.13, 0.57, 0.55}, {0.37, 0.79, 0.38}, {0.99, 0.91, 0.14},
+    };
+    int n = sizeof(ramp) / sizeof(ramp[0]) - 1;
+    double u = (!(t > 0) ? 0 : t > 1 ? 1 : t) * n; // NaN at the bottom
+    int k = u >= n ? n - 1 : (int)u;
+    u -= k;
+    return field_rgba((ramp[k][0] + (ramp[k + 1][0] - ramp[k][0]) * u) * shade,
+                      (ramp[k][1] + (ramp[k + 1][1] - ramp[k][1]) * u) * shade,
+                      (ramp[k][2] + (ramp[k + 1][2] - ramp[k][2]) * u) * shade);
+}
+
+// the ramp sampled once per band and shade
+static uint32_t g_field_palette[FIELD_BANDS][2]; // [band][on a contour]
+
+static void field_palette_init() {
+    for (int b = 0; b < FIELD_BANDS; ++b) {
+        g_field_palette[b][0] = field_ramp((b + 0.5) / FIELD_BANDS, 1);
+        g_field_palette[b][1] = field_ramp((b + 0.5) / FIELD_BANDS, 0.6);
+    }
+}
+
+// hue from the argument, brightness rising through each doubling of the modulus
+static uint32_t field_complex_colour(double re, double im) {
+    double h = atan2(im, re) / (2 * M_PI) + 1, m = log2(hypot(re, im));
+    if (!isfinite(m)) return m < 0 ? field_rgba(0, 0, 0) : field_rgba(1, 1, 1); // a zero, or past DBL_MAX
+    h = (h - floor(h)) * 6;
+    double v = 0.6 + 0.4 * (m - floor(m));
+    int k = (int)h % 6;
+    double u = h - floor(h);
+    double p = v * 0.1, q = v * (1 - 0.9 * u), s = v * (1 - 0.9 * (1 - u));
+    switch (k) {
+    case 0: return field_rgba(v, s, p);
+    case 1: return field_rgba(q, v, p);
+    case 2: return field_rgba(p, v, s);
+    case 3: return field_rgba(p, q, v);
+    case 4: return field_rgba(s, p, v);
+    default: return field_rgba(v, p, q);
+    }
+}
+
+#define field_tile_bounds(f, t)                                         \
+    int x0 = (t) % (f)->tiles_x * FIELD_TILE, y0 = (t) / (f)->tiles_x * FIELD_TILE; \
+    int x1 = x0 + FIELD_TILE < (f)->job.width ? x0 + FIELD_TILE : (f)->job.width; \
+    int y1 = y0 + FIELD_TILE < (f)->job.height ? y0 + FIELD_TILE : (f)->job.height
+
+// pass 1: bands of the tiles that changed
+static void field_band_worker(void * arg) {
+    Field * f = arg;
+    int tiles = f->tiles_x * f->tiles_y;
+    double scale = FIELD_BANDS / (f->hi - f->lo);
+    for (int t; (t = atomic_fetch_add(&f->next_tile, 1)) < tiles;) {
+        if (!f->dirty[t]) continue;
+        field_tile_bounds(f, t);
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                int i = y * f->job.width + x;
+                double u = (f->re[i] - f->lo) * scale;
+                f->band[i] = !isfinite(u) ? FIELD_NO_BAND : u < 0 ? 0 : u >= FIELD_BANDS ? FIELD_BANDS - 1 : (int)u;
+            }
+        }
+    }
+}
+
+// pass 2: pixels of the tiles that changed, and of those whose right or upper
+// neighbour changed, since the contours look across the tile edge
+static void field_colour_worker(void * arg) {
+    Field * f = arg;
+    FieldJob * j = &f->job;
+    int tiles = f->tiles_x * f->tiles_y;
+    for (int t; (t = atomic_fetch_add(&f->next_tile, 1)) < tiles;) {
+        bool right = t % f->tiles_x + 1 < f->tiles_x && f->dirty[t + 1];
+        bool up = t + f->tiles_x < tiles && f->dirty[t + f->tiles_x];
+        if (!f->dirty[t] && (j->kind == FIELD_COMPLEX || (!right && !up))) continue;
+        field_tile_bounds(f, t);
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                int i = y * j->width + x;
+                if (j->kind == FIELD_COMPLEX) {
+                    bool ok = isfinite(f->re[i]) && isfinite(f->im[i]);
+                    f->pixels[i] = ok ? field_complex_colour(f->re[i], f->im[i]) : 0;
+                    continue;
+                }
+                int b = f->band[i];
+                if (b == FIELD_NO_BAND) {
+                    f->pixels[i] = 0; // transparent, the background shows through
+                    continue;
+                }
+                // a contour where the band changes towards the right or upper neighbour
+                int r = x + 1 < j->width ? f->band[i + 1] : b;
+                int u = y + 1 < j->height ? f->band[i + j->width] : b;
+                bool edge = (r != b && r != FIELD_NO_BAND) || (u != b && u != FIELD_NO_BAND);
+                f->pixels[i] = g_field_palette[b][edge];
+            }
+        }
+    }
+}
+
+// the band range comes from the first level, so the colours hold still while refining
+static void field_range(Field * f) {
+    double lo = INFINITY, hi = -INFINITY;
+    int step = 1 << FIELD_COARSE;
+    for (int y = 0; y < f->job.height; y += step) {
+        for (int x = 0; x < f->job.width; x += step) {
+            double v = f->re[y * f->job.width + x];
+            if (isfinite(v) && v < lo) lo = v;
+            if (isfinite(v) && v > hi) hi = v;
+        }
+    }
+    if (!(lo < hi)) {
+        lo = isfinite(lo) ? lo - 1 : 0;
+        hi = lo + 2;
+    }
+    f->lo = lo;
+    f->hi = hi;
+}
+
+// @algo: levels run to completion or to the deadline, whichever is first; a level that is
+// cut short keeps its counter, and the tiles it did finish show their finer samples already
+bool field_step(Field * f, double budget_ms) {
+    if (f->level < 0) return false;
+    if (!g_field_palette[0][0]) field_palette_init();
+    atomic_store(&f->evals, 0);
+    f->deadline = field_now() + budget_ms * 1e-3;
+    int tiles = f->tiles_x * f->tiles_y;
+    do {
+        field_pool_run(field_eval_worker, f);
+        if (atomic_load(&f->next_tile) < tiles) break; // out of time
+        if (f->level == FIELD_COARSE) field_range(f);
+        f->level -= 1;
+        atomic_store(&f->next_tile, 0);
+    } while (f->level >= 0 && field_now() < f->deadline);
+    // colour what changed, also parallel; a level cut short shows partly refined
+    int next = atomic_load(&f->next_tile);
+    if (f->job.kind == FIELD_HEAT) {
+        atomic_store(&f->next_tile, 0);
+        field_pool_run(field_band_worker, f);
+    }
+    atomic_store(&f->next_tile, 0);
+    field_pool_run(field_colour_worker, f);
+    memset(f->dirty, 0, tiles);
+    atomic_store(&f->next_tile, next);
+    return true;
+}
+
+#endif // FIELD_H_
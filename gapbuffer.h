@@ -0,0 +1,221 @@
+#ifndef GAPBUFFER_H_
+#define GAPBUFFER_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdlib.h> // alloc
+#include <string.h> // memmove, memcpy, strlen
+#include <ctype.h> // isalnum
+#include <stdbool.h>
+
+/* String */
+
+/*
+  gap buffer:
+  items = [0, gap_begin) text, [gap_begin, gap_end) gap, [gap_end, capacity) text
+  editing moves the gap to the edit position, so typing in the middle of a long
+  text only shifts the bytes between the previous and the current edit
+ */
+typedef struct {
+    char * items;
+    size_t count; // text length, excluding the gap
+    size_t capacity;
+
+    size_t gap_begin, gap_end;
+    size_t cursor; // logical position, 0..count
+    size_t anchor; // other end of the selection, == cursor for none
+} String;
+
+String string_createEmpty();
+String string_createFrom(const char * cstr);
+void string_free(String * str);
+char string_at(String * str, size_t i);
+char * string_cstr(String * str); // contiguous, null terminated, valid until the next edit
+void string_copy(String * dst, String * src); // contiguous copy of the text
+size_t string_copy_range(String * str, size_t begin, size_t end, char * out); // return bytes written, no terminator
+void string_append(String * str, char c);
+void string_insert(String * str, char c);
+void string_insert_n(String * str, const char * s, size_t n); // replaces the selection
+void string_backspace(String * str);
+void string_delete(String * str);
+bool string_has_selection(String * str);
+void string_selection(String * str, size_t * begin, size_t * end);
+void string_delete_selection(String * str);
+void string_move_cursor(String * str, size_t pos, bool select);
+size_t string_word_left(String * str, size_t pos);
+size_t string_word_right(String * str, size_t pos);
+
+// keep at least one byte of gap, `string_cstr` writes the terminator there
+static void string_reserve(String * str, size_t n) {
+    size_t gap = str->gap_end - str->gap_begin;
+    if (gap >= n + 1) return;
+    size_t new_capacity = str->capacity == 0 ? 16 : str->capacity * 2;
+    while (new_capacity - str->count < n + 1) new_capacity *= 2;
+    str->items = reallocf(str->items, new_capacity);
+    size_t tail = str->capacity - str->gap_end;
+    memmove(str->items + new_capacity - tail, str->items + str->gap_end, tail);
+    str->gap_end = new_capacity - tail;
+    str->capacity = new_capacity;
+}
+
+static void string_move_gap(String * str, size_t pos) {
+    if (pos < str->gap_begin) {
+        size_t n = str->gap_begin - pos;
+        memmove(str->items + str->gap_end - n, str->items + pos, n);
+        str->gap_begin -= n;
+        str->gap_end -= n;
+    } else if (pos > str->gap_begin) {
+        size_t n = pos - str->gap_begin;
+        memmove(str->items + str->gap_begin, str->items + str->gap_end, n);
+        str->gap_begin += n;
+        str->gap_end += n;
+    }
+}
+
+String string_createEmpty() {
+    String str = {};
+    string_reserve(&str, 0);
+    str.items[0] = 0;
+    return str;
+}
+
+String string_createFrom(const char * cstr) {
+    String str = string_createEmpty();
+    string_insert_n(&str, cstr, strlen(cstr));
+    return str;
+}
+
+void string_free(String * str) {
+    free(str->items);
+    *str = (String) {};
+}
+
+char string_at(String * str, size_t i) {
+    return i < str->gap_begin ? str->items[i] : str->items[i + (str->gap_end - str->gap_begin)];
+}
+
+char * string_cstr(String * str) {
+    if (!str->items) string_reserve(str, 0);
+    string_move_gap(str, str->count);
+    str->items[str->count] = 0;
+    return str->items;
+}
+
+void string_copy(String * dst, String * src) {
+    size_t cursor = dst->cursor;
+    dst->count = 0;
+    dst->gap_begin = 0;
+    dst->gap_end = dst->capacity;
+    string_reserve(dst, src->count);
+    string_copy_range(src, 0, src->count, dst->items);
+    dst->count = src->count;
+    dst->gap_begin = src->count;
+    dst->items[dst->count] = 0;
+    dst->cursor = dst->anchor = cursor < dst->count ? cursor : dst->count;
+}
+
+size_t string_copy_range(String * str, size_t begin, size_t end, char * out) {
+    if (end > str->count) end = str->count;
+    if (begin >= end) return 0;
+    size_t n = 0;
+    if (begin < str->gap_begin) {
+        size_t head = (end < str->gap_begin ? end : str->gap_begin) - begin;
+        memcpy(out, str->items + begin, head);
+        n += head;
+        begin += head;
+    }
+    if (begin < end) {
+        memcpy(out + n, str->items + begin + (str->gap_end - str->gap_begin), end - begin);
+        n += end - begin;
+    }
+    return n;
+}
+
+void string_append(String * str, char c) {
+    string_reserve(str, 1);
+    string_move_gap(str, str->count);
+    str->items[str->gap_begin++] = c;
+    str->count += 1;
+}
+
+void string_insert(String * str, char c) {
+    string_insert_n(str, &c, 1);
+}
+
+void string_insert_n(String * str, const char * s, size_t n) {
+    string_delete_selection(str);
+    string_reserve(str, n);
+    string_move_gap(str, str->cursor);
+    memcpy(str->items + str->gap_begin, s, n);
+    str->gap_begin += n;
+    str->count += n;
+    str->cursor += n;
+    str->anchor = str->cursor;
+}
+
+void string_backspace(String * str) {
+    if (string_has_selection(str)) {
+        string_delete_selection(str);
+        return;
+    }
+    if (str->cursor == 0) return;
+    string_move_gap(str, str->cursor);
+    str->gap_begin -= 1;
+    str->count -= 1;
+    str->cursor -= 1;
+    str->anchor = str->cursor;
+}
+
+void string_delete(String * str) {
+    if (string_has_selection(str)) {
+        string_delete_selection(str);
+        return;
+    }
+    if (str->cursor >= str->count) return;
+    string_move_gap(str, str->cursor);
+    str->gap_end += 1;
+    str->count -= 1;
+}
+
+bool string_has_selection(String * str) {
+    return str->anchor != str->cursor;
+}
+
+void string_selection(String * str, size_t * begin, size_t * end) {
+    *begin = str->anchor < str->cursor ? str->anchor : str->cursor;
+    *end = str->anchor < str->cursor ? str->cursor : str->anchor;
+}
+
+void string_delete_selection(String * str) {
+    if (!string_has_selection(str)) return;
+    size_t begin, end;
+    string_selection(str, &begin, &end);
+    string_move_gap(str, begin);
+    str->gap_end += end - begin;
+    str->count -= end - begin;
+    str->cursor = str->anchor = begin;
+}
+
+void string_move_cursor(String * str, size_t pos, bool select) {
+    if (pos > str->count) pos = str->count;
+    str->cursor = pos;
+    if (!select) str->anchor = pos;
+}
+
+static bool string_is_word(char c) {
+    return isalnum((unsigned char)c) || c == '.' || c == '_';
+}
+
+// skip separators, then the word
+size_t string_word_left(String * str, size_t pos) {
+    while (pos > 0 && !string_is_word(string_at(str, pos - 1))) pos -= 1;
+    while (pos > 0 && string_is_word(string_at(str, pos - 1))) pos -= 1;
+    return pos;
+}
+
+size_t string_word_right(String * str, size_t pos) {
+    while (pos < str->count && !string_is_word(string_at(str, pos))) pos += 1;
+    while (pos < str->count && string_is_word(string_at(str, pos))) pos += 1;
+    return pos;
+}
+
+#endif // GAPBUFFER_H_
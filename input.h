@@ -0,0 +1,436 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint8_t, uint64_t
+#include <stdbool.h>
+#include <stdio.h> // FILE, fopen, fread, fwrite
+#include <stdlib.h> // exit, free, qsort
+#include <string.h> // memcmp, memcpy, strlen
+#include <time.h> // clock
+
+#include <raylib.h>
+
+#include "dynarray.h"
+
+/*
+  every frame starts with a snapshot of the raylib input, and the components read the
+  snapshot instead of raylib. the snapshot either comes from raylib, and is optionally
+  appended to a recording, or is read back from a recording:
+  [header][frame record, its keys, chars and clipboard text]...
+
+  a key or button only appears in a frame it is held, pressed, released or repeated in,
+  an idle frame is one fixed size record. replay steps animations by `INPUT_REPLAY_DT`
+  instead of the wall clock and resizes the window where the recording did, so a session
+  plays back the same under a virtual framebuffer (`xvfb-run`) on any machine.
+  a paced replay hands out one record every `INPUT_REPLAY_DT` of wall time instead, as
+  events would arrive live, so the waiting loop and `--poll` can be compared on one session
+ */
+
+#define INPUT_MAGIC "GRAPHIR" // 8 bytes with the terminator
+#define INPUT_FORMAT 1
+#define INPUT_BYTE_ORDER 0x01020304u
+#define INPUT_KEYS 352 // above `KEY_KB_MENU`
+#define INPUT_BUTTONS 7 // `MOUSE_BUTTON_LEFT` .. `MOUSE_BUTTON_BACK`
+#define INPUT_MAX_CHARS 32 // per frame, the rest of raylib's queue waits for the next one
+#define INPUT_REPLAY_DT (1.0f / 60)
+
+typedef enum {
+    INPUT_LIVE,
+    INPUT_RECORD, // live, and written to `file`
+    INPUT_REPLAY, // read from `file`
+} InputMode;
+
+enum { // per key and per button
+    IN_DOWN = 1,
+    IN_PRESSED = 2,
+    IN_RELEASED = 4,
+    IN_REPEAT = 8,
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t format;
+    int32_t width, height; // of the window when the recording started
+} InputHeader;
+
+typedef struct {
+    float mouse_x, mouse_y, delta_x, delta_y, wheel_x, wheel_y;
+    int32_t width, height;
+    uint8_t buttons[INPUT_BUTTONS];
+    uint8_t resized;
+    uint16_t n_keys, n_chars; // followed by `n_keys` InputKey and `n_chars` int32_t
+    uint32_t clip_len; // followed by the text read from the clipboard in this frame
+} InputRecord;
+
+typedef struct {
+    uint16_t key;
+    uint8_t flags;
+    uint8_t pad;
+} InputKey;
+
+typedef struct {
+    char * items;
+    size_t count;
+    size_t capacity;
+} InputText;
+
+typedef struct {
+    double * items; // seconds
+    size_t count;
+    size_t capacity;
+} InputLatencies;
+
+typedef struct {
+    InputMode mode;
+    FILE * file;
+    uint64_t frame; // frames begun
+    InputRecord rec; // this frame
+    uint8_t keys[INPUT_KEYS];
+    int chars[INPUT_MAX_CHARS];
+    size_t next_char;
+    InputText clip; // read from the clipboard in this frame, or read back from the recording
+    bool clip_read; // live: `clip` holds this frame's read
+
+    bool waiting; // the loop sleeps until the next event
+    bool paced; // replay: record k arrives about `k * INPUT_REPLAY_DT` after the first
+    uint64_t records; // read so far
+    double start; // wall time of the first record
+    double arrival; // of this frame's input, -1 for none
+    clock_t cpu_start;
+    InputLatencies latencies; // from the arrival until the frame that took it is drawn
+} Input;
+
+Input g_input;
+
+int input_record(const char * path); // return 1 on failure
+int input_replay(const char * path); // return 1 on failure, resizes the window
+void input_pace(); // after `input_replay`, plays the records at the speed they were recorded
+void input_wait(bool waiting); // whether the next frame waits for an event, `EnableEventWaiting` live
+bool input_begin_frame(); // return false when the window closes or the recording ends
+void input_drawn(); // before `EndDrawing`, the frame took its input
+void input_end_frame(); // after `EndDrawing`
+void input_pace_report(); // cpu, frames drawn and latencies of a paced replay
+void input_close();
+
+bool input_key_down(int key);
+bool input_key_pressed(int key);
+bool input_key_repeat(int key);
+bool input_mouse_down(int button);
+bool input_mouse_pressed(int button);
+bool input_mouse_released(int button);
+Vector2 input_mouse();
+Vector2 input_mouse_delta();
+Vector2 input_wheel();
+int input_char(); // the next typed codepoint, 0 for none
+const char * input_clipboard(); // NULL if empty
+void input_set_clipboard(const char * text);
+bool input_resized();
+int input_width();
+int input_height();
+float input_dt(); // seconds since the last frame
+
+int input_record(const char * path) {
+    FILE * f = fopen(path, "wb");
+    if (!f) return 1;
+    InputHeader h = {
+        .magic = INPUT_MAGIC,
+        .byte_order = INPUT_BYTE_ORDER,
+        .format = INPUT_FORMAT,
+        .width = GetScreenWidth(),
+        .height = GetScreenHeight(),
+    };
+    if (fwrite(&h, sizeof(h), 1, f) != 1) {
+        fclose(f);
+        return 1;
+    }
+    g_input.mode = INPUT_RECORD;
+    g_input.file = f;
+    return 0;
+}
+
+int input_replay(const char * path) {
+    FILE * f = fopen(path, "rb");
+    if (!f) return 1;
+    InputHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, INPUT_MAGIC, sizeof(h.magic)) != 0 ||
+        h.byte_order != INPUT_BYTE_ORDER || h.format != INPUT_FORMAT) {
+        fclose(f);
+        return 1;
+    }
+    SetWindowSize(h.width, h.height);
+    g_input.mode = INPUT_REPLAY;
+    g_input.file = f;
+    return 0;
+}
+
+void input_pace() {
+    g_input.paced = true;
+}
+
+// replay has no events to wait for, `input_begin_frame` sleeps instead
+void input_wait(bool waiting) {
+    g_input.waiting = waiting;
+    if (g_input.mode == INPUT_REPLAY) return;
+    if (waiting) EnableEventWaiting();
+    else DisableEventWaiting();
+}
+
+static void input_text_set(InputText * t, const char * s, size_t n) {
+    t->count = 0;
+    for (size_t i = 0; i < n; ++i) da_append(t, s[i]);
+    da_append(t, '\0');
+}
+
+static bool input_read_frame(Input * in) {
+    FILE * f = in->file;
+    InputRecord * rec = &in->rec;
+    if (fread(rec, sizeof(*rec), 1, f) != 1) return false;
+    memset(in->keys, 0, sizeof(in->keys));
+    for (int i = 0; i < rec->n_keys; ++i) {
+        InputKey k;
+        if (fread(&k, sizeof(k), 1, f) != 1 || k.key >= INPUT_KEYS) return false;
+        in->keys[k.key] = k.flags;
+    }
+    if (rec->n_chars > INPUT_MAX_CHARS) return false;
+    for (int i = 0; i < rec->n_chars; ++i) {
+        int32_t c;
+        if (fread(&c, sizeof(c), 1, f) != 1) return false;
+        in->chars[i] = c;
+    }
+    in->clip.count = 0;
+    for (uint32_t i = 0; i < rec->clip_len; ++i) {
+        int c = fgetc(f);
+        if (c == EOF) return false;
+        da_append(&in->clip, (char)c);
+    }
+    da_append(&in->clip, '\0');
+    // the framebuffer follows the recorded window, the layout follows the record either way
+    if (rec->resized) SetWindowSize(rec->width, rec->height);
+    return true;
+}
+
+// anything glfw would have woken a waiting loop for
+static bool input_has_events(Input * in) {
+    InputRecord * rec = &in->rec;
+    bool any = rec->delta_x != 0 || rec->delta_y != 0 || rec->wheel_x != 0 || rec->wheel_y != 0 ||
+        rec->resized || rec->n_keys > 0 || rec->n_chars > 0 || rec->clip_len > 0;
+    for (int b = 0; b < INPUT_BUTTONS; ++b) any = any || rec->buttons[b];
+    return any;
+}
+
+// a frame before the next record arrived: what is held stays held, nothing happens
+static void input_hold(Input * in) {
+    InputRecord * rec = &in->rec;
+    rec->delta_x = rec->delta_y = rec->wheel_x = rec->wheel_y = 0;
+    rec->resized = 0;
+    rec->n_chars = 0;
+    rec->clip_len = 0;
+    for (int b = 0; b < INPUT_BUTTONS; ++b) rec->buttons[b] &= IN_DOWN;
+    for (int k = 0; k < INPUT_KEYS; ++k) in->keys[k] &= IN_DOWN;
+    in->clip.count = 0;
+    da_append(&in->clip, '\0');
+}
+
+// @algo: a waiting loop sleeps through the records without events until the next one with,
+// like glfw's wait; otherwise a frame takes the next record once it is due, at most one a
+// frame, and holds the last input before that, like a poll between two events. records after
+// the first are due half a step off the grid a 60 fps loop starts on, where live events fall
+// on average, or a polling replay would see each one the moment it polls
+static bool input_read_paced(Input * in) {
+    double now = GetTime();
+    if (in->records == 0) {
+        in->start = now;
+        in->cpu_start = clock();
+    }
+    in->arrival = -1;
+    for (;;) {
+        double due = in->start + (in->records ? in->records - 0.5 : 0) * INPUT_REPLAY_DT;
+        if (now < due) {
+            if (!in->waiting) {
+                input_hold(in);
+                return true;
+            }
+            WaitTime(due - now);
+            now = GetTime();
+        }
+        if (!input_read_frame(in)) return false;
+        in->records += 1;
+        if (input_has_events(in)) {
+            in->arrival = due;
+            return true;
+        }
+        if (!in->waiting) return true;
+    }
+}
+
+// @algo: every key is polled, a few hundred array lookups in raylib per frame
+static void input_poll(Input * in) {
+    InputRecord * rec = &in->rec;
+    Vector2 mp = GetMousePosition(), d = GetMouseDelta(), wheel = GetMouseWheelMoveV();
+    *rec = (InputRecord) {
+        .mouse_x = mp.x, .mouse_y = mp.y,
+        .delta_x = d.x, .delta_y = d.y,
+        .wheel_x = wheel.x, .wheel_y = wheel.y,
+        .width = GetScreenWidth(), .height = GetScreenHeight(),
+        .resized = IsWindowResized() || in->frame == 1, // the first frame lays out for the window it had
+    };
+    for (int b = 0; b < INPUT_BUTTONS; ++b) {
+        rec->buttons[b] = IsMouseButtonDown(b) * IN_DOWN | IsMouseButtonPressed(b) * IN_PRESSED |
+            IsMouseButtonReleased(b) * IN_RELEASED;
+    }
+    for (int k = 0; k < INPUT_KEYS; ++k) {
+        in->keys[k] = IsKeyDown(k) * IN_DOWN | IsKeyPressed(k) * IN_PRESSED |
+            IsKeyReleased(k) * IN_RELEASED | IsKeyPressedRepeat(k) * IN_REPEAT;
+        rec->n_keys += in->keys[k] != 0;
+    }
+    int c;
+    while (rec->n_chars < INPUT_MAX_CHARS && (c = GetCharPressed()) > 0) in->chars[rec->n_chars++] = c;
+    in->clip_read = false;
+}
+
+bool input_begin_frame() {
+    Input * in = &g_input;
+    if (WindowShouldClose()) return false;
+    in->next_char = 0;
+    in->frame += 1;
+    if (in->mode == INPUT_REPLAY) return in->paced ? input_read_paced(in) : input_read_frame(in);
+    input_poll(in);
+    return true;
+}
+
+void input_drawn() {
+    Input * in = &g_input;
+    if (in->paced && in->arrival >= 0) da_append(&in->latencies, GetTime() - in->arrival);
+}
+
+// written at the end, the clipboard may be read halfway through
+void input_end_frame() {
+    Input * in = &g_input;
+    if (in->mode != INPUT_RECORD) return;
+    InputRecord * rec = &in->rec;
+    rec->clip_len = in->clip_read ? in->clip.count - 1 : 0;
+    FILE * f = in->file;
+    bool failed = fwrite(rec, sizeof(*rec), 1, f) != 1;
+    for (int k = 0; k < INPUT_KEYS; ++k) {
+        if (!in->keys[k]) continue;
+        InputKey key = {k, in->keys[k]};
+        failed = failed || fwrite(&key, sizeof(key), 1, f) != 1;
+    }
+    for (int i = 0; i < rec->n_chars; ++i) {
+        int32_t c = in->chars[i];
+        failed = failed || fwrite(&c, sizeof(c), 1, f) != 1;
+    }
+    if (rec->clip_len) failed = failed || fwrite(in->clip.items, rec->clip_len, 1, f) != 1;
+    if (failed) { // keep what made it, stop recording
+        printf("Failed to record frame %llu\n", (unsigned long long)in->frame);
+        fclose(f);
+        in->file = NULL;
+        in->mode = INPUT_LIVE;
+    }
+}
+
+static int input_latency_cmp(const void * a, const void * b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void input_pace_report() {
+    Input * in = &g_input;
+    if (!in->paced || in->records == 0) return;
+    double wall = GetTime() - in->start, cpu = (double)(clock() - in->cpu_start) / CLOCKS_PER_SEC;
+    printf("paced replay, %s: %llu records in %.2f s, %llu frames drawn, cpu %.2f s (%.3f s per s)\n",
+           in->waiting ? "waiting" : "polling", (unsigned long long)in->records, wall,
+           (unsigned long long)in->frame, cpu, cpu / wall);
+    InputLatencies * l = &in->latencies;
+    if (l->count == 0) return;
+    qsort(l->items, l->count, sizeof(double), input_latency_cmp);
+    printf("input to drawn ms over %zu inputs: median %.2f, p95 %.2f, max %.2f\n", l->count,
+           l->items[l->count / 2] * 1000, l->items[l->count * 95 / 100] * 1000, l->items[l->count - 1] * 1000);
+}
+
+void input_close() {
+    Input * in = &g_input;
+    if (in->file && fclose(in->file) != 0 && in->mode == INPUT_RECORD) printf("Failed to finish the recording\n");
+    in->file = NULL;
+    in->mode = INPUT_LIVE;
+    in->paced = false;
+    da_free(&in->clip);
+    da_free(&in->latencies);
+}
+
+bool input_key_down(int key) {
+    return key >= 0 && key < INPUT_KEYS && g_input.keys[key] & IN_DOWN;
+}
+
+bool input_key_pressed(int key) {
+    return key >= 0 && key < INPUT_KEYS && g_input.keys[key] & IN_PRESSED;
+}
+
+bool input_key_repeat(int key) {
+    return key >= 0 && key < INPUT_KEYS && g_input.keys[key] & IN_REPEAT;
+}
+
+bool input_mouse_down(int button) {
+    return button >= 0 && button < INPUT_BUTTONS && g_input.rec.buttons[button] & IN_DOWN;
+}
+
+bool input_mouse_pressed(int button) {
+    return button >= 0 && button < INPUT_BUTTONS && g_input.rec.buttons[button] & IN_PRESSED;
+}
+
+bool input_mouse_released(int button) {
+    return button >= 0 && button < INPUT_BUTTONS && g_input.rec.buttons[button] & IN_RELEASED;
+}
+
+Vector2 input_mouse() {
+    return (Vector2) {g_input.rec.mouse_x, g_input.rec.mouse_y};
+}
+
+Vector2 input_mouse_delta() {
+    return (Vector2) {g_input.rec.delta_x, g_input.rec.delta_y};
+}
+
+Vector2 input_wheel() {
+    return (Vector2) {g_input.rec.wheel_x, g_input.rec.wheel_y};
+}
+
+int input_char() {
+    Input * in = &g_input;
+    return in->next_char < in->rec.n_chars ? in->chars[in->next_char++] : 0;
+}
+
+// live reads go into the recording, replay returns what was read then
+const char * input_clipboard() {
+    Input * in = &g_input;
+    if (in->mode != INPUT_REPLAY && !in->clip_read) {
+        const char * clip = GetClipboardText();
+        input_text_set(&in->clip, clip ? clip : "", clip ? strlen(clip) : 0);
+        in->clip_read = true;
+    }
+    return in->clip.count > 1 ? in->clip.items : NULL;
+}
+
+// a replay leaves the system clipboard alone
+void input_set_clipboard(const char * text) {
+    if (g_input.mode != INPUT_REPLAY) SetClipboardText(text);
+}
+
+bool input_resized() {
+    return g_input.rec.resized;
+}
+
+int input_width() {
+    return g_input.rec.width;
+}
+
+int input_height() {
+    return g_input.rec.height;
+}
+
+float input_dt() {
+    return g_input.mode == INPUT_REPLAY ? INPUT_REPLAY_DT : GetFrameTime();
+}
+
+#endif // INPUT_H_
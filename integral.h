@@ -0,0 +1,265 @@
+#ifndef INTEGRAL_H_
+#define INTEGRAL_H_
+
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+#include <stdbool.h>
+#include <stdlib.h> // exit
+#include <string.h> // memcpy
+#include <math.h> // fabs, pow, isfinite
+#include <float.h> // DBL_EPSILON
+
+#include "dynarray.h"
+#include "compile.h"
+
+/*
+  ∫ f dx over [a, b] for `f | a, b`.
+  adaptive Gauss–Kronrod: every interval gets the 15 point Kronrod rule, whose odd nodes
+  are the 7 point Gauss rule, and the difference of the two is the error estimate.
+  breadth first like the curve sampler: every round bisects the intervals with the
+  largest estimates and evaluates the nodes of all new halves in one batch, until the
+  total is within the tolerance or the interval budget runs out
+ */
+
+#define INTEGRAL_SEED 4 // equal intervals before any refinement
+#define INTEGRAL_MAX_INTERVALS 2048
+#define INTEGRAL_TOL 1e-10 // relative to ∫|f|, see `integral_eval`
+#define INTEGRAL_CACHE 64 // results kept, the least recently used one is replaced
+
+typedef struct {
+    double a, b; // bounds as given, `b < a` integrates backwards
+    double value; // NaN where f is undefined somewhere in between, or a bound is
+    double error; // estimated, summed over the intervals
+    size_t evals, intervals;
+    bool converged; // false if the budget ran out first
+} IntegralResult;
+
+typedef struct {
+    double l, r;
+    double value, error, abs; // abs: ∫|f|, scales the tolerance
+} IntegralPiece;
+
+typedef struct {
+    IntegralPiece * items;
+    size_t count;
+    size_t capacity;
+} IntegralPieces;
+
+// content addressed like the program cache: the program's text hash, the bounds, the
+// tolerance and the values of the parameters it reads. panning or zooming never misses
+typedef struct {
+    uint64_t text_hash, params_hash;
+    double a, b, tol;
+    IntegralResult result;
+    uint64_t used; // `tick` at the last lookup, 0 for an empty slot
+} IntegralEntry;
+
+typedef struct {
+    IntegralEntry slots[INTEGRAL_CACHE];
+    uint64_t tick;
+    size_t hits, misses;
+    size_t evals; // function evaluations over all misses
+} IntegralCache;
+
+IntegralCache g_integral_cache;
+
+IntegralResult integral_eval(Program * prog, const double * params, double a, double b, double tol);
+IntegralResult integral_cached(Program * prog, const double * params, double a, double b, double tol);
+
+// 15 point Kronrod nodes on [-1, 1], ± each and 0; the odd ones are the 7 point Gauss nodes
+static const double integral_xk[8] = {
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000,
+};
+static const double integral_wk[8] = {
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714,
+};
+static const double integral_wg[4] = { // at integral_xk[1], [3], [5], [7]
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327,
+};
+#define INTEGRAL_NODES 15
+
+// node k of an interval: 0..6 left of the centre, 7..13 right, 14 the centre
+static double integral_node(const IntegralPiece * p, int k) {
+    double c = 0.5 * (p->l + p->r), h = 0.5 * (p->r - p->l);
+    return k < 7 ? c - h * integral_xk[k] : k < 14 ? c + h * integral_xk[k - 7] : c;
+}
+
+// @algo: QUADPACK's estimate: |K - G| is scaled by how far f strays from its mean over the
+// interval, (200 |K - G| / resasc)^1.5 is pessimistic for rough f and sharp for smooth f,
+// and never below what rounding leaves of the sum
+static void integral_rule(IntegralPiece * p, const double * f) {
+    double h = 0.5 * (p->r - p->l);
+    double k = integral_wk[7] * f[14], g = integral_wg[3] * f[14], abs = integral_wk[7] * fabs(f[14]);
+    for (int j = 0; j < 7; ++j) {
+        double pair = f[j] + f[7 + j];
+        k += integral_wk[j] * pair;
+        abs += integral_wk[j] * (fabs(f[j]) + fabs(f[7 + j]));
+        if (j & 1) g += integral_wg[j / 2] * pair;
+    }
+    double mean = 0.5 * k;
+    double asc = integral_wk[7] * fabs(f[14] - mean);
+    for (int j = 0; j < 7; ++j) asc += integral_wk[j] * (fabs(f[j] - mean) + fabs(f[7 + j] - mean));
+    p->value = k * h;
+    p->abs = abs * fabs(h);
+    asc *= fabs(h);
+    double err = fabs((k - g) * h);
+    if (asc != 0 && err != 0) err = asc * fmin(1, pow(200 * err / asc, 1.5));
+    p->error = fmax(err, 50 * DBL_EPSILON * p->abs);
+    if (!isfinite(p->value)) p->value = p->error = NAN;
+}
+
+// every piece from `first` on, all nodes in one batch
+static size_t integral_eval_pieces(Program * prog, const double * params, IntegralPieces * pieces, size_t first) {
+    static double * xs = NULL, * fs = NULL;
+    static size_t capacity = 0;
+    size_t n = (pieces->count - first) * INTEGRAL_NODES;
+    if (n > capacity) {
+        capacity = n;
+        xs = reallocf(xs, capacity * sizeof(double));
+        fs = reallocf(fs, capacity * sizeof(double));
+        if (!xs || !fs) exit(1);
+    }
+    for (size_t i = first; i < pieces->count; ++i) {
+        for (int k = 0; k < INTEGRAL_NODES; ++k) xs[(i - first) * INTEGRAL_NODES + k] = integral_node(pieces->items + i, k);
+    }
+    program_eval_batch_d(prog, params, xs, fs, n);
+    for (size_t i = first; i < pieces->count; ++i) integral_rule(pieces->items + i, fs + (i - first) * INTEGRAL_NODES);
+    return n;
+}
+
+static int integral_cmp_desc(const void * a, const void * b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x < y) - (x > y);
+}
+
+// @algo: QUADPACK bisects the interval with the largest error, one at a time. batched: the
+// largest errors are split together, as many as it takes for the rest to sum to half the
+// tolerance. a share per unit of width would never be met next to an integrable
+// singularity, where the error only shrinks with the square root of the width
+static double integral_split_threshold(IntegralPieces * pieces, double excess) {
+    static double * errors = NULL;
+    static size_t capacity = 0;
+    if (pieces->count > capacity) {
+        capacity = pieces->count;
+        errors = reallocf(errors, capacity * sizeof(double));
+        if (!errors) exit(1);
+    }
+    for (size_t i = 0; i < pieces->count; ++i) errors[i] = pieces->items[i].error;
+    qsort(errors, pieces->count, sizeof(double), integral_cmp_desc);
+    size_t k = 0;
+    for (double removed = 0; k + 1 < pieces->count && removed < excess; ++k) removed += errors[k];
+    return errors[k > 0 ? k - 1 : 0];
+}
+
+static bool integral_halvable(const IntegralPiece * p) {
+    double mid = 0.5 * (p->l + p->r);
+    return mid > p->l && mid < p->r;
+}
+
+// done once the estimated error is within `tol` of ∫|f|: relative to the size of f rather
+// than of the result, so an integral that cancels to 0 still converges
+IntegralResult integral_eval(Program * prog, const double * params, double a, double b, double tol) {
+    static IntegralPieces pieces = {}, next = {};
+    IntegralResult res = {.a = a, .b = b, .converged = true};
+    if (!isfinite(a) || !isfinite(b)) return (IntegralResult) {.a = a, .b = b, .value = NAN, .error = NAN};
+    if (a == b) return res;
+    double lo = fmin(a, b), hi = fmax(a, b), width = hi - lo;
+
+    pieces.count = 0;
+    for (int i = 0; i < INTEGRAL_SEED; ++i) {
+        double l = lo + width * i / INTEGRAL_SEED;
+        double r = i + 1 == INTEGRAL_SEED ? hi : lo + width * (i + 1) / INTEGRAL_SEED;
+        da_append(&pieces, ((IntegralPiece) {l, r}));
+    }
+    res.evals = integral_eval_pieces(prog, params, &pieces, 0);
+
+    for (;;) {
+        double value = 0, error = 0, abs = 0;
+        for (size_t i = 0; i < pieces.count; ++i) {
+            value += pieces.items[i].value;
+            error += pieces.items[i].error;
+            abs += pieces.items[i].abs;
+        }
+        res.value = value;
+        res.error = error;
+        if (isnan(value) || error <= tol * abs) break;
+        if (pieces.count >= INTEGRAL_MAX_INTERVALS) {
+            res.converged = false;
+            break;
+        }
+        // the kept intervals go first, so the new halves are evaluated as one contiguous run
+        double threshold = integral_split_threshold(&pieces, error - tol * abs / 2);
+        size_t room = INTEGRAL_MAX_INTERVALS - pieces.count, split = 0;
+        next.count = 0;
+        for (size_t i = 0; i < pieces.count; ++i) {
+            IntegralPiece * p = pieces.items + i;
+            if (split < room && p->error >= threshold && integral_halvable(p)) split += 1;
+            else da_append(&next, *p);
+        }
+        if (split == 0) { // only intervals too narrow to halve are left over
+            res.converged = false;
+            break;
+        }
+        size_t first = next.count;
+        for (size_t i = 0, n = 0; i < pieces.count && n < split; ++i) {
+            IntegralPiece p = pieces.items[i];
+            if (!(p.error >= threshold && integral_halvable(&p))) continue;
+            double mid = 0.5 * (p.l + p.r);
+            da_append(&next, ((IntegralPiece) {p.l, mid}));
+            da_append(&next, ((IntegralPiece) {mid, p.r}));
+            n += 1;
+        }
+        res.evals += integral_eval_pieces(prog, params, &next, first);
+        IntegralPieces swap = pieces;
+        pieces = next;
+        next = swap;
+    }
+    res.intervals = pieces.count;
+    if (b < a) res.value = -res.value;
+    return res;
+}
+
+static uint64_t integral_params_hash(Program * prog, const double * params) { // FNV-1a over the bits
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (int p = 0; p < PARAM_COUNT; ++p) {
+        if (!(prog->deps >> p & 1)) continue;
+        uint64_t bits;
+        memcpy(&bits, params + p, sizeof(bits));
+        for (int k = 0; k < 64; k += 8) {
+            h ^= bits >> k & 0xFF;
+            h *= 0x100000001b3ull;
+        }
+    }
+    return h;
+}
+
+IntegralResult integral_cached(Program * prog, const double * params, double a, double b, double tol) {
+    IntegralCache * cache = &g_integral_cache;
+    uint64_t text_hash = prog->hash, params_hash = integral_params_hash(prog, params);
+    cache->tick += 1;
+    IntegralEntry * oldest = cache->slots;
+    for (IntegralEntry * e = cache->slots; e < cache->slots + INTEGRAL_CACHE; ++e) {
+        // bounds compared by bits, a NaN bound is a key like any other
+        if (e->used && e->text_hash == text_hash && e->params_hash == params_hash && e->tol == tol &&
+            memcmp(&e->a, &a, sizeof(a)) == 0 && memcmp(&e->b, &b, sizeof(b)) == 0) {
+            e->used = cache->tick;
+            cache->hits += 1;
+            return e->result;
+        }
+        if (e->used < oldest->used) oldest = e;
+    }
+    cache->misses += 1;
+    IntegralResult res = integral_eval(prog, params, a, b, tol);
+    cache->evals += res.evals;
+    *oldest = (IntegralEntry) {text_hash, params_hash, a, b, tol, res, cache->tick};
+    return res;
+}
+
+#endif // INTEGRAL_H_
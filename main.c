@@ -1,15 +1,32 @@
 // A MacOS `Grapher` app clone
-//#include <stdio.h>
 #include <stdbool.h>
 #include <stddef.h> // NULL, size_t
 #include <math.h>
 #include <stdlib.h>
+#include <string.h> // strcmp, strlen
+#include <stdio.h> // snprintf
+#include <time.h> // clock
+#include <unistd.h> // STDIN_FILENO
 
 #include <raylib.h>
+#include <rlgl.h> // rlDisableBackfaceCulling
 
 #include "style.h"
 #include "equation.h"
 #include "dynarray.h"
+#include "viewport.h"
+#include "text.h"
+#include "equations.h"
+#include "curve.h"
+#include "workspace.h"
+#include "series.h"
+#include "stream.h"
+#include "field.h"
+#include "surface.h"
+#include "raster.h"
+#include "integral.h"
+#include "input.h"
+#include "axes.h"
 
 typedef struct {
     int window_width, window_height;
@@ -18,22 +35,71 @@ typedef struct {
 } LayoutStyle;
 
 typedef struct {
-    Equation * items;
+    Polyline * items; // by equation id
     size_t count;
     size_t capacity;
+} Polylines;
 
-    size_t selected;
-} Equations;
+// a heatmap or domain colouring, its pixels are the background of the plot
+typedef struct {
+    Field field;
+    bool shown;
+} FieldView;
+
+typedef struct {
+    FieldView * items; // by equation id
+    size_t count;
+    size_t capacity;
+} FieldViews;
+
+#define FIELD_BUDGET_MS 12.0 // per frame, shared by the fields still refining
+
+typedef struct {
+    size_t resampled; // curves evaluated this frame
+    size_t evals; // points evaluated by the resampled curves
+    size_t drawn;
+    size_t samples; // data series samples in view
+    size_t points; // drawn for them
+    size_t live; // streamed samples in view
+    size_t cells; // field cells evaluated this frame
+    double field_ms;
+    size_t prims; // rasterized segments and triangles
+    double raster_ms;
+    size_t chunks, rebuilt, triangles; // surface
+    double surface_ms;
+    size_t labels; // axis labels drawn
+    double labels_ms;
+} GrapherStats;
+
+typedef struct {
+    double * items; // ui_ms per frame
+    size_t count;
+    size_t capacity;
+} FrameTimes;
 
 // components
 bool sidebar(Rectangle frame, Equations * eqs); // return true if should_redraw
 void editor(Rectangle frame, String * eq);
-void grapher(Rectangle frame, Equations * eqs, bool redraw);
+bool grapher(Rectangle frame, Equations * eqs, SeriesList * data, Stream * live, Viewport * vp, bool redraw); // return true if still refining
+bool grapher_surface(Rectangle frame, Equations * eqs, Viewport * vp); // return false if there is nothing to show
+void grapher_compose(Raster * r, Equations * eqs, Polylines * curves, Polylines * series, Polyline * streamed,
+                     const uint32_t * background, Viewport vp, int width, int height, int scale);
+int grapher_export(const char * path, Equations * eqs, SeriesList * data, Viewport vp); // return 1 on failure
+bool grapher_integral(Equation * eq, const double * params, IntegralResult * out); // return false for no `| a, b`
+void grapher_shade(Raster * r, Polyline * curve, double a, double b, Viewport vp, int width, int height, float k);
+void grapher_labels(Rectangle frame, Viewport vp, int width, int height); // over the plot, `width` x `height` pixels
+void stats_overlay(Rectangle frame, Equations * eqs, Stream * live, double ui_ms, bool waiting, int frames);
+void frame_times_summary(FrameTimes * times); // sorts them
+
+// raylib links glfw in; an empty event ends the wait of `EnableEventWaiting` from any thread
+void glfwPostEmptyEvent(void);
 
 Font g_font;
+GrapherStats g_grapher_stats;
+AxisLabels g_axis_labels[2]; // x, y
 
 #define BeginScissorModeRec(rect) BeginScissorMode((rect).x, (rect).y, (rect).width, (rect).height);
-int main(void) {
+int main(int argc, char ** argv) {
     
     LayoutStyle ls = {
         .window_width = 800,
@@ -45,9 +111,99 @@ int main(void) {
     Equations eqs = {
         .selected = -1,
     };
-    da_append(&eqs, (Equation) {.editor = string_createEmpty()});
+    eqs_add(&eqs, (Equation) {.editor = string_createEmpty()});
+    Viewport vp = viewport_default();
+    const char * workspace_path = "workspace.gws";
+    SeriesList data = {};
+    static Stream live = {}; // the ring is too big for the stack
+    bool fit_data = true; // unless a workspace says where to look
+    bool wait_events = true; // sleep while nothing changes, `--poll` draws every frame instead
+    const char * export_path = NULL; // write the plot to this ppm and quit
+    const char * record_path = NULL, * replay_path = NULL; // input sessions, see `input.h`
+    bool paced = false; // replay at the recorded speed, keeping the loop `--poll` chooses
+    const char * timings_path = NULL; // per frame timings as csv
+
+    // args
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--workspace") == 0 && i + 1 < argc) {
+            // binary or text, saved back in the same form with ctrl (cmd) + S
+            workspace_path = argv[++i];
+            fit_data = false;
+            clock_t t = clock(); // no window yet for `GetTime`
+            if (workspace_load(workspace_path, &eqs, &vp) == 0) {
+                printf("Loaded %zu equations from %s in %.3f ms\n",
+                       eqs.order.count, workspace_path, (clock() - t) * 1000.0 / CLOCKS_PER_SEC);
+            }
+            if (eqs.order.count == 0) eqs_add(&eqs, (Equation) {.editor = string_createEmpty()});
+        }
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            // raw .f32 / .f64 pairs, .gsd, or text converted once next to it
+            const char * path = argv[++i];
+            Series s;
+            clock_t t = clock();
+            if (series_open(path, &s)) {
+                printf("Failed to open %s\n", path);
+                continue;
+            }
+            printf("Loaded %zu samples from %s in %.3f ms\n",
+                   s.count, path, (clock() - t) * 1000.0 / CLOCKS_PER_SEC);
+            da_append(&data, s);
+        }
+        if (strcmp(argv[i], "--poll") == 0) wait_events = false;
+        if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) export_path = argv[++i];
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) record_path = argv[++i];
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replay_path = argv[++i];
+        if (strcmp(argv[i], "--paced") == 0) paced = true;
+        if (strcmp(argv[i], "--timings") == 0 && i + 1 < argc) timings_path = argv[++i];
+        if (strcmp(argv[i], "--stream") == 0) {
+            // `./sensor | grapher --stream`, lines of `x y` or `y`
+            live.wake = glfwPostEmptyEvent;
+            if (stream_start(&live, STDIN_FILENO)) printf("Failed to start reading stdin\n");
+        }
+        if (strcmp(argv[i], "--stress") == 0 && i + 1 < argc) {
+            // fill the sidebar with generated equations
+            int n = atoi(argv[++i]);
+            for (int k = 0; k < n; ++k) {
+                Equation eq = {.editor = string_createFrom(TextFormat("%d sin(x + %d) / %d", k % 7 + 1, k % 100, k % 13 + 1))};
+                equation_commit(&eq);
+                eqs_add(&eqs, eq);
+            }
+            eqs_rebuild_params(&eqs);
+        }
+    }
 
+    if (fit_data && data.count > 0) {
+        double x0 = INFINITY, x1 = -INFINITY, y0 = INFINITY, y1 = -INFINITY;
+        for (size_t i = 0; i < data.count; ++i) {
+            double a, b, c, d;
+            series_bounds(data.items + i, &a, &b, &c, &d);
+            x0 = fmin(x0, a), x1 = fmax(x1, b), y0 = fmin(y0, c), y1 = fmax(y1, d);
+        }
+        if (x1 > x0) {
+            vp.cx = dd_from((x0 + x1) * 0.5);
+            vp.span_x = (x1 - x0) * 1.1;
+        }
+        if (y1 > y0) {
+            vp.cy = dd_from((y0 + y1) * 0.5);
+            vp.span_y = (y1 - y0) * 1.1;
+        }
+    }
     
+    if (export_path) {
+        double t = field_now(); // no window for `GetTime`
+        int failed = grapher_export(export_path, &eqs, &data, vp);
+        if (failed) printf("Failed to write %s\n", export_path);
+        else printf("Exported %s in %.3f ms\n", export_path, (field_now() - t) * 1000);
+        eqs_free(&eqs);
+        program_cache_free();
+        workspace_unmap_all();
+        stream_stop(&live);
+        field_pool_stop();
+        for (size_t i = 0; i < data.count; ++i) series_close(data.items + i);
+        da_free(&data);
+        return failed;
+    }
+
     // init
     SetConfigFlags(FLAG_MSAA_4X_HINT);
     InitWindow(800, 600, "Grapher");
@@ -55,18 +211,63 @@ int main(void) {
     SetWindowState(FLAG_WINDOW_RESIZABLE);
     SetWindowMinSize(ls.sidebar_width + 20, ls.editor_height + 20); // TBD: set this again after resizing the components
     g_font = LoadFont("Iosevka.ttf");
+    int failed = 0; // an unreadable recording ends the session before it starts
+    if (replay_path && paced) {
+        // idle cpu and input latency of the waiting loop against `--poll`
+        failed = input_replay(replay_path);
+        if (failed) printf("Failed to open the recording %s\n", replay_path);
+        input_pace();
+    } else if (replay_path) {
+        // as fast as it goes, every frame drawn
+        failed = input_replay(replay_path);
+        if (failed) printf("Failed to open the recording %s\n", replay_path);
+        SetTargetFPS(0);
+        wait_events = false;
+    } else if (record_path && input_record(record_path)) {
+        printf("Failed to start recording to %s\n", record_path);
+    }
+    FILE * timings = NULL;
+    if (timings_path) {
+        timings = fopen(timings_path, "w");
+        if (!timings) printf("Failed to open %s\n", timings_path);
+        else fprintf(timings, "frame,ui_ms,frame_ms,resampled,evals,prims,raster_ms,cells,field_ms,layouts\n");
+    }
+    FrameTimes frame_times = {};
 
     // main loop
-    while (!WindowShouldClose()) {
-        if (IsWindowResized()) {
-            ls.window_width = GetScreenWidth();
-            ls.window_height = GetScreenHeight();
+    bool show_stats = false;
+    double ui_ms = 0; // cpu time of the previous frame, excluding present
+    int frames = 0, frames_shown = 0; // drawn in the current and the last second
+    double second = 0;
+    while (!failed && input_begin_frame()) {
+        double frame_begin = GetTime();
+        frames += 1;
+        if (frame_begin - second >= 1) {
+            frames_shown = frames;
+            frames = 0;
+            second = frame_begin;
+        }
+        g_text_stats = (TextStats) {};
+        if (input_key_pressed(KEY_F3)) show_stats = !show_stats;
+        if ((input_key_down(KEY_LEFT_CONTROL) || input_key_down(KEY_RIGHT_CONTROL) ||
+             input_key_down(KEY_LEFT_SUPER) || input_key_down(KEY_RIGHT_SUPER)) && input_key_pressed(KEY_S)) {
+            eqs_commit(&eqs, eqs.selected);
+            size_t len = strlen(workspace_path);
+            bool text = len > 4 && strcmp(workspace_path + len - 4, ".txt") == 0;
+            if ((text ? workspace_save_text : workspace_save)(workspace_path, &eqs, vp)) {
+                printf("Failed to save %s\n", workspace_path);
+            }
+        }
+        if (input_resized()) {
+            ls.window_width = input_width();
+            ls.window_height = input_height();
         }
         
         BeginDrawing();
         ClearBackground(c_bg_primary);
 
         bool should_redraw = false;
+        eqs_animate(&eqs, fminf(input_dt(), 0.1f)); // marks the dependents dirty, an idle wait is no time step
         
         Rectangle sidebar_frame = {0, 0, ls.sidebar_width, ls.window_height};
         BeginScissorModeRec(sidebar_frame);
@@ -77,50 +278,175 @@ int main(void) {
 
         Rectangle editor_frame = {ls.sidebar_width, 0, ls.window_width - ls.sidebar_width, ls.editor_height};
         BeginScissorModeRec(editor_frame);
-        editor(editor_frame, eqs.selected == (size_t)-1 ? NULL : &eqs.items[eqs.selected].editor);
+        Equation * eq_sel = eqs_get(&eqs, eqs.selected);
+        editor(editor_frame, eq_sel ? &eq_sel->editor : NULL);
         EndScissorMode();
         DrawRectangle(ls.sidebar_width, ls.editor_height - 1, ls.window_width, 1, c_separator);
 
         Rectangle grapher_frame = {ls.sidebar_width, ls.editor_height, ls.window_width - ls.sidebar_width, ls.window_height - ls.editor_height};
         //BeginScissorModeRec(grapher_frame);
-        grapher(grapher_frame, &eqs, should_redraw);
+        bool busy = grapher(grapher_frame, &eqs, &data, live.running ? &live : NULL, &vp, should_redraw);
         //EndScissorMode();
+
+        // the next frame comes with the next event (input, resize, live samples) unless
+        // something is still moving; `EndDrawing` sleeps in the event wait, a paced replay
+        // in `input_begin_frame` until the next record with input
+        busy = busy || eqs.params.animating || (live.running && !stream_idle(&live));
+        input_wait(wait_events && !busy);
+
+        TextStats ts = g_text_stats; // the overlay adds to it
+        if (show_stats) stats_overlay(grapher_frame, &eqs, &live, ui_ms, wait_events && !busy, frames_shown);
+        ui_ms = (GetTime() - frame_begin) * 1000;
+        input_drawn();
         
         EndDrawing();
+        input_end_frame();
+        if (timings) {
+            // frame_ms includes the present and, live, any wait for events or the frame cap
+            GrapherStats * gs = &g_grapher_stats;
+            fprintf(timings, "%llu,%.3f,%.3f,%zu,%zu,%zu,%.3f,%zu,%.3f,%zu\n",
+                    (unsigned long long)g_input.frame, ui_ms, (GetTime() - frame_begin) * 1000,
+                    gs->resampled, gs->evals, gs->prims, gs->raster_ms, gs->cells, gs->field_ms, ts.layouts);
+            da_append(&frame_times, ui_ms);
+        }
+    }
+    if (timings) {
+        frame_times_summary(&frame_times);
+        if (fclose(timings) != 0) printf("Failed to write %s\n", timings_path);
+        da_free(&frame_times);
     }
+    input_pace_report();
+    input_close();
+    text_cache_clear();
     CloseWindow();
 
     // cleanup
-    for (size_t i = 0; i < eqs.count; ++i) {
-        equation_free(eqs.items + i);
-    }
-    da_free(&eqs);
+    eqs_free(&eqs);
+    program_cache_free();
+    workspace_unmap_all();
+    stream_stop(&live);
+    field_pool_stop();
+    for (size_t i = 0; i < data.count; ++i) series_close(data.items + i);
+    da_free(&data);
     
-    return 0;
+    return failed;
 }
 
-void render_string(Vector2 pos, String text, int charh, bool show_cursor, Color c) {
-    int charw = MeasureTextEx(g_font, " ", charh, 0).x;
-    for (size_t i = 0; i + 1 < text.count; ++i) {
-        DrawTextEx(g_font, TextFormat("%c", text.items[i]),
-                   (Vector2) {pos.x + i * charw, pos.y},
-                   charh, 0, c);
+#define EDITOR_MAX_COLS 512
+// render columns [first, first + cols) of `text`, nothing outside is touched
+void render_string(Vector2 pos, String * text, size_t first, size_t cols, int charh, bool show_cursor, Color c) {
+    int charw = text_char_width(g_font, charh);
+    char buf[EDITOR_MAX_COLS];
+    if (cols > EDITOR_MAX_COLS) cols = EDITOR_MAX_COLS;
+    size_t n = string_copy_range(text, first, first + cols, buf);
+
+    size_t sel_begin, sel_end;
+    string_selection(text, &sel_begin, &sel_end);
+    if (sel_begin < first) sel_begin = first;
+    if (sel_end > first + n) sel_end = first + n;
+    if (sel_begin < sel_end) {
+        DrawRectangle(pos.x + (sel_begin - first) * charw, pos.y,
+                      (sel_end - sel_begin) * charw, charh, c_bg_highlighted);
     }
-    if (show_cursor) {
-        DrawRectangle(pos.x + text.cursor * charw,
+
+    text_draw(g_font, buf, n, pos, charh, c);
+    if (show_cursor && text->cursor >= first && text->cursor - first < cols) {
+        size_t col = text->cursor - first;
+        DrawRectangle(pos.x + col * charw,
                       pos.y,
                       charw, charh, BLACK);
-        DrawTextEx(g_font, TextFormat("%c", text.items[text.cursor]),
-                   (Vector2) {pos.x + text.cursor * charw,
-                              pos.y},
-                   charh, 0, c_bg_primary);
+        text_draw(g_font, buf + col, col < n ? 1 : 0,
+                  (Vector2) {pos.x + col * charw, pos.y},
+                  charh, c_bg_primary);
     }
 }
 void DrawTextCentered(char * str, Rectangle rect, int fontSize, Color c) {
-    DrawTextEx(g_font, str,
-               (Vector2) {rect.x + rect.width / 2 - MeasureTextEx(g_font, str, fontSize, 0).x / 2,
-                          rect.y + rect.height / 2 - fontSize / 2},
-               fontSize, 0, c);
+    size_t len = strlen(str);
+    text_draw(g_font, str, len,
+              (Vector2) {rect.x + rect.width / 2 - text_width(g_font, len, fontSize) / 2,
+                         rect.y + rect.height / 2 - fontSize / 2},
+              fontSize, c);
+}
+
+static int frame_times_cmp(const void * a, const void * b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void frame_times_summary(FrameTimes * times) {
+    if (times->count == 0) return;
+    qsort(times->items, times->count, sizeof(double), frame_times_cmp);
+    double total = 0;
+    for (size_t i = 0; i < times->count; ++i) total += times->items[i];
+    printf("%zu frames, ui ms: mean %.3f, median %.3f, p95 %.3f, max %.3f\n", times->count,
+           total / times->count, times->items[times->count / 2],
+           times->items[times->count * 95 / 100], times->items[times->count - 1]);
+}
+
+void stats_overlay(Rectangle frame, Equations * eqs, Stream * live, double ui_ms, bool waiting, int frames) {
+    // snapshot first, drawing the overlay adds to the counters
+    TextStats ts = g_text_stats;
+    // `TextFormat` cycles through a few static buffers, every line keeps its own
+    char lines[16][128];
+    size_t n = 0;
+    snprintf(lines[n++], sizeof(lines[0]), "%d frames in the last second, ui %.3f ms, %zu equations, %s",
+             frames, ui_ms, eqs->order.count, waiting ? "waiting for events" : "polling");
+    snprintf(lines[n++], sizeof(lines[0]), "text: %zu batches for %zu glyph quads, one submission each before",
+             ts.batches, ts.glyphs);
+    snprintf(lines[n++], sizeof(lines[0]), "text layouts: %zu new this frame", ts.layouts);
+    snprintf(lines[n++], sizeof(lines[0]), "program cache: %zu hits, %zu misses, %zu entries",
+             g_program_cache.hits, g_program_cache.misses, g_program_cache.count);
+    snprintf(lines[n++], sizeof(lines[0]), "compiled: %zu tree nodes into %zu ops",
+             g_program_cache.nodes, g_program_cache.ops);
+    snprintf(lines[n++], sizeof(lines[0]), "curves: %zu resampled (%zu points), %zu drawn",
+             g_grapher_stats.resampled, g_grapher_stats.evals, g_grapher_stats.drawn);
+    snprintf(lines[n++], sizeof(lines[0]), "data: %zu samples in view, %zu points drawn",
+             g_grapher_stats.samples, g_grapher_stats.points);
+    snprintf(lines[n++], sizeof(lines[0]), "raster: %zu primitives in %.2f ms", g_grapher_stats.prims, g_grapher_stats.raster_ms);
+    snprintf(lines[n++], sizeof(lines[0]), "axes: %zu labels in %.3f ms, %zu formatted, %zu cached draws",
+             g_grapher_stats.labels, g_grapher_stats.labels_ms,
+             g_axis_labels[0].formatted + g_axis_labels[1].formatted, g_axis_labels[0].hits + g_axis_labels[1].hits);
+    snprintf(lines[n++], sizeof(lines[0]), "fields: %zu cells in %.2f ms (%.1f Mpx/s)",
+             g_grapher_stats.cells, g_grapher_stats.field_ms,
+             g_grapher_stats.field_ms > 0 ? g_grapher_stats.cells / g_grapher_stats.field_ms * 1e-3 : 0);
+    snprintf(lines[n++], sizeof(lines[0]), "integrals: %zu hits, %zu misses, %zu evaluations",
+             g_integral_cache.hits, g_integral_cache.misses, g_integral_cache.evals);
+    snprintf(lines[n++], sizeof(lines[0]), "surface: %zu chunks, %zu rebuilt, %zu triangles in %.2f ms",
+             g_grapher_stats.chunks, g_grapher_stats.rebuilt, g_grapher_stats.triangles, g_grapher_stats.surface_ms);
+    snprintf(lines[n++], sizeof(lines[0]), "stream: %zu lines, %zu dropped, %zu kept, %zu in view%s",
+             atomic_load(&live->lines), atomic_load(&live->dropped), live->history_count,
+             g_grapher_stats.live, atomic_load(&live->eof) ? ", ended" : "");
+    int size = 14;
+    for (size_t i = 0; i < n; ++i) {
+        text_draw(g_font, lines[i], strlen(lines[i]),
+                  (Vector2) {frame.x + 8, frame.y + 8 + i * size}, size, c_fg_placeholder);
+    }
+}
+
+// track on the right half of the item, play / pause at the end
+void sidebar_slider(Equations * eqs, int slot, Rectangle item, Vector2 mp) {
+    static int dragging = -1;
+    Params * ps = &eqs->params;
+    uint64_t bit = 1ull << slot;
+    Rectangle play = {item.x + item.width - item.height, item.y, item.height, item.height};
+    Rectangle track = {item.x + item.width * 0.5f, item.y + item.height * 0.5f - 2,
+                       play.x - item.x - item.width * 0.5f - 4, 4};
+    Rectangle hit = {track.x - 4, item.y, track.width + 8, item.height};
+
+    if (input_mouse_pressed(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mp, hit)) dragging = slot;
+    if (!input_mouse_down(MOUSE_BUTTON_LEFT)) dragging = -1;
+    if (dragging == slot) {
+        float t = (mp.x - track.x) / track.width;
+        t = t < 0 ? 0 : t > 1 ? 1 : t;
+        ps->animating &= ~bit;
+        eqs_set_param(eqs, slot, ps->min[slot] + t * (ps->max[slot] - ps->min[slot]));
+    }
+    if (input_mouse_pressed(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mp, play)) ps->animating ^= bit;
+
+    float t = (ps->values[slot] - ps->min[slot]) / (ps->max[slot] - ps->min[slot]);
+    DrawRectangleRec(track, c_bg_quaternary);
+    DrawRectangle(track.x + t * track.width - 3, item.y + item.height * 0.25f, 6, item.height * 0.5f, c_fg_primary);
+    DrawTextCentered(ps->animating & bit ? "=" : ">", play, item.height * 0.6f, c_fg_primary);
 }
 
 bool sidebar(Rectangle frame, Equations * eqs) {
@@ -128,7 +454,7 @@ bool sidebar(Rectangle frame, Equations * eqs) {
 
     int padding = 10;
     int itemH = 30;
-    Vector2 mp = GetMousePosition();
+    Vector2 mp = input_mouse();
 
     bool should_redraw = false;
     
@@ -147,41 +473,32 @@ bool sidebar(Rectangle frame, Equations * eqs) {
         itemH,
     };
     DrawRectangleRounded(frame_add, 0.5, 10,
-                         IsMouseButtonDown(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mp, frame_add)
+                         input_mouse_down(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mp, frame_add)
                              ? c_bg_quaternary : c_bg_tertiary);
     DrawTextCentered("+", frame_add, itemH, c_fg_primary);
     DrawRectangleRounded(frame_remove, 0.5, 10,
-                         IsMouseButtonDown(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mp, frame_remove)
+                         input_mouse_down(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mp, frame_remove)
                              ? c_bg_quaternary : c_bg_tertiary);
     DrawTextCentered("-", frame_remove, itemH, c_fg_primary);
     // button interaction
-    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) &&
+    if (input_mouse_released(MOUSE_BUTTON_LEFT) &&
         CheckCollisionPointRec(mp, frame_add)) {
         should_redraw = true;
-        da_append(eqs, (Equation) {.editor = string_createEmpty()});
-        eqs->selected = eqs->count - 1;
+        eqs->selected = eqs_add(eqs, (Equation) {.editor = string_createEmpty()});
     }
-    if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT) &&
+    if (input_mouse_released(MOUSE_BUTTON_LEFT) &&
         CheckCollisionPointRec(mp, frame_remove) &&
-        eqs->count > 0) {
+        eqs->order.count > 0) {
         should_redraw = true;
-        if (eqs->selected == (size_t)-1) {
-            equation_free(&eqs->items[eqs->count - 1]);
-            eqs->count -= 1;
-        } else {
-            equation_free(&eqs->items[eqs->selected]);
-            for (size_t i = eqs->selected + 1; i < eqs->count; ++i) {
-                eqs->items[i-1] = eqs->items[i];
-            }
-            if (eqs->selected > 0) eqs->selected -= 1;
-            eqs->count -= 1;
-            if (eqs->count == 0) eqs->selected = -1;
-        }
+        eqs_remove(eqs, eqs->selected == (size_t)-1
+                   ? eqs->order.items[eqs->order.count - 1]
+                   : eqs->selected);
     }
 
     // scroll area
     static float scroffs = 0; // negative or 0
-    float contentH = (padding + itemH) * eqs->count;
+    float rowH = padding + itemH;
+    float contentH = rowH * eqs->order.count;
     float scrollH = frame.height - padding * 2 - itemH;
     float scrollTop = frame.y + padding * 2 + itemH;
     Rectangle scroll_frame = {frame.x, scrollTop, frame.width, scrollH};
@@ -193,56 +510,86 @@ bool sidebar(Rectangle frame, Equations * eqs) {
                       padding * 0.5f,
                       scrollH * scrollH / contentH,
                       c_bg_quaternary);
-        scroffs += GetMouseWheelMoveV().y;
+        if (CheckCollisionPointRec(mp, frame)) scroffs += input_wheel().y;
         if (scroffs > 0) scroffs = 0;
         if (scroffs < scrollH - contentH) scroffs = scrollH - contentH;
     } else {
         scroffs = 0;
     }
     
-    // scroll items
-    for (size_t i = 0; i < eqs->count; ++i) {
-        Equation * eq = eqs->items + i;
+    // scroll items, only the visible rows
+    size_t row_first = -scroffs / rowH;
+    size_t row_last = (-scroffs + scrollH) / rowH + 1; // exclusive
+    if (row_last > eqs->order.count) row_last = eqs->order.count;
+    int charh = itemH - padding;
+    size_t max_chars = (frame.width - padding * 3) / text_char_width(g_font, charh);
+    BeginScissorModeRec(scroll_frame);
+    for (size_t row = row_first; row < row_last; ++row) {
+        size_t id = eqs->order.items[row];
+        Equation * eq = eqs->items + id;
         Rectangle item_frame = (Rectangle) {frame.x + padding,
-                                            frame.y + scroffs + (padding + itemH) * (i + 1) + padding,
+                                            scrollTop + scroffs + rowH * row,
                                             frame.width - padding * 2,
                                             itemH};
-        BeginScissorModeRec(scroll_frame);
         DrawRectangleRounded(item_frame, 0.5, 10,
-                             i == eqs->selected ? c_bg_highlighted :
+                             id == eqs->selected ? c_bg_highlighted :
                              c_bg_tertiary);
-        // EndScissorMode();
-        BeginScissorModeRec(item_frame); // double scissor, [!] need testing
-        render_string((Vector2) {frame.x + padding * 2,
-                                 frame.y + scroffs + (padding + itemH) * (i + 1) + padding * 1.5f},
-            eq->editor, itemH - padding, false,
-            eq->state == ES_INVALID ? c_fg_alarming : c_fg_primary);
-        EndScissorMode();
-        // item interaction
-        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) &&
-            CheckCollisionPointRec(mp, item_frame) &&
-            CheckCollisionPointRec(mp, scroll_frame) &&
-            i != eqs->selected) {
-            if (eqs->selected != (size_t)-1) {
-                should_redraw = true;
-                Equation * eq_sel = eqs->items + eqs->selected;
-                da_copy(&eq_sel->text, &eq_sel->editor);
-                equation_parse(eq_sel);
+        // clip by length instead of a scissor per item
+        char buf[EDITOR_MAX_COLS];
+        size_t len;
+        int slot = eq->defines ? param_index(eq->defines) : -1;
+        bool has_slider = slot >= 0 && eq->state == ES_VALID &&
+            eqs->params.owner[slot] == id && !(eqs->params.derived >> slot & 1);
+        if (has_slider) {
+            // live value instead of the text, the text is only the initial value
+            len = snprintf(buf, sizeof(buf), "%c = %.3g", eq->defines, eqs->params.values[slot]);
+            if (len > max_chars / 2) len = max_chars / 2;
+            sidebar_slider(eqs, slot, item_frame, mp);
+        } else {
+            // `f | a, b`: the value right aligned, the text gives way
+            IntegralResult area;
+            size_t cols = max_chars < EDITOR_MAX_COLS ? max_chars : EDITOR_MAX_COLS;
+            if (grapher_integral(eq, eqs->params.values, &area)) {
+                char value[32];
+                // not converged: the estimate tells a slowly converging integral from a divergent one
+                size_t vlen = isnan(area.value) ? snprintf(value, sizeof(value), "undefined")
+                    : area.converged ? snprintf(value, sizeof(value), "= %.6g", area.value)
+                    : snprintf(value, sizeof(value), "~ %.6g +- %.2g", area.value, area.error);
+                text_draw(g_font, value, vlen,
+                          (Vector2) {item_frame.x + item_frame.width - padding - text_width(g_font, vlen, charh),
+                                     item_frame.y + padding * 0.5f},
+                          charh, c_bg_highlighted);
+                cols = cols > vlen + 1 ? cols - vlen - 1 : 0;
             }
-            eqs->selected = i;
+            len = string_copy_range(&eq->editor, 0, cols, buf);
+        }
+        text_draw(g_font, buf, len,
+                  (Vector2) {frame.x + padding * 2, item_frame.y + padding * 0.5f},
+                  charh, eq->state == ES_INVALID ? c_fg_alarming : c_fg_primary);
+    }
+    EndScissorMode();
+    // item interaction, hit test by row
+    if (input_mouse_pressed(MOUSE_BUTTON_LEFT) &&
+        CheckCollisionPointRec(mp, scroll_frame) &&
+        mp.x >= frame.x + padding && mp.x < frame.x + frame.width - padding) {
+        float y = mp.y - scrollTop - scroffs;
+        size_t row = y / rowH;
+        size_t id = eqs_row_id(eqs, row);
+        if (y - row * rowH < itemH && id != (size_t)-1 && id != eqs->selected) {
+            if (eqs->selected != (size_t)-1) eqs_commit(eqs, eqs->selected);
+            eqs->selected = id;
+            should_redraw = true; // selection is drawn thicker
         }
     }
     // item interaction
-    if (IsKeyPressed(KEY_ENTER) && eqs->selected != (size_t)-1) {
-        should_redraw = true;
-        Equation * eq_sel = eqs->items + eqs->selected;
-        da_copy(&eq_sel->text, &eq_sel->editor);
-        equation_parse(eq_sel);
+    if (input_key_pressed(KEY_ENTER) && eqs->selected != (size_t)-1) {
+        should_redraw = eqs_commit(eqs, eqs->selected) || should_redraw;
     }
 
     return should_redraw;
 }
 
+#define key_hit(key) (input_key_pressed(key) || input_key_repeat(key))
 void editor(Rectangle frame, String * text) {
     DrawRectangleRec(frame, c_bg_primary);
 
@@ -254,93 +601,619 @@ void editor(Rectangle frame, String * text) {
     }
 
     int charh = 25;
-    int charw = MeasureTextEx(g_font, " ", charh, 0).x;
+    int charw = text_char_width(g_font, charh);
     int padleft = 8;
+    size_t cols = (frame.width - padleft * 2) / charw;
+    if (cols > EDITOR_MAX_COLS) cols = EDITOR_MAX_COLS;
+    if (cols == 0) cols = 1;
+
+    // horizontal scroll, per equation
+    static String * text_old = NULL;
+    static size_t first = 0; // first visible column
+    static bool selecting = false;
+    if (text != text_old) {
+        text_old = text;
+        first = 0;
+        selecting = false;
+    }
+
+    bool shift = input_key_down(KEY_LEFT_SHIFT) || input_key_down(KEY_RIGHT_SHIFT);
+    bool word = input_key_down(KEY_LEFT_ALT) || input_key_down(KEY_RIGHT_ALT) ||
+                input_key_down(KEY_LEFT_CONTROL) || input_key_down(KEY_RIGHT_CONTROL);
+    bool cmd = input_key_down(KEY_LEFT_SUPER) || input_key_down(KEY_RIGHT_SUPER) ||
+               input_key_down(KEY_LEFT_CONTROL) || input_key_down(KEY_RIGHT_CONTROL);
     
     // input
-    if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) &&
-        CheckCollisionPointRec(GetMousePosition(),
-                               (Rectangle) {frame.x + padleft,
-                                            frame.y + frame.height / 2 - charh / 2,
-                                            frame.width - padleft,
-                                            charh})) {
-        text->cursor = (int)(GetMousePosition().x - frame.x - padleft) / charw;
-        if (text->cursor > text->count - 1) text->cursor = text->count - 1;
-    }
-    if ((IsKeyPressed(KEY_LEFT) || IsKeyPressedRepeat(KEY_LEFT)) && text->cursor > 0) text->cursor -= 1;
-    if ((IsKeyPressed(KEY_RIGHT) || IsKeyPressedRepeat(KEY_RIGHT)) && text->cursor < text->count - 1) text->cursor += 1;
-    if ((IsKeyPressed(KEY_BACKSPACE) || IsKeyPressedRepeat(KEY_BACKSPACE))) string_backspace(text);
+    Rectangle line = {frame.x + padleft,
+                      frame.y + frame.height / 2 - charh / 2,
+                      frame.width - padleft,
+                      charh};
+    Vector2 mp = input_mouse();
+    size_t mouse_col = first + (size_t)fmaxf(0, roundf((mp.x - line.x) / charw));
+    if (input_mouse_pressed(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mp, line)) {
+        string_move_cursor(text, mouse_col, shift);
+        selecting = true;
+    }
+    if (!input_mouse_down(MOUSE_BUTTON_LEFT)) selecting = false;
+    if (selecting) string_move_cursor(text, mouse_col, true);
+
+    if (key_hit(KEY_LEFT)) {
+        size_t pos = word ? string_word_left(text, text->cursor)
+            : !shift && string_has_selection(text) ? (text->cursor < text->anchor ? text->cursor : text->anchor)
+            : text->cursor > 0 ? text->cursor - 1 : 0;
+        string_move_cursor(text, pos, shift);
+    }
+    if (key_hit(KEY_RIGHT)) {
+        size_t pos = word ? string_word_right(text, text->cursor)
+            : !shift && string_has_selection(text) ? (text->cursor > text->anchor ? text->cursor : text->anchor)
+            : text->cursor + 1;
+        string_move_cursor(text, pos, shift);
+    }
+    if (key_hit(KEY_HOME)) string_move_cursor(text, 0, shift);
+    if (key_hit(KEY_END)) string_move_cursor(text, text->count, shift);
+    if (key_hit(KEY_BACKSPACE)) {
+        if (word && !string_has_selection(text)) string_move_cursor(text, string_word_left(text, text->cursor), true);
+        string_backspace(text);
+    }
+    if (key_hit(KEY_DELETE)) {
+        if (word && !string_has_selection(text)) string_move_cursor(text, string_word_right(text, text->cursor), true);
+        string_delete(text);
+    }
+
+    // clipboard
+    if (cmd && input_key_pressed(KEY_A)) {
+        text->anchor = 0;
+        text->cursor = text->count;
+    }
+    if (cmd && (input_key_pressed(KEY_C) || input_key_pressed(KEY_X)) && string_has_selection(text)) {
+        size_t begin, end;
+        string_selection(text, &begin, &end);
+        char * buf = malloc(end - begin + 1);
+        buf[string_copy_range(text, begin, end, buf)] = 0;
+        input_set_clipboard(buf);
+        free(buf);
+        if (input_key_pressed(KEY_X)) string_delete_selection(text);
+    }
+    if (cmd && key_hit(KEY_V)) {
+        const char * clip = input_clipboard();
+        if (clip) {
+            // one line only, keep the bulk insert a single gap move
+            size_t n = strcspn(clip, "\r\n");
+            string_insert_n(text, clip, n);
+        }
+    }
         
     int c;
-    while ((c = GetCharPressed()) > 0) {
+    while ((c = input_char()) > 0) {
         string_insert(text, c);
     }
 
+    // keep the cursor in view
+    if (text->cursor < first) first = text->cursor;
+    if (text->cursor >= first + cols) first = text->cursor - cols + 1;
+
     // render
-    render_string((Vector2) {frame.x + padleft, frame.y + frame.height / 2 - charh / 2}, *text, charh, true, c_fg_primary);
+    render_string((Vector2) {line.x, line.y}, text, first, cols, charh, true, c_fg_primary);
 }
+#undef key_hit
 
 
-float lerpf(float x, float froml, float fromr, float tol, float tor) {
-    return tol + (x - froml) / (fromr - froml) * (tor - tol);
+void grapher_input(Rectangle frame, Viewport * vp, bool * should_redraw) {
+    static bool dragging = false;
+    Vector2 mp = input_mouse();
+    bool hover = CheckCollisionPointRec(mp, frame);
+
+    // zoom around the cursor
+    float wheel = input_wheel().y;
+    if (hover && wheel != 0) {
+        double ax = (mp.x - frame.x - frame.width * 0.5) * vp->span_x / frame.width;
+        double ay = -(mp.y - frame.y - frame.height * 0.5) * vp->span_y / frame.height;
+        viewport_zoom(vp, pow(1.1, -wheel), ax, ay);
+        *should_redraw = true;
+    }
+
+    // drag to pan
+    if (hover && input_mouse_pressed(MOUSE_BUTTON_LEFT)) dragging = true;
+    if (!input_mouse_down(MOUSE_BUTTON_LEFT)) dragging = false;
+    Vector2 d = input_mouse_delta();
+    if (dragging && (d.x != 0 || d.y != 0)) {
+        viewport_pan(vp, -d.x * vp->span_x / frame.width, d.y * vp->span_y / frame.height);
+        *should_redraw = true;
+    }
+}
+
+// sample `prog` once every two pixels, `out` in texture coordinates
+void grapher_sample(Program * prog, const double * params, Viewport vp, Precision prec, int width, int height, Polyline * out) {
+    static float * xf = NULL, * yf = NULL;
+    static double * xd = NULL, * yd = NULL;
+    static int n_old = 0;
+    int n = (width + 1) / 2;
+    if (n > n_old) {
+        n_old = n;
+        xf = reallocf(xf, n * sizeof(float));
+        yf = reallocf(yf, n * sizeof(float));
+        xd = reallocf(xd, n * sizeof(double));
+        yd = reallocf(yd, n * sizeof(double));
+        if (!xf || !yf || !xd || !yd) exit(1);
+    }
+    double step_x = vp.span_x / width;
+    double step_y = vp.span_y / height;
+    // offsets from the centre stay small, so the centre keeps its digits
+    switch (prec) {
+    case PREC_FLOAT:
+        for (int i = 0; i < n; ++i) xf[i] = vp.cx.hi + (2 * i - width * 0.5) * step_x;
+        program_eval_batch_f(prog, params, xf, yf, n);
+        for (int i = 0; i < n; ++i) yd[i] = yf[i] - (float)vp.cy.hi;
+        break;
+    case PREC_DOUBLE: {
+        double cy = dd_to_double(vp.cy);
+        for (int i = 0; i < n; ++i) xd[i] = dd_to_double(dd_add(vp.cx, dd_from((2 * i - width * 0.5) * step_x)));
+        program_eval_batch_d(prog, params, xd, yd, n);
+        for (int i = 0; i < n; ++i) yd[i] -= cy;
+    } break;
+    case PREC_DDOUBLE:
+    default:
+        for (int i = 0; i < n; ++i) {
+            ddouble x = dd_add(vp.cx, dd_from((2 * i - width * 0.5) * step_x));
+            yd[i] = dd_to_double(dd_sub(program_eval_dd(prog, params, x), vp.cy));
+        }
+        break;
+    }
+    out->count = 0;
+    for (int i = 0; i < n; ++i) {
+        da_append(out, ((Vector2) {2 * i, height * 0.5f + yd[i] / step_y}));
+    }
 }
-void grapher(Rectangle frame, Equations * eqs, bool should_redraw) {
+
+bool grapher(Rectangle frame, Equations * eqs, SeriesList * data, Stream * live, Viewport * vp, bool should_redraw) {
     // basically this is like a singleton class
-    static RenderTexture2D cvs;
-    static int width_old = 0;
-    static int height_old = 0;
-    static Vector2 * spline = NULL;
-    int scale = 2;
+    static Raster cvs = {}; // one texel per screen pixel, anti-aliased on the cpu
+    static Texture2D tex;
+    static Polylines curves = {}; // sampled curves, kept until their equation is dirty
+    static Polylines series = {}; // decimated data, kept until the view changes
+    static Polyline streamed = {};
+    static FieldViews fields = {}; // one cell per screen pixel, refined over several frames
+    static Precision prec = PREC_FLOAT;
+    int scale = 2; // curves and data are sampled in half pixels
     int width = (frame.width - 2) * scale;
     int height = (frame.height - 2) * scale;
-    if (!cvs.id || width != width_old || height != height_old) { // empty or resized
-        width_old = width;
-        height_old = height;
-        UnloadRenderTexture(cvs);
-        cvs = LoadRenderTexture(width, height);
+    bool resample_all = false;
+    if (!tex.id || tex.width != width / scale || tex.height != height / scale) { // empty or resized
+        UnloadTexture(tex);
+        tex = (Texture2D) {};
+        resample_all = true;
+    }
+    // new live samples, scrolled in from the right unless the user panned away (`End` follows again)
+    bool live_moved = live && stream_drain(live) > 0;
+    StreamSample newest;
+    if (live && input_key_pressed(KEY_END)) live->follow = live_moved = true;
+    if (live_moved && live->follow && stream_last(live, &newest)) {
+        ddouble cx = dd_from(newest.x - vp->span_x * 0.4);
+        if (cx.hi != vp->cx.hi) resample_all = true;
+        vp->cx = cx;
+    }
+    // F4 shows the selected (or first) `z = f(x, y)` in 3d instead, the rest waits until it is pressed again
+    static bool surface_shown = false;
+    if (input_key_pressed(KEY_F4)) {
+        surface_shown = !surface_shown;
+        resample_all = true;
+    }
+    if (surface_shown && grapher_surface(frame, eqs, vp)) return false;
+    ddouble cx_old = vp->cx;
+    double span_old = vp->span_x;
+    grapher_input(frame, vp, &resample_all);
+    if (live && vp->span_x == span_old && (vp->cx.hi != cx_old.hi || vp->cx.lo != cx_old.lo)) live->follow = false;
+    while (curves.count < eqs->count) da_append(&curves, (Polyline) {});
+    while (fields.count < eqs->count) da_append(&fields, (FieldView) {});
+
+    // only dirty equations are evaluated again, e.g. the dependents of a moving parameter
+    g_grapher_stats = (GrapherStats) {};
+    prec = viewport_precision(*vp, width, height);
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        size_t id = eqs->order.items[row];
+        Equation * eq = eqs->items + id;
+        if (!eq->dirty && !resample_all) continue;
+        eq->dirty = false;
+        should_redraw = true;
+        curves.items[id].count = 0;
+        fields.items[id].shown = false;
+        if (eq->state != ES_VALID || eq->defines) continue;
+        if (eq->kind == EK_FIELD || eq->kind == EK_COMPLEX) {
+            // restarts from the coarsest level, evaluated below within the frame budget
+            field_reset(&fields.items[id].field, (FieldJob) {
+                    .kind = eq->kind == EK_FIELD ? FIELD_HEAT : FIELD_COMPLEX,
+                    .prog = eq->prog,
+                    .params = eqs->params.values,
+                    .vp = *vp,
+                    .width = width / scale,
+                    .height = height / scale,
+                });
+            fields.items[id].shown = true;
+        } else if (eq->kind == EK_GRAPH) {
+            grapher_sample(eq->prog, eqs->params.values, *vp, prec, width, height, curves.items + id);
+            g_grapher_stats.evals += curves.items[id].count;
+        } else {
+            // curves are double only, the deep zoom tiers follow pixel columns
+            g_grapher_stats.evals += curve_sample((Curve) {
+                    .kind = eq->kind == EK_POLAR ? CURVE_POLAR : CURVE_PARAMETRIC,
+                    .fx = eq->prog,
+                    .fy = eq->prog_y,
+                    .params = eqs->params.values,
+                    .vp = *vp,
+                    .width = width,
+                    .height = height,
+                }, curves.items + id);
+        }
+        g_grapher_stats.resampled += 1;
+    }
+    while (series.count < data->count) da_append(&series, (Polyline) {});
+    if (resample_all) {
+        for (size_t i = 0; i < data->count; ++i) {
+            g_grapher_stats.samples += series_sample(data->items + i, *vp, width, height, series.items + i);
+        }
+        should_redraw = true;
+    }
+    size_t refining = 0;
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        FieldView * fv = fields.items + eqs->order.items[row];
+        refining += fv->shown && fv->field.level >= 0;
+    }
+    for (size_t row = 0; refining > 0 && row < eqs->order.count; ++row) {
+        FieldView * fv = fields.items + eqs->order.items[row];
+        double t = GetTime();
+        if (!fv->shown || !field_step(&fv->field, FIELD_BUDGET_MS / refining)) continue;
+        g_grapher_stats.field_ms += (GetTime() - t) * 1000;
+        g_grapher_stats.cells += atomic_load(&fv->field.evals);
+        should_redraw = true;
+    }
+    bool busy = false;
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        FieldView * fv = fields.items + eqs->order.items[row];
+        busy = busy || (fv->shown && fv->field.level >= 0);
+    }
+    if (live && (live_moved || resample_all)) {
+        g_grapher_stats.live = stream_sample(live, *vp, width, height, &streamed);
         should_redraw = true;
-        if (spline = reallocf(spline, width * sizeof(Vector2)), !spline) exit(1);
     }
-    if (should_redraw) {
-        BeginTextureMode(cvs);
-        ClearBackground(c_bg_primary);
 
-        // axes
-        int w = 5 * scale, l = 15 * scale, b = 10 * scale;
-        DrawLineEx((Vector2) {0, height/2}, (Vector2) {width - b, height/2}, 2, c_fg_primary);
-        DrawLineEx((Vector2) {width/2, 0}, (Vector2) {width/2, height - b}, 2, c_fg_primary);
-        Vector2 uparrow[] = {
-            {width/2 - w + 0.5f, height - l},
-            {width/2 + 0.5f, height},
-            {width/2 + 0.5f, height - b},
-            {width/2 + w + 0.5f, height - l},
-        };
-        DrawTriangleStrip(uparrow, 4, c_fg_primary);
-        Vector2 rightarrow[] = {
-            {width - l, height/2 + w - 0.5f},
-            {width, height/2 - 0.5f},
-            {width - b, height/2 - 0.5f},
-            {width - l, height/2 - w - 0.5f},
-        };
-        DrawTriangleStrip(rightarrow, 4, c_fg_primary);
-        // todo: integer markers
-
-        // plot
-        float minvalX = -10, maxvalX = 10;
-        float minvalY = -5, maxvalY = 5;
-
-        for (size_t i = 0; i < eqs->count; ++i) {
-            if (eqs->items[i].state != ES_VALID) continue;
-            for (int x = 0; x < width; x += 2) {
-                float valx = lerpf(x, 0, width, minvalX, maxvalX);
-                float valy = expr_eval(eqs->items[i].expr, valx);
-                float y = lerpf(valy, minvalY, maxvalY, 0, height);
-                spline[x/2] = (Vector2) {x, y};
+    if (should_redraw || resample_all) {
+        // fields under everything else, the last one shown covers the others
+        const uint32_t * background = NULL;
+        for (size_t row = 0; row < eqs->order.count; ++row) {
+            FieldView * fv = fields.items + eqs->order.items[row];
+            if (fv->shown && fv->field.job.width == width / scale && fv->field.job.height == height / scale) {
+                background = fv->field.pixels;
             }
-            DrawSplineLinear(spline, width/2, i == eqs->selected ? 4 : 2, BLACK);
         }
+        double t = GetTime();
+        grapher_compose(&cvs, eqs, &curves, &series, live ? &streamed : NULL, background, *vp, width, height, scale);
+        g_grapher_stats.raster_ms = (GetTime() - t) * 1000;
+        g_grapher_stats.prims = cvs.prims.count;
+        if (!tex.id) {
+            tex = LoadTextureFromImage((Image) {
+                    .data = cvs.pixels,
+                    .width = cvs.width,
+                    .height = cvs.height,
+                    .mipmaps = 1,
+                    .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+                });
+        } else {
+            UpdateTexture(tex, cvs.pixels);
+        }
+    }
+    // y up, like the fields
+    DrawTexturePro(tex, (Rectangle) {0, 0, tex.width, -tex.height},
+                   (Rectangle) {frame.x + 1, frame.y + 1, tex.width, tex.height}, (Vector2) {0, 0}, 0.0f, WHITE);
+    double t = GetTime();
+    grapher_labels((Rectangle) {frame.x + 1, frame.y + 1, tex.width, tex.height}, *vp, tex.width, tex.height);
+    g_grapher_stats.labels_ms = (GetTime() - t) * 1000;
+    text_draw(g_font, precision_names[prec], strlen(precision_names[prec]),
+              (Vector2) {frame.x + 8, frame.y + frame.height - 20}, 14, c_fg_placeholder);
+    return busy;
+}
+
+// the numbers along the axes, beside them where they cross the plot and inside the edge
+// they are clamped to otherwise; y is flipped, the plot is y up
+void grapher_labels(Rectangle frame, Viewport vp, int width, int height) {
+    int charh = 14, charw = text_char_width(g_font, charh), gap = 4;
+    AxisTicks tx = axis_ticks(vp.cx, vp.span_x, width, AXIS_X_PX);
+    AxisTicks ty = axis_ticks(vp.cy, vp.span_y, height, AXIS_Y_PX);
+    float ox = width * 0.5f - dd_to_double(vp.cx) * width / vp.span_x;
+    float oy = height * 0.5f - dd_to_double(vp.cy) * height / vp.span_y;
+    ox = ox < 0 ? 0 : ox > width ? width : ox;
+    oy = oy < 0 ? 0 : oy > height ? height : oy;
+    // x labels under the axis, over it at the bottom edge
+    float ly = oy - gap - charh < 0 ? height - oy - gap - charh : height - oy + gap;
+    for (int64_t i = tx.first; i <= tx.last; ++i) {
+        if (!axis_major(&tx, i)) continue;
+        TextRun * run = axis_label(g_axis_labels + 0, &tx, i, g_font, charh);
+        if (!run) continue;
+        float lx = axis_pixel(&tx, i) - run->len * charw * 0.5f;
+        if (lx < 0 || lx + run->len * charw > width) continue;
+        text_draw_run(g_font, run, (Vector2) {frame.x + lx, frame.y + ly}, c_bg_quaternary);
+        g_grapher_stats.labels += 1;
+    }
+    // y labels left of the axis, right of it at the left edge
+    bool right = ox < 6 * charw + gap; // room for the usual labels
+    for (int64_t i = ty.first; i <= ty.last; ++i) {
+        if (!axis_major(&ty, i)) continue;
+        TextRun * run = axis_label(g_axis_labels + 1, &ty, i, g_font, charh);
+        if (!run) continue;
+        float lx = right ? ox + gap : ox - gap - run->len * charw;
+        float ly = height - axis_pixel(&ty, i) - charh * 0.5f;
+        if (lx < 0 || ly < 0 || ly + charh > height) continue;
+        text_draw_run(g_font, run, (Vector2) {frame.x + lx, frame.y + ly}, c_bg_quaternary);
+        g_grapher_stats.labels += 1;
+    }
+}
+
+// the plot without the labels, y up: fields, axes, data and curves. positions are in
+// sample space, `scale` samples per pixel
+void grapher_compose(Raster * r, Equations * eqs, Polylines * curves, Polylines * series, Polyline * streamed,
+                     const uint32_t * background, Viewport vp, int width, int height, int scale) {
+    raster_begin(r, width / scale, height / scale, background, raster_rgba(c_bg_primary));
+    float k = 1.0f / scale;
+
+    // grid, straight into the pixels under everything drawn below: minor lines, then major
+    AxisTicks tx = axis_ticks(vp.cx, vp.span_x, width / scale, AXIS_X_PX);
+    AxisTicks ty = axis_ticks(vp.cy, vp.span_y, height / scale, AXIS_Y_PX);
+    for (int major = 0; major < 2; ++major) {
+        Color c = major ? c_grid_major : c_grid_minor;
+        for (int64_t i = tx.first; i <= tx.last; ++i) {
+            if (axis_major(&tx, i) == major) raster_rule(r, true, axis_pixel(&tx, i), 1, c);
+        }
+        for (int64_t i = ty.first; i <= ty.last; ++i) {
+            if (axis_major(&ty, i) == major) raster_rule(r, false, axis_pixel(&ty, i), 1, c);
+        }
+    }
+
+    // axes, through the origin and clamped to the edges
+    float ox = width * 0.5f - dd_to_double(vp.cx) * width / vp.span_x;
+    float oy = height * 0.5f - dd_to_double(vp.cy) * height / vp.span_y;
+    if (ox < 0) ox = 0;
+    if (ox > width) ox = width;
+    if (oy < 0) oy = 0;
+    if (oy > height) oy = height;
+    int w = 5 * scale, l = 15 * scale, b = 10 * scale;
+    raster_polyline(r, (Vector2[]) {{0, oy}, {width - b, oy}}, 2, k, 2, c_fg_primary);
+    raster_polyline(r, (Vector2[]) {{ox, 0}, {ox, height - b}}, 2, k, 2, c_fg_primary);
+    Vector2 uparrow[] = {
+        {ox - w + 0.5f, height - l},
+        {ox + 0.5f, height},
+        {ox + 0.5f, height - b},
+        {ox + w + 0.5f, height - l},
+    };
+    raster_strip(r, uparrow, 4, k, c_fg_primary);
+    Vector2 rightarrow[] = {
+        {width - l, oy + w - 0.5f},
+        {width, oy - 0.5f},
+        {width - b, oy - 0.5f},
+        {width - l, oy - w - 0.5f},
+    };
+    raster_strip(r, rightarrow, 4, k, c_fg_primary);
+    // a mark on the axes at every labelled line
+    int m = 4 * scale;
+    for (int64_t i = tx.first; i <= tx.last; ++i) {
+        float x = axis_pixel(&tx, i) * scale;
+        if (!axis_major(&tx, i) || x > width - l) continue;
+        raster_polyline(r, (Vector2[]) {{x, oy - m}, {x, oy + m}}, 2, k, 2, c_fg_primary);
+    }
+    for (int64_t i = ty.first; i <= ty.last; ++i) {
+        float y = axis_pixel(&ty, i) * scale;
+        if (!axis_major(&ty, i) || y > height - l) continue;
+        raster_polyline(r, (Vector2[]) {{ox - m, y}, {ox + m, y}}, 2, k, 2, c_fg_primary);
+    }
+
+    // plot, data under the equations
+    for (size_t i = 0; i < series->count; ++i) {
+        if (series->items[i].count < 2) continue;
+        raster_polyline(r, series->items[i].items, series->items[i].count, k, 2, c_bg_highlighted);
+        g_grapher_stats.points += series->items[i].count;
+    }
+    if (streamed && streamed->count >= 2) raster_polyline(r, streamed->items, streamed->count, k, 2, c_bg_highlighted);
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        size_t id = eqs->order.items[row];
+        if (id >= curves->count || curves->items[id].count < 2) continue;
+        IntegralResult area;
+        // a NaN bound or an undefined integral shades nothing, the sidebar says undefined
+        if (grapher_integral(eqs->items + id, eqs->params.values, &area) &&
+            isfinite(area.a) && isfinite(area.b) && !isnan(area.value)) {
+            grapher_shade(r, curves->items + id, area.a, area.b, vp, width, height, k);
+        }
+        raster_polyline(r, curves->items[id].items, curves->items[id].count, k, id == eqs->selected ? 4 : 2, BLACK);
+        g_grapher_stats.drawn += 1;
+    }
+    raster_end(r);
+}
+
+// `f | a, b`: the bounds are evaluated on every call, the integral only on a cache miss
+bool grapher_integral(Equation * eq, const double * params, IntegralResult * out) {
+    if (eq->state != ES_VALID || !eq->from) return false;
+    double a = program_eval_d(eq->from, params, NAN);
+    double b = program_eval_d(eq->to, params, NAN);
+    *out = integral_cached(eq->prog, params, a, b, INTEGRAL_TOL);
+    return true;
+}
+
+// far off samples are pulled in, which only bends the edge within their own column
+static void grapher_shade_column(Polyline * strip, float x, float y, float y0, int height) {
+    y = y < -height ? -height : y > 2 * height ? 2 * height : y; // `y0` is pulled in already
+    da_append(strip, ((Vector2) {x, y0}));
+    da_append(strip, ((Vector2) {x, y}));
+}
+
+// the area between a sampled graph and y = 0 over [a, b], in the same sample space as the
+// curve: a strip of columns at the samples, cut at the bounds and wherever f is undefined
+void grapher_shade(Raster * r, Polyline * curve, double a, double b, Viewport vp, int width, int height, float k) {
+    static Polyline strip = {};
+    double step_x = vp.span_x / width;
+    float xa = width * 0.5 + ((fmin(a, b) - vp.cx.hi) - vp.cx.lo) / step_x;
+    float xb = width * 0.5 + ((fmax(a, b) - vp.cx.hi) - vp.cx.lo) / step_x;
+    // y = 0 is pulled in like the samples, deep zooms put it 1e13 pixels away and more
+    double base = height * 0.5 - dd_to_double(vp.cy) * height / vp.span_y;
+    float y0 = base < -height ? -height : base > 2 * height ? 2 * height : base;
+    Color c = c_bg_highlighted;
+    c.a = 0x50;
+    strip.count = 0;
+    for (size_t i = 0; i + 1 < curve->count; ++i) {
+        Vector2 p = curve->items[i], q = curve->items[i + 1];
+        if (q.x <= xa || p.x >= xb) continue;
+        if (!isfinite(p.y) || !isfinite(q.y)) {
+            if (strip.count >= 4) raster_strip(r, strip.items, strip.count, k, c);
+            strip.count = 0;
+            continue;
+        }
+        float d = q.x - p.x;
+        if (strip.count == 0) {
+            float x = p.x < xa ? xa : p.x;
+            grapher_shade_column(&strip, x, p.y + (q.y - p.y) * (x - p.x) / d, y0, height);
+        }
+        float x = q.x > xb ? xb : q.x;
+        grapher_shade_column(&strip, x, p.y + (q.y - p.y) * (x - p.x) / d, y0, height);
+    }
+    if (strip.count >= 4) raster_strip(r, strip.items, strip.count, k, c);
+}
+
+#define EXPORT_WIDTH 1600
+
+// headless: the curves, the last field and the data in `vp` into a ppm, without a window
+int grapher_export(const char * path, Equations * eqs, SeriesList * data, Viewport vp) {
+    int scale = 2;
+    int height_px = EXPORT_WIDTH * vp.span_y / vp.span_x;
+    if (height_px < 16) height_px = 16;
+    if (height_px > 4 * EXPORT_WIDTH) height_px = 4 * EXPORT_WIDTH;
+    int width = EXPORT_WIDTH * scale, height = height_px * scale;
+    Precision prec = viewport_precision(vp, width, height);
+    Polylines curves = {}, series = {};
+    Field field = {};
+    const uint32_t * background = NULL;
+    while (curves.count < eqs->count) da_append(&curves, (Polyline) {});
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        size_t id = eqs->order.items[row];
+        Equation * eq = eqs->items + id;
+        if (eq->state != ES_VALID || eq->defines) continue;
+        if (eq->kind == EK_FIELD || eq->kind == EK_COMPLEX) {
+            // every level at once, the last field covers the others like on screen
+            field_reset(&field, (FieldJob) {
+                    .kind = eq->kind == EK_FIELD ? FIELD_HEAT : FIELD_COMPLEX,
+                    .prog = eq->prog,
+                    .params = eqs->params.values,
+                    .vp = vp,
+                    .width = width / scale,
+                    .height = height / scale,
+                });
+            while (field.level >= 0) field_step(&field, INFINITY);
+            background = field.pixels;
+        } else if (eq->kind == EK_GRAPH) {
+            grapher_sample(eq->prog, eqs->params.values, vp, prec, width, height, curves.items + id);
+        } else {
+            curve_sample((Curve) {
+                    .kind = eq->kind == EK_POLAR ? CURVE_POLAR : CURVE_PARAMETRIC,
+                    .fx = eq->prog,
+                    .fy = eq->prog_y,
+                    .params = eqs->params.values,
+                    .vp = vp,
+                    .width = width,
+                    .height = height,
+                }, curves.items + id);
+        }
+    }
+    for (size_t i = 0; i < data->count; ++i) {
+        da_append(&series, (Polyline) {});
+        series_sample(data->items + i, vp, width, height, series.items + i);
+    }
+    Raster r = {};
+    grapher_compose(&r, eqs, &curves, &series, NULL, background, vp, width, height, scale);
+    int failed = raster_write_ppm(&r, path, true);
+    raster_free(&r);
+    field_free(&field);
+    for (size_t i = 0; i < curves.count; ++i) da_free(curves.items + i);
+    for (size_t i = 0; i < series.count; ++i) da_free(series.items + i);
+    da_free(&curves);
+    da_free(&series);
+    return failed;
+}
+
+static void grapher_surface_release(Mesh * mesh) {
+    if (mesh->vaoId) UnloadMesh(*mesh); // the cpu arrays too
+    else surface_mesh_free(mesh);
+}
+
+// left drag orbits, the wheel moves the camera in and out, right drag pans the view underneath
+bool grapher_surface(Rectangle frame, Equations * eqs, Viewport * vp) {
+    static Surface surface = {.release = grapher_surface_release};
+    static RenderTexture2D cvs;
+    static Material material;
+    static float yaw = 0.8f, pitch = 0.6f, distance = 3.2f;
+    static bool orbiting = false, panning = false;
+    Equation * eq = eqs_get(eqs, eqs->selected);
+    for (size_t row = 0; row < eqs->order.count && !(eq && eq->kind == EK_FIELD); ++row) {
+        eq = eqs->items + eqs->order.items[row];
+    }
+    if (!eq || eq->kind != EK_FIELD || eq->state != ES_VALID) return false;
+    if (eq->dirty) surface_invalidate(&surface);
+    eq->dirty = false;
+
+    int width = frame.width - 2, height = frame.height - 2;
+    if (!cvs.id || cvs.texture.width != width || cvs.texture.height != height) {
+        UnloadRenderTexture(cvs);
+        cvs = LoadRenderTexture(width, height);
+    }
+    if (!material.maps) material = LoadMaterialDefault();
 
-        EndTextureMode();
+    Vector2 mp = input_mouse();
+    bool hover = CheckCollisionPointRec(mp, frame);
+    if (hover && input_mouse_pressed(MOUSE_BUTTON_LEFT)) orbiting = true;
+    if (!input_mouse_down(MOUSE_BUTTON_LEFT)) orbiting = false;
+    if (hover && input_mouse_pressed(MOUSE_BUTTON_RIGHT)) panning = true;
+    if (!input_mouse_down(MOUSE_BUTTON_RIGHT)) panning = false;
+    Vector2 d = input_mouse_delta();
+    if (orbiting) {
+        yaw -= d.x * 0.01f;
+        pitch = fminf(1.5f, fmaxf(0.05f, pitch + d.y * 0.01f));
+    }
+    if (panning && (d.x != 0 || d.y != 0)) {
+        // along the ground, right and away from the camera
+        float k = distance / height;
+        float wx = -d.x * k * cosf(yaw) - d.y * k * sinf(yaw);
+        float wz = d.x * k * sinf(yaw) - d.y * k * cosf(yaw);
+        viewport_pan(vp, wx * vp->span_x * 0.5, -wz * vp->span_y * 0.5);
+    }
+    float wheel = input_wheel().y;
+    if (hover && wheel != 0) distance = fminf(12.0f, fmaxf(1.0f, distance * powf(1.1f, -wheel)));
+    Camera3D camera = {
+        .position = {distance * cosf(pitch) * sinf(yaw), distance * sinf(pitch), distance * cosf(pitch) * cosf(yaw)},
+        .target = {0, 0, 0},
+        .up = {0, 1, 0},
+        .fovy = 45,
+        .projection = CAMERA_PERSPECTIVE,
+    };
+
+    // only chunks whose key changed are rebuilt, then uploaded here
+    surface_update(&surface, (SurfaceJob) {eq->prog, eqs->params.values, *vp, camera.position});
+    g_grapher_stats = (GrapherStats) {
+        .chunks = surface.chunks,
+        .rebuilt = surface.rebuilt,
+        .triangles = surface.triangles,
+        .surface_ms = surface.build_ms,
+    };
+    BeginTextureMode(cvs);
+    ClearBackground(c_bg_primary);
+    BeginMode3D(camera);
+    rlDisableBackfaceCulling(); // a surface has two sides
+    for (size_t k = 0; k < surface.count; ++k) {
+        SurfaceChunk * c = surface.items + k;
+        if (!c->used || c->mesh.triangleCount == 0) continue;
+        if (!c->mesh.vaoId) UploadMesh(&c->mesh, false);
+        float ox, oz;
+        surface_chunk_offset(&surface, c, &ox, &oz);
+        Matrix at = {1, 0, 0, ox, 0, 1, 0, 0, 0, 0, 1, oz, 0, 0, 0, 1};
+        DrawMesh(c->mesh, material, at);
     }
-    DrawTexturePro(cvs.texture, (Rectangle) {0, 0, width, height}, frame, (Vector2) {0, 0}, 0.0f, WHITE);
+    rlEnableBackfaceCulling();
+    DrawCubeWires((Vector3) {0, 0, 0}, 2, 2 * SURFACE_HEIGHT, 2, c_fg_placeholder);
+    EndMode3D();
+    EndTextureMode();
+    DrawTexturePro(cvs.texture, (Rectangle) {0, 0, width, -height}, frame, (Vector2) {0, 0}, 0.0f, WHITE);
+    return true;
 }
@@ -0,0 +1,298 @@
+#ifndef PRECISION_H_
+#define PRECISION_H_
+
+#include <stddef.h> // size_t
+#include <math.h> // fabs, floor, ldexp, and others
+
+/* Precision tiers */
+
+// float is fast, double covers ordinary zooming,
+// double-double keeps ~32 significant digits for extreme zoom
+typedef enum {
+    PREC_FLOAT,
+    PREC_DOUBLE,
+    PREC_DDOUBLE,
+} Precision;
+
+const char precision_names[][14] = {
+    "float", "double", "double-double",
+};
+
+Precision precision_pick(double span, double magnitude, int pixels);
+
+// @algo: a tier is good enough when one pixel step is still resolved by
+// a few dozen ulps at the largest coordinate in view. otherwise neighbouring
+// samples collapse into the same value and curves turn into staircases
+Precision precision_pick(double span, double magnitude, int pixels) {
+    if (pixels <= 0) pixels = 1;
+    double step = span / pixels;
+    if (magnitude < span) magnitude = span;
+    double rel = step / magnitude;
+    if (rel > 1e-5) return PREC_FLOAT;   // float eps ~1.2e-7
+    if (rel > 1e-13) return PREC_DOUBLE; // double eps ~2.2e-16
+    return PREC_DDOUBLE;
+}
+
+
+/* Double-double */
+
+// unevaluated sum hi + lo with |lo| <= ulp(hi) / 2
+typedef struct {
+    double hi, lo;
+} ddouble;
+
+static const ddouble DD_PI = {3.141592653589793116e+00, 1.224646799147353207e-16};
+static const ddouble DD_PI_2 = {1.570796326794896558e+00, 6.123233995736766036e-17};
+static const ddouble DD_E = {2.718281828459045091e+00, 1.445646891729250158e-16};
+static const ddouble DD_LN2 = {6.931471805599452862e-01, 2.319046813846299558e-17};
+
+ddouble dd_from(double a);
+double dd_to_double(ddouble a);
+ddouble dd_add(ddouble a, ddouble b);
+ddouble dd_sub(ddouble a, ddouble b);
+ddouble dd_mul(ddouble a, ddouble b);
+ddouble dd_div(ddouble a, ddouble b);
+ddouble dd_neg(ddouble a);
+ddouble dd_mul_d(ddouble a, double b);
+ddouble dd_ldexp(ddouble a, int e);
+ddouble dd_fmod(ddouble a, ddouble b);
+ddouble dd_floor(ddouble a);
+ddouble dd_ceil(ddouble a);
+ddouble dd_round(ddouble a);
+ddouble dd_sqrt(ddouble a);
+ddouble dd_exp(ddouble a);
+ddouble dd_log(ddouble a);
+ddouble dd_sin(ddouble a);
+ddouble dd_cos(ddouble a);
+ddouble dd_tan(ddouble a);
+ddouble dd_atan(ddouble a);
+ddouble dd_asin(ddouble a);
+ddouble dd_acos(ddouble a);
+ddouble dd_sinh(ddouble a);
+ddouble dd_cosh(ddouble a);
+ddouble dd_tanh(ddouble a);
+ddouble dd_atan2(ddouble y, ddouble x);
+ddouble dd_powi(ddouble a, int n);
+ddouble dd_pow(ddouble a, ddouble b);
+ddouble dd_hypot(ddouble a, ddouble b);
+
+// error free transformations
+static inline ddouble dd_two_sum(double a, double b) {
+    double s = a + b;
+    double bb = s - a;
+    return (ddouble) {s, (a - (s - bb)) + (b - bb)};
+}
+static inline ddouble dd_quick_two_sum(double a, double b) { // |a| >= |b|
+    double s = a + b;
+    return (ddouble) {s, b - (s - a)};
+}
+static inline ddouble dd_two_prod(double a, double b) {
+    double p = a * b;
+    return (ddouble) {p, fma(a, b, -p)};
+}
+
+ddouble dd_from(double a) { return (ddouble) {a, 0}; }
+double dd_to_double(ddouble a) { return a.hi + a.lo; }
+
+ddouble dd_add(ddouble a, ddouble b) {
+    ddouble s = dd_two_sum(a.hi, b.hi);
+    ddouble t = dd_two_sum(a.lo, b.lo);
+    s.lo += t.hi;
+    s = dd_quick_two_sum(s.hi, s.lo);
+    s.lo += t.lo;
+    return dd_quick_two_sum(s.hi, s.lo);
+}
+ddouble dd_neg(ddouble a) { return (ddouble) {-a.hi, -a.lo}; }
+ddouble dd_sub(ddouble a, ddouble b) { return dd_add(a, dd_neg(b)); }
+
+ddouble dd_mul(ddouble a, ddouble b) {
+    ddouble p = dd_two_prod(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+    return dd_quick_two_sum(p.hi, p.lo);
+}
+ddouble dd_mul_d(ddouble a, double b) {
+    ddouble p = dd_two_prod(a.hi, b);
+    p.lo += a.lo * b;
+    return dd_quick_two_sum(p.hi, p.lo);
+}
+ddouble dd_div(ddouble a, ddouble b) {
+    // long division, two correction steps
+    double q1 = a.hi / b.hi;
+    ddouble r = dd_sub(a, dd_mul_d(b, q1));
+    double q2 = r.hi / b.hi;
+    r = dd_sub(r, dd_mul_d(b, q2));
+    double q3 = r.hi / b.hi;
+    ddouble q = dd_quick_two_sum(q1, q2);
+    return dd_add(q, dd_from(q3));
+}
+ddouble dd_ldexp(ddouble a, int e) { return (ddouble) {ldexp(a.hi, e), ldexp(a.lo, e)}; }
+
+ddouble dd_floor(ddouble a) {
+    double hi = floor(a.hi);
+    if (hi != a.hi) return (ddouble) {hi, 0};
+    return dd_quick_two_sum(hi, floor(a.lo)); // hi is integral, lo decides
+}
+ddouble dd_ceil(ddouble a) {
+    double hi = ceil(a.hi);
+    if (hi != a.hi) return (ddouble) {hi, 0};
+    return dd_quick_two_sum(hi, ceil(a.lo));
+}
+ddouble dd_round(ddouble a) {
+    return dd_floor(dd_add(a, dd_from(0.5)));
+}
+ddouble dd_fmod(ddouble a, ddouble b) { // same sign convention as fmod
+    ddouble q = dd_div(a, b);
+    q = q.hi < 0 ? dd_ceil(q) : dd_floor(q);
+    return dd_sub(a, dd_mul(q, b));
+}
+
+ddouble dd_sqrt(ddouble a) {
+    if (a.hi <= 0) return dd_from(a.hi == 0 ? 0 : NAN);
+    // one Newton step from the double estimate doubles the digits
+    double x = 1.0 / sqrt(a.hi);
+    double ax = a.hi * x;
+    ddouble d = dd_sub(a, dd_two_prod(ax, ax));
+    return dd_two_sum(ax, d.hi * (x * 0.5));
+}
+
+ddouble dd_exp(ddouble a) {
+    if (a.hi > 709) return dd_from(INFINITY);
+    if (a.hi < -745) return dd_from(0);
+    // @algo: exp(a) = 2^k * exp(r)^(2^9), r = (a - k ln2) / 2^9, Taylor on tiny r
+    double k = floor(a.hi / DD_LN2.hi + 0.5);
+    ddouble r = dd_ldexp(dd_sub(a, dd_mul_d(DD_LN2, k)), -9);
+    ddouble sum = dd_from(0);
+    ddouble term = dd_from(1);
+    for (int i = 1; i < 20; ++i) {
+        term = dd_div(dd_mul(term, r), dd_from(i));
+        sum = dd_add(sum, term);
+        if (fabs(term.hi) < 1e-33) break;
+    }
+    // (1 + s)^2 - 1 = 2s + s^2 keeps precision for small s
+    for (int i = 0; i < 9; ++i) {
+        sum = dd_add(dd_ldexp(sum, 1), dd_mul(sum, sum));
+    }
+    return dd_ldexp(dd_add(sum, dd_from(1)), (int)k);
+}
+
+ddouble dd_log(ddouble a) {
+    if (a.hi <= 0) return dd_from(a.hi == 0 ? -INFINITY : NAN);
+    if (isinf(a.hi)) return a;
+    // Newton: y' = y + a exp(-y) - 1
+    ddouble y = dd_from(log(a.hi));
+    y = dd_sub(dd_add(y, dd_mul(a, dd_exp(dd_neg(y)))), dd_from(1));
+    return y;
+}
+
+// sin and cos on |r| <= pi/4
+static ddouble dd_sin_taylor(ddouble r) {
+    ddouble r2 = dd_neg(dd_mul(r, r));
+    ddouble sum = r;
+    ddouble term = r;
+    for (int i = 2; i < 40; i += 2) {
+        term = dd_div(dd_mul(term, r2), dd_from((double)i * (i + 1)));
+        sum = dd_add(sum, term);
+        if (fabs(term.hi) < 1e-33) break;
+    }
+    return sum;
+}
+static ddouble dd_cos_taylor(ddouble r) {
+    ddouble r2 = dd_neg(dd_mul(r, r));
+    ddouble sum = dd_from(1);
+    ddouble term = dd_from(1);
+    for (int i = 1; i < 40; i += 2) {
+        term = dd_div(dd_mul(term, r2), dd_from((double)i * (i + 1)));
+        sum = dd_add(sum, term);
+        if (fabs(term.hi) < 1e-33) break;
+    }
+    return sum;
+}
+// a = q * pi/2 + r, returns q mod 4
+static int dd_reduce_half_pi(ddouble a, ddouble * r) {
+    double q = floor(a.hi / DD_PI_2.hi + 0.5);
+    *r = dd_sub(a, dd_mul_d(DD_PI_2, q));
+    return (int)fmod(fmod(q, 4) + 4, 4);
+}
+
+ddouble dd_sin(ddouble a) {
+    if (!isfinite(a.hi)) return dd_from(NAN);
+    ddouble r;
+    switch (dd_reduce_half_pi(a, &r)) {
+    case 0: return dd_sin_taylor(r);
+    case 1: return dd_cos_taylor(r);
+    case 2: return dd_neg(dd_sin_taylor(r));
+    default: return dd_neg(dd_cos_taylor(r));
+    }
+}
+ddouble dd_cos(ddouble a) {
+    if (!isfinite(a.hi)) return dd_from(NAN);
+    ddouble r;
+    switch (dd_reduce_half_pi(a, &r)) {
+    case 0: return dd_cos_taylor(r);
+    case 1: return dd_neg(dd_sin_taylor(r));
+    case 2: return dd_neg(dd_cos_taylor(r));
+    default: return dd_sin_taylor(r);
+    }
+}
+ddouble dd_tan(ddouble a) { return dd_div(dd_sin(a), dd_cos(a)); }
+
+ddouble dd_atan(ddouble a) {
+    if (isnan(a.hi)) return a;
+    // Newton on tan: y' = y - (tan y - a) cos^2 y = y + (a cos y - sin y) cos y
+    ddouble y = dd_from(atan(a.hi));
+    if (fabs(y.hi) >= DD_PI_2.hi) return y;
+    ddouble s = dd_sin(y), c = dd_cos(y);
+    return dd_add(y, dd_mul(dd_sub(dd_mul(a, c), s), c));
+}
+ddouble dd_asin(ddouble a) {
+    if (fabs(a.hi) > 1) return dd_from(NAN);
+    ddouble c = dd_sqrt(dd_sub(dd_from(1), dd_mul(a, a)));
+    if (c.hi == 0) return a.hi > 0 ? DD_PI_2 : dd_neg(DD_PI_2);
+    return dd_atan(dd_div(a, c));
+}
+ddouble dd_acos(ddouble a) { return dd_sub(DD_PI_2, dd_asin(a)); }
+
+ddouble dd_sinh(ddouble a) {
+    ddouble e = dd_exp(a);
+    return dd_ldexp(dd_sub(e, dd_div(dd_from(1), e)), -1);
+}
+ddouble dd_cosh(ddouble a) {
+    ddouble e = dd_exp(a);
+    return dd_ldexp(dd_add(e, dd_div(dd_from(1), e)), -1);
+}
+ddouble dd_tanh(ddouble a) {
+    if (fabs(a.hi) > 40) return dd_from(a.hi > 0 ? 1 : -1);
+    ddouble e2 = dd_exp(dd_ldexp(a, 1));
+    return dd_div(dd_sub(e2, dd_from(1)), dd_add(e2, dd_from(1)));
+}
+
+ddouble dd_atan2(ddouble y, ddouble x) {
+    if (isnan(y.hi) || isnan(x.hi)) return dd_from(NAN);
+    if (x.hi > 0) return dd_atan(dd_div(y, x));
+    if (x.hi < 0) return y.hi >= 0 ? dd_add(dd_atan(dd_div(y, x)), DD_PI) : dd_sub(dd_atan(dd_div(y, x)), DD_PI);
+    if (y.hi == 0) return dd_from(0);
+    return y.hi > 0 ? DD_PI_2 : dd_neg(DD_PI_2);
+}
+
+// square and multiply
+ddouble dd_powi(ddouble a, int n) {
+    ddouble r = dd_from(1);
+    unsigned m = n < 0 ? -(unsigned)n : (unsigned)n;
+    for (ddouble b = a; m; m >>= 1, b = dd_mul(b, b)) {
+        if (m & 1) r = dd_mul(r, b);
+    }
+    return n < 0 ? dd_div(dd_from(1), r) : r;
+}
+
+ddouble dd_pow(ddouble a, ddouble b) {
+    if (b.lo == 0 && fabs(b.hi) < 1 << 30 && b.hi == (int)b.hi) return dd_powi(a, (int)b.hi);
+    if (a.hi == 0) return dd_from(b.hi > 0 ? 0 : INFINITY);
+    if (a.hi < 0) return dd_from(NAN); // non integer power of a negative
+    return dd_exp(dd_mul(b, dd_log(a)));
+}
+
+ddouble dd_hypot(ddouble a, ddouble b) {
+    return dd_sqrt(dd_add(dd_mul(a, a), dd_mul(b, b)));
+}
+
+#endif // PRECISION_H_
@@ -0,0 +1,361 @@
+#ifndef RASTER_H_
+#define RASTER_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t
+#include <stdbool.h>
+#include <stdio.h> // fopen, fwrite
+#include <string.h> // memcpy
+#include <math.h> // sqrtf, fminf, isfinite
+
+#include <raylib.h> // Vector2, Color
+
+#include "dynarray.h"
+#include "field.h" // g_field_pool
+
+/*
+  cpu rasterizer for the 2d plot, one texel per screen pixel.
+  coverage is analytic: a pixel's share of a stroke is its centre's distance to the
+  segment against the half width, a box filter across the edge, so there is no
+  oversized target to resolve. consecutive segments of one polyline take the maximum
+  coverage, so joints are not blended twice, and the triangles of one strip add theirs,
+  so shared edges leave no seam.
+  primitives are binned into tiles, and the tiles are filled in parallel in draw order
+ */
+
+#define RASTER_TILE 64
+
+typedef struct {
+    float ax, ay, bx, by, cx, cy; // segment a -> b, or a triangle with c
+    float half; // half the stroke width, 0 for a triangle
+    uint32_t rgba;
+    uint32_t group; // consecutive primitives of one group share coverage
+} RasterPrim;
+
+typedef struct {
+    uint32_t * items; // primitive indices, in draw order
+    size_t count;
+    size_t capacity;
+} RasterBin;
+
+typedef struct {
+    uint32_t * pixels; // bytes in memory: r g b a
+    int width, height;
+    int capacity;
+
+    struct {
+        RasterPrim * items;
+        size_t count;
+        size_t capacity;
+    } prims;
+    RasterBin * bins;
+    int tiles_x, tiles_y, bin_capacity;
+    uint32_t groups;
+    atomic_int next_tile;
+} Raster;
+
+void raster_begin(Raster * r, int width, int height, const uint32_t * background, uint32_t clear); // `background` may be NULL
+// `scale` takes `points` and `thickness` to pixels
+void raster_polyline(Raster * r, const Vector2 * points, size_t count, float scale, float thickness, Color c);
+void raster_strip(Raster * r, const Vector2 * points, size_t count, float scale, Color c); // like `DrawTriangleStrip`
+// a line across the whole canvas at pixel `at`, blended right away: under every primitive
+void raster_rule(Raster * r, bool vertical, float at, float thickness, Color c);
+void raster_end(Raster * r); // fills the tiles
+int raster_write_ppm(Raster * r, const char * path, bool y_up); // `y_up`: row 0 is the bottom, return 1 on failure
+void raster_free(Raster * r);
+
+void raster_begin(Raster * r, int width, int height, const uint32_t * background, uint32_t clear) {
+    if (width * height > r->capacity) {
+        r->capacity = width * height;
+        r->pixels = reallocf(r->pixels, r->capacity * sizeof(uint32_t));
+        if (!r->pixels) exit(1);
+    }
+    r->width = width;
+    r->height = height;
+    if (background) {
+        memcpy(r->pixels, background, width * height * sizeof(uint32_t));
+    } else {
+        for (int i = 0; i < width * height; ++i) r->pixels[i] = clear;
+    }
+    r->tiles_x = (width + RASTER_TILE - 1) / RASTER_TILE;
+    r->tiles_y = (height + RASTER_TILE - 1) / RASTER_TILE;
+    int tiles = r->tiles_x * r->tiles_y;
+    if (tiles > r->bin_capacity) {
+        r->bins = reallocf(r->bins, tiles * sizeof(RasterBin));
+        if (!r->bins) exit(1);
+        for (int t = r->bin_capacity; t < tiles; ++t) r->bins[t] = (RasterBin) {};
+        r->bin_capacity = tiles;
+    }
+    for (int t = 0; t < tiles; ++t) r->bins[t].count = 0;
+    r->prims.count = 0;
+    r->groups = 0;
+}
+
+static uint32_t raster_rgba(Color c) {
+    uint32_t rgba;
+    memcpy(&rgba, &c, sizeof(rgba)); // same byte order
+    return rgba;
+}
+
+static inline int raster_floor(float v) {
+    int i = (int)v;
+    return i - (v < i);
+}
+
+// floor of `v` clamped to [lo, hi] while still a float, the int conversion is undefined out of range
+static inline int raster_floor_in(float v, int lo, int hi) {
+    return raster_floor(fminf(fmaxf(v, lo), hi));
+}
+
+// into every tile whose square reaches within `reach` of the segment or triangle
+static void raster_bin(Raster * r, float x0, float y0, float x1, float y1, float reach) {
+    RasterPrim * p = r->prims.items + r->prims.count - 1;
+    uint32_t id = r->prims.count - 1;
+    int tx0 = raster_floor_in((x0 - reach) / RASTER_TILE, 0, r->tiles_x);
+    int tx1 = raster_floor_in((x1 + reach) / RASTER_TILE, -1, r->tiles_x - 1);
+    int ty0 = raster_floor_in((y0 - reach) / RASTER_TILE, 0, r->tiles_y);
+    int ty1 = raster_floor_in((y1 + reach) / RASTER_TILE, -1, r->tiles_y - 1);
+    float dx = p->bx - p->ax, dy = p->by - p->ay;
+    float len = sqrtf(dx * dx + dy * dy);
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            // a long diagonal stroke skips the tiles its box covers but it does not
+            if (p->half > 0 && len > RASTER_TILE) {
+                float mx = (tx + 0.5f) * RASTER_TILE - p->ax, my = (ty + 0.5f) * RASTER_TILE - p->ay;
+                if (fabsf(mx * dy - my * dx) / len > reach + RASTER_TILE * 0.7072f) continue;
+            }
+            da_append(&r->bins[ty * r->tiles_x + tx], id);
+        }
+    }
+}
+
+// @algo: liang-barsky against the canvas grown by the stroke, so that far off points
+// (a curve near an asymptote) keep float precision in the distance computation
+static bool raster_clip(float * ax, float * ay, float * bx, float * by, float x0, float y0, float x1, float y1) {
+    float t0 = 0, t1 = 1, dx = *bx - *ax, dy = *by - *ay;
+    float p[4] = {-dx, dx, -dy, dy}, q[4] = {*ax - x0, x1 - *ax, *ay - y0, y1 - *ay};
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0) {
+            if (q[i] < 0) return false;
+            continue;
+        }
+        float t = q[i] / p[i];
+        if (p[i] < 0 && t > t0) t0 = t;
+        if (p[i] > 0 && t < t1) t1 = t;
+    }
+    if (t0 > t1) return false;
+    float sx = *ax, sy = *ay;
+    *ax = sx + t0 * dx, *ay = sy + t0 * dy;
+    *bx = sx + t1 * dx, *by = sy + t1 * dy;
+    return true;
+}
+
+void raster_polyline(Raster * r, const Vector2 * points, size_t count, float scale, float thickness, Color c) {
+    float half = thickness * scale * 0.5f, margin = half + 2;
+    if (!(half > 0)) return;
+    uint32_t rgba = raster_rgba(c), group = r->groups++;
+    for (size_t i = 1; i < count; ++i) {
+        float ax = points[i - 1].x * scale, ay = points[i - 1].y * scale;
+        float bx = points[i].x * scale, by = points[i].y * scale;
+        if (!isfinite(ax) || !isfinite(ay) || !isfinite(bx) || !isfinite(by)) continue;
+        if (!raster_clip(&ax, &ay, &bx, &by, -margin, -margin, r->width + margin, r->height + margin)) continue;
+        da_append(&r->prims, ((RasterPrim) {ax, ay, bx, by, 0, 0, half, rgba, group}));
+        raster_bin(r, fminf(ax, bx), fminf(ay, by), fmaxf(ax, bx), fmaxf(ay, by), half + 1);
+    }
+}
+
+void raster_strip(Raster * r, const Vector2 * points, size_t count, float scale, Color c) {
+    uint32_t rgba = raster_rgba(c), group = r->groups++;
+    for (size_t i = 2; i < count; ++i) {
+        float ax = points[i - 2].x * scale, ay = points[i - 2].y * scale;
+        float bx = points[i - 1].x * scale, by = points[i - 1].y * scale;
+        float cx = points[i].x * scale, cy = points[i].y * scale;
+        if (!isfinite(ax) || !isfinite(ay) || !isfinite(bx) || !isfinite(by) || !isfinite(cx) || !isfinite(cy)) continue;
+        da_append(&r->prims, ((RasterPrim) {ax, ay, bx, by, cx, cy, 0, rgba, group}));
+        raster_bin(r, fminf(ax, fminf(bx, cx)), fminf(ay, fminf(by, cy)), fmaxf(ax, fmaxf(bx, cx)), fmaxf(ay, fmaxf(by, cy)), 1);
+    }
+}
+
+// coverage of pixel centre (px, py) by a triangle: distance outside the farthest edge, either winding
+static float raster_coverage(RasterPrim * p, float px, float py) {
+    float v[3][2] = {{p->ax, p->ay}, {p->bx, p->by}, {p->cx, p->cy}};
+    float area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[1][1] - v[0][1]) * (v[2][0] - v[0][0]);
+    float sign = area < 0 ? -1 : 1, outside = -INFINITY;
+    for (int i = 0; i < 3; ++i) {
+        float * a = v[i], * b = v[(i + 1) % 3];
+        float ex = b[0] - a[0], ey = b[1] - a[1];
+        float len = sqrtf(ex * ex + ey * ey);
+        if (len == 0) continue;
+        float d = sign * ((px - a[0]) * ey - (py - a[1]) * ex) / len;
+        if (d > outside) outside = d;
+    }
+    float c = 0.5f - outside;
+    return c < 0 ? 0 : c > 1 ? 1 : c;
+}
+
+static void raster_blend(uint32_t * dst, uint32_t src, float coverage) {
+    float a = coverage * (src >> 24) * (1.0f / 255);
+    uint32_t out = 0xFFu << 24;
+    for (int k = 0; k < 24; k += 8) {
+        float d = *dst >> k & 0xFF, s = src >> k & 0xFF;
+        out |= (uint32_t)(d + (s - d) * a + 0.5f) << k;
+    }
+    *dst = out;
+}
+
+// an axis aligned stroke covers a pixel by the overlap of the two spans, what the distance
+// based coverage of a segment gives too, so a rule looks like the same line as a polyline
+void raster_rule(Raster * r, bool vertical, float at, float thickness, Color c) {
+    float lo = at - thickness * 0.5f, hi = at + thickness * 0.5f;
+    int n = vertical ? r->width : r->height, along = vertical ? r->height : r->width;
+    if (!(hi > 0 && lo < n)) return; // off the canvas, or NaN
+    int i0 = raster_floor(lo), i1 = raster_floor(hi);
+    i0 = i0 < 0 ? 0 : i0, i1 = i1 >= n ? n - 1 : i1;
+    uint32_t rgba = raster_rgba(c), src_rb = rgba & 0xFF00FF, src_g = rgba & 0xFF00;
+    size_t stride = vertical ? r->width : 1;
+    for (int i = i0; i <= i1; ++i) {
+        float cov = fminf(hi, i + 1) - fmaxf(lo, i);
+        if (cov <= 0) continue;
+        // @algo: one weight for the whole line, out of 256: red and blue blend in one word,
+        // green in another, within one step of `raster_blend`
+        uint32_t a = (uint32_t)(cov * (rgba >> 24) * (256.0f / 255) + 0.5f), keep = 256 - a;
+        uint32_t s_rb = src_rb * a + 0x800080, s_g = src_g * a + 0x8000;
+        uint32_t * p = r->pixels + (vertical ? (size_t)i : (size_t)i * r->width);
+        for (int j = 0; j < along; ++j, p += stride) {
+            uint32_t d = *p;
+            *p = 0xFF000000u | (((d & 0xFF00FF) * keep + s_rb) >> 8 & 0xFF00FF) | (((d & 0xFF00) * keep + s_g) >> 8 & 0xFF00);
+        }
+    }
+}
+
+// @algo: per tile, the pixels a group reaches are stamped with it on first touch and
+// listed; coverage accumulates in place and only the listed pixels are blended, so the
+// cost follows the pixels near the strokes, not the boxes around them
+static void raster_tile(Raster * r, int tile) {
+    RasterBin * bin = r->bins + tile;
+    int x0 = tile % r->tiles_x * RASTER_TILE, y0 = tile / r->tiles_x * RASTER_TILE;
+    int x1 = x0 + RASTER_TILE < r->width ? x0 + RASTER_TILE : r->width;
+    int y1 = y0 + RASTER_TILE < r->height ? y0 + RASTER_TILE : r->height;
+    float cov[RASTER_TILE * RASTER_TILE];
+    uint32_t stamp[RASTER_TILE * RASTER_TILE] = {}; // group + 1 that `cov` belongs to
+    uint16_t touched[RASTER_TILE * RASTER_TILE];
+    for (size_t k = 0; k < bin->count;) {
+        uint32_t group = r->prims.items[bin->items[k]].group, mark = group + 1;
+        int n = 0;
+        size_t end = k;
+        for (; end < bin->count && r->prims.items[bin->items[end]].group == group; ++end) {
+            RasterPrim * p = r->prims.items + bin->items[end];
+            float reach = p->half + 0.5f; // where coverage reaches 0
+            float lo_x = fminf(p->ax, p->bx), hi_x = fmaxf(p->ax, p->bx);
+            float lo_y = fminf(p->ay, p->by), hi_y = fmaxf(p->ay, p->by);
+            if (p->half == 0) {
+                lo_x = fminf(lo_x, p->cx), hi_x = fmaxf(hi_x, p->cx);
+                lo_y = fminf(lo_y, p->cy), hi_y = fmaxf(hi_y, p->cy);
+            }
+            // pixels whose centre is within reach
+            int py0 = -raster_floor_in(0.5f + reach - lo_y, -y1, -y0);
+            int py1 = raster_floor_in(hi_y + reach - 0.5f, y0 - 1, y1 - 1) + 1;
+            // stroke: the distance to the segment against the half width
+            float dx = p->bx - p->ax, dy = p->by - p->ay;
+            float len2 = dx * dx + dy * dy, inv_len2 = len2 > 0 ? 1 / len2 : 0;
+            float inv = dy != 0 ? dx / dy : 0, edge = p->half + 0.5f, edge2 = edge * edge;
+            for (int y = py0; y < py1; ++y) {
+                // a stroke only reaches a band around where it crosses the row
+                float sx0 = lo_x, sx1 = hi_x;
+                if (p->half > 0 && dy != 0) {
+                    float ya = y + 0.5f - reach, yb = y + 0.5f + reach;
+                    ya = ya > lo_y ? ya : lo_y, yb = yb < hi_y ? yb : hi_y;
+                    if (ya <= yb) {
+                        float xa = p->ax + (ya - p->ay) * inv, xb = p->ax + (yb - p->ay) * inv;
+                        sx0 = xa < xb ? xa : xb, sx1 = xa < xb ? xb : xa;
+                    } else {
+                        sx0 = sx1 = y + 0.5f < lo_y ? (p->ay < p->by ? p->ax : p->bx) : (p->ay < p->by ? p->bx : p->ax);
+                    }
+                }
+                int px0 = -raster_floor_in(0.5f + reach - sx0, -x1, -x0);
+                int px1 = raster_floor_in(sx1 + reach - 0.5f, x0 - 1, x1 - 1) + 1;
+                float ey = y + 0.5f - p->ay;
+                for (int x = px0; x < px1; ++x) {
+                    float c;
+                    if (p->half > 0) {
+                        float ex = x + 0.5f - p->ax;
+                        float t = (ex * dx + ey * dy) * inv_len2;
+                        t = t < 0 ? 0 : t > 1 ? 1 : t;
+                        float qx = ex - t * dx, qy = ey - t * dy, d2 = qx * qx + qy * qy;
+                        if (d2 >= edge2) continue;
+                        c = edge - sqrtf(d2);
+                        c = c > 1 ? 1 : c;
+                    } else {
+                        c = raster_coverage(p, x + 0.5f, y + 0.5f);
+                        if (c <= 0) continue;
+                    }
+                    int at = (y - y0) * RASTER_TILE + x - x0;
+                    if (stamp[at] != mark) {
+                        stamp[at] = mark;
+                        cov[at] = c;
+                        touched[n++] = at;
+                    } else if (p->half == 0) {
+                        cov[at] += c;
+                    } else if (c > cov[at]) {
+                        cov[at] = c;
+                    }
+                }
+            }
+        }
+        uint32_t rgba = r->prims.items[bin->items[k]].rgba;
+        for (int i = 0; i < n; ++i) {
+            int at = touched[i];
+            uint32_t * dst = r->pixels + (y0 + at / RASTER_TILE) * r->width + x0 + at % RASTER_TILE;
+            raster_blend(dst, rgba, cov[at] < 1 ? cov[at] : 1);
+        }
+        k = end;
+    }
+}
+
+static void raster_worker(void * arg) {
+    Raster * r = arg;
+    int tiles = r->tiles_x * r->tiles_y;
+    for (int t; (t = atomic_fetch_add(&r->next_tile, 1)) < tiles;) {
+        if (r->bins[t].count > 0) raster_tile(r, t);
+    }
+}
+
+void raster_end(Raster * r) {
+    atomic_store(&r->next_tile, 0);
+    if (r->prims.count > 0) field_pool_run(raster_worker, r);
+}
+
+// binary ppm, what every image tool reads
+int raster_write_ppm(Raster * r, const char * path, bool y_up) {
+    FILE * f = fopen(path, "wb");
+    if (!f) return 1;
+    fprintf(f, "P6\n%d %d\n255\n", r->width, r->height);
+    unsigned char row[3 * 4096];
+    for (int y = 0; y < r->height; ++y) {
+        uint32_t * src = r->pixels + (y_up ? r->height - 1 - y : y) * r->width;
+        for (int x0 = 0; x0 < r->width; x0 += 4096) {
+            int n = r->width - x0 < 4096 ? r->width - x0 : 4096;
+            for (int x = 0; x < n; ++x) {
+                uint32_t p = src[x0 + x];
+                row[3 * x] = p & 0xFF;
+                row[3 * x + 1] = p >> 8 & 0xFF;
+                row[3 * x + 2] = p >> 16 & 0xFF;
+            }
+            if (fwrite(row, 3, n, f) != (size_t)n) {
+                fclose(f);
+                return 1;
+            }
+        }
+    }
+    return fclose(f) != 0;
+}
+
+void raster_free(Raster * r) {
+    for (int t = 0; t < r->bin_capacity; ++t) da_free(&r->bins[t]);
+    free(r->bins);
+    free(r->pixels);
+    da_free(&r->prims);
+    *r = (Raster) {};
+}
+
+#endif // RASTER_H_
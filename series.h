@@ -0,0 +1,376 @@
+#ifndef SERIES_H_
+#define SERIES_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t, uint64_t
+#include <stdbool.h>
+#include <stdio.h> // FILE, fopen, getline, printf
+#include <stdlib.h> // malloc, free, strtod
+#include <string.h> // memcmp, strlen, strcmp
+#include <math.h> // INFINITY, NAN, isnan
+#include <fcntl.h> // open
+#include <unistd.h> // close
+#include <sys/mman.h> // mmap, munmap, madvise
+#include <sys/stat.h> // fstat, stat
+
+#include "dynarray.h"
+#include "viewport.h"
+#include "curve.h" // Polyline
+
+/*
+  data series: samples (x, y) sorted by x, far more than can be drawn one by one.
+  the samples stay in a read only mapping and only a min / max pyramid over y is built,
+  so a frame costs about two points per pixel column whatever the size of the file.
+  sources, by extension:
+  - `.f32`, `.f64`: raw interleaved x, y pairs in native byte order
+  - `.gsd`: `SeriesHeader` followed by float64 pairs, what text is converted into
+  - anything else is text, one `x, y` (or just `y`) per line, converted once into
+    `<path>.gsd` and reused while that is newer than the text
+ */
+
+#define SERIES_MAGIC "GRAPHSD" // 8 bytes with the terminator
+#define SERIES_FORMAT 1
+#define SERIES_BYTE_ORDER 0x01020304u
+#define SERIES_FANOUT 32 // samples per bucket at level 0, buckets per bucket above
+#define SERIES_MAX_LEVELS 16
+#define SERIES_PATH_MAX 4096 // of the converted copy and its temporary
+
+typedef enum {
+    SERIES_F32,
+    SERIES_F64,
+} SeriesType;
+
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t format;
+    uint64_t count; // pairs after the header
+} SeriesHeader;
+
+typedef struct {
+    double lo, hi; // lo > hi when every y in the bucket is NaN
+} SeriesBucket;
+
+typedef struct {
+    void * base; // mapping
+    size_t size;
+    const char * data; // first pair
+    SeriesType type;
+    size_t count;
+
+    // levels[0][i] covers samples [i * F, (i + 1) * F), levels[k][i] covers levels[k - 1][i * F, (i + 1) * F)
+    SeriesBucket * levels[SERIES_MAX_LEVELS];
+    size_t level_count[SERIES_MAX_LEVELS];
+    int n_levels;
+} Series;
+
+typedef struct {
+    Series * items;
+    size_t count;
+    size_t capacity;
+} SeriesList;
+
+int series_open(const char * path, Series * s); // return 1 on failure
+void series_close(Series * s);
+int series_convert_text(const char * src, const char * dst); // return 1 on failure
+void series_bounds(Series * s, double * x0, double * x1, double * y0, double * y1);
+size_t series_sample(Series * s, Viewport vp, int width, int height, Polyline * out); // return samples covered
+
+static double series_x(const Series * s, size_t i) {
+    return s->type == SERIES_F32 ? ((const float *)s->data)[2 * i] : ((const double *)s->data)[2 * i];
+}
+
+static double series_y(const Series * s, size_t i) {
+    return s->type == SERIES_F32 ? ((const float *)s->data)[2 * i + 1] : ((const double *)s->data)[2 * i + 1];
+}
+
+static bool series_has_suffix(const char * path, const char * suffix) {
+    size_t n = strlen(path), m = strlen(suffix);
+    return n >= m && strcmp(path + n - m, suffix) == 0;
+}
+
+// NaN compares false both ways, so it never moves lo or hi
+#define series_take(lo, hi, v)                  \
+    do {                                        \
+        if ((v) < (lo)) (lo) = (v);             \
+        if ((v) > (hi)) (hi) = (v);             \
+    } while (0)
+
+// level 0 in one pass over the mapping, the type is hoisted out of the loop.
+// return 1 if x goes backwards or is NaN
+#define series_build_base(T)                                            \
+    static int series_build_base_##T(Series * s) {                      \
+        const T * p = (const T *)s->data;                               \
+        SeriesBucket * out = s->levels[0];                              \
+        double prev = -INFINITY;                                        \
+        for (size_t b = 0; b < s->level_count[0]; ++b) {                \
+            size_t end = (b + 1) * SERIES_FANOUT;                       \
+            if (end > s->count) end = s->count;                         \
+            double lo = INFINITY, hi = -INFINITY;                       \
+            for (size_t i = b * SERIES_FANOUT; i < end; ++i) {          \
+                double x = p[2 * i], y = p[2 * i + 1];                  \
+                if (!(x >= prev)) return 1;                             \
+                prev = x;                                               \
+                series_take(lo, hi, y);                                 \
+            }                                                           \
+            out[b] = (SeriesBucket) {lo, hi};                           \
+        }                                                               \
+        return 0;                                                       \
+    }
+
+series_build_base(float)
+series_build_base(double)
+
+// @algo: min / max pyramid. each level summarises SERIES_FANOUT entries of the one below,
+// about 1 / 31 of the samples in total, so a range of any length is covered by its ragged
+// ends at each level plus at most F - 1 buckets per level
+static int series_build(Series * s) {
+    size_t n = (s->count + SERIES_FANOUT - 1) / SERIES_FANOUT;
+    s->n_levels = 0;
+    while (s->n_levels < SERIES_MAX_LEVELS) {
+        s->levels[s->n_levels] = malloc((n ? n : 1) * sizeof(SeriesBucket));
+        if (!s->levels[s->n_levels]) return 1;
+        s->level_count[s->n_levels++] = n;
+        if (n <= 1) break;
+        n = (n + SERIES_FANOUT - 1) / SERIES_FANOUT;
+    }
+    madvise(s->base, s->size, MADV_SEQUENTIAL);
+    int err = s->type == SERIES_F32 ? series_build_base_float(s) : series_build_base_double(s);
+    madvise(s->base, s->size, MADV_RANDOM); // queries only touch the ends of the columns
+    if (err) return 1;
+    for (int k = 1; k < s->n_levels; ++k) {
+        SeriesBucket * below = s->levels[k - 1];
+        for (size_t b = 0; b < s->level_count[k]; ++b) {
+            size_t end = (b + 1) * SERIES_FANOUT;
+            if (end > s->level_count[k - 1]) end = s->level_count[k - 1];
+            double lo = INFINITY, hi = -INFINITY;
+            for (size_t i = b * SERIES_FANOUT; i < end; ++i) {
+                series_take(lo, hi, below[i].lo);
+                series_take(lo, hi, below[i].hi);
+            }
+            s->levels[k][b] = (SeriesBucket) {lo, hi};
+        }
+    }
+    return 0;
+}
+
+static int series_map(const char * path, Series * s) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+    void * base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file
+    if (base == MAP_FAILED) return 1;
+    s->base = base;
+    s->size = st.st_size;
+    return 0;
+}
+
+int series_open(const char * path, Series * s) {
+    *s = (Series) {};
+    char converted[SERIES_PATH_MAX];
+    bool raw32 = series_has_suffix(path, ".f32"), raw64 = series_has_suffix(path, ".f64");
+    if (!raw32 && !raw64 && !series_has_suffix(path, ".gsd")) {
+        // text, convert unless a newer copy is there already
+        int n = snprintf(converted, sizeof(converted), "%s.gsd", path);
+        if (n < 0 || (size_t)n >= sizeof(converted)) return 1; // a cut path would be another file
+        struct stat src, dst;
+        if (stat(path, &src) != 0) return 1;
+        if (stat(converted, &dst) != 0 || dst.st_mtime < src.st_mtime) {
+            if (series_convert_text(path, converted)) return 1;
+        }
+        path = converted;
+    }
+    if (series_map(path, s)) return 1;
+
+    if (raw32 || raw64) {
+        s->type = raw32 ? SERIES_F32 : SERIES_F64;
+        s->data = s->base;
+        s->count = s->size / (raw32 ? 2 * sizeof(float) : 2 * sizeof(double));
+    } else {
+        const SeriesHeader * h = s->base;
+        if (s->size < sizeof(SeriesHeader) || memcmp(h->magic, SERIES_MAGIC, 8) != 0 ||
+            h->byte_order != SERIES_BYTE_ORDER || h->format != SERIES_FORMAT ||
+            h->count > (s->size - sizeof(SeriesHeader)) / (2 * sizeof(double))) {
+            series_close(s);
+            return 1;
+        }
+        s->type = SERIES_F64;
+        s->data = (const char *)s->base + sizeof(SeriesHeader);
+        s->count = h->count;
+    }
+    if (s->count == 0 || series_build(s)) {
+        printf("%s: empty, or not sorted by x\n", path);
+        series_close(s);
+        return 1;
+    }
+    return 0;
+}
+
+void series_close(Series * s) {
+    for (int k = 0; k < s->n_levels; ++k) free(s->levels[k]);
+    if (s->base) munmap(s->base, s->size);
+    *s = (Series) {};
+}
+
+// fields split by commas, semicolons or blanks, return how many of the two were read
+static int series_parse_line(const char * line, double * a, double * b) {
+    char * end;
+    *a = strtod(line, &end);
+    if (end == line) return 0; // headers, comments
+    const char * p = end;
+    while (*p == ',' || *p == ';' || *p == ' ' || *p == '\t') p += 1;
+    *b = strtod(p, &end);
+    return end == p ? 1 : 2;
+}
+
+// lines that do not start with a number are skipped, a single column is y against the line index
+int series_convert_text(const char * src, const char * dst) {
+    FILE * in = fopen(src, "r");
+    if (!in) return 1;
+    char tmp[SERIES_PATH_MAX];
+    int n = snprintf(tmp, sizeof(tmp), "%s.tmp", dst);
+    FILE * out = n < 0 || (size_t)n >= sizeof(tmp) ? NULL : fopen(tmp, "wb");
+    if (!out) {
+        fclose(in);
+        return 1;
+    }
+    SeriesHeader h = {.magic = SERIES_MAGIC, .byte_order = SERIES_BYTE_ORDER, .format = SERIES_FORMAT};
+    fwrite(&h, sizeof(h), 1, out); // count is patched at the end
+
+    // lines of any length, a long one is one sample and not its pieces
+    char * line = NULL;
+    size_t capacity = 0;
+    int err = 0;
+    while (getline(&line, &capacity, in) >= 0) {
+        double pair[2];
+        int fields = series_parse_line(line, pair, pair + 1);
+        if (fields == 0) continue;
+        if (fields == 1) {
+            pair[1] = pair[0];
+            pair[0] = (double)h.count;
+        }
+        if (fwrite(pair, sizeof(pair), 1, out) != 1) {
+            err = 1;
+            break;
+        }
+        h.count += 1;
+    }
+    free(line);
+    fclose(in);
+    if (!err) err = fseek(out, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, out) != 1;
+    err = fclose(out) != 0 || err;
+    if (!err) err = rename(tmp, dst) != 0;
+    if (err) remove(tmp);
+    return err;
+}
+
+void series_bounds(Series * s, double * x0, double * x1, double * y0, double * y1) {
+    SeriesBucket top = s->levels[s->n_levels - 1][0];
+    *x0 = series_x(s, 0);
+    *x1 = series_x(s, s->count - 1);
+    *y0 = top.lo;
+    *y1 = top.hi;
+}
+
+// min and max of y over samples [a, b)
+static SeriesBucket series_range(const Series * s, size_t a, size_t b) {
+    double lo = INFINITY, hi = -INFINITY;
+    // ragged ends below the first level
+    while (a < b && a % SERIES_FANOUT) {
+        double y = series_y(s, a++);
+        series_take(lo, hi, y);
+    }
+    while (a < b && b % SERIES_FANOUT) {
+        double y = series_y(s, --b);
+        series_take(lo, hi, y);
+    }
+    a /= SERIES_FANOUT;
+    b /= SERIES_FANOUT;
+    for (int k = 0; a < b; ++k) {
+        const SeriesBucket * lv = s->levels[k];
+        bool top = k + 1 == s->n_levels;
+        while (a < b && (top || a % SERIES_FANOUT)) {
+            series_take(lo, hi, lv[a].lo);
+            series_take(lo, hi, lv[a].hi);
+            a += 1;
+        }
+        while (a < b && b % SERIES_FANOUT) {
+            b -= 1;
+            series_take(lo, hi, lv[b].lo);
+            series_take(lo, hi, lv[b].hi);
+        }
+        a /= SERIES_FANOUT;
+        b /= SERIES_FANOUT;
+    }
+    return (SeriesBucket) {lo, hi};
+}
+
+// first sample in [a, b) with x >= v, b if none
+static size_t series_lower_bound(const Series * s, size_t a, size_t b, double v) {
+    while (a < b) {
+        size_t m = a + (b - a) / 2;
+        if (series_x(s, m) < v) a = m + 1;
+        else b = m;
+    }
+    return a;
+}
+
+// @algo: one column per two texture pixels. the visible range and every column edge are
+// found by binary search, each column is reduced through the pyramid to its min and max,
+// ordered to continue from the previous point. a view with fewer samples than that is
+// drawn as is, one sample past each edge keeps the line going off screen
+size_t series_sample(Series * s, Viewport vp, int width, int height, Polyline * out) {
+    double step_x = vp.span_x / width;
+    double step_y = vp.span_y / height;
+    double left = dd_to_double(vp.cx) - vp.span_x * 0.5;
+    size_t begin = series_lower_bound(s, 0, s->count, left);
+    size_t end = series_lower_bound(s, begin, s->count, left + vp.span_x);
+    size_t first = begin > 0 ? begin - 1 : 0;
+    size_t last = end < s->count ? end + 1 : s->count;
+    // relative to the centre first, like the graph sampler
+#define series_tx(x) (width * 0.5f + (((x) - vp.cx.hi) - vp.cx.lo) / step_x)
+#define series_ty(y) (height * 0.5f + (((y) - vp.cy.hi) - vp.cy.lo) / step_y)
+
+    out->count = 0;
+    int columns = (width + 1) / 2;
+    if (end - begin <= (size_t)columns * 2) {
+        for (size_t i = first; i < last; ++i) {
+            da_append(out, ((Vector2) {series_tx(series_x(s, i)), series_ty(series_y(s, i))}));
+        }
+        return last - first;
+    }
+
+    if (first < begin) da_append(out, ((Vector2) {series_tx(series_x(s, first)), series_ty(series_y(s, first))}));
+    size_t a = begin;
+    for (int c = 0; c < columns && a < end; ++c) {
+        size_t b = series_lower_bound(s, a, end, left + (2 * c + 2) * step_x);
+        if (b == a) continue;
+        float px = 2 * c + 1;
+        if (b - a == 1) {
+            da_append(out, ((Vector2) {series_tx(series_x(s, a)), series_ty(series_y(s, a))}));
+        } else {
+            SeriesBucket r = series_range(s, a, b);
+            if (r.lo > r.hi) {
+                da_append(out, ((Vector2) {px, NAN})); // a gap in the data
+            } else {
+                float lo = series_ty(r.lo), hi = series_ty(r.hi);
+                float prev = out->count > 0 ? out->items[out->count - 1].y : lo;
+                bool up = fabsf(prev - lo) <= fabsf(prev - hi);
+                da_append(out, ((Vector2) {px, up ? lo : hi}));
+                if (r.hi > r.lo) da_append(out, ((Vector2) {px, up ? hi : lo}));
+            }
+        }
+        a = b;
+    }
+    if (end < last) da_append(out, ((Vector2) {series_tx(series_x(s, end)), series_ty(series_y(s, end))}));
+#undef series_tx
+#undef series_ty
+    return end - begin;
+}
+
+#endif // SERIES_H_
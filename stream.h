@@ -0,0 +1,259 @@
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdbool.h>
+#include <stdalign.h> // alignas
+#include <stdatomic.h>
+#include <string.h> // memchr, memmove
+#include <math.h> // INFINITY, floor, isnan
+#include <time.h> // clock_gettime
+#include <poll.h> // poll
+#include <unistd.h> // read
+#include <pthread.h>
+
+#include "dynarray.h"
+#include "viewport.h"
+#include "curve.h" // Polyline
+#include "series.h" // series_parse_line, series_take
+
+/*
+  live data: a reader thread parses lines from a pipe (`./sensor | grapher --stream`)
+  into a single producer / single consumer ring, the render loop drains it without
+  locking into a bounded history and draws the part in view.
+  lines are `x y` or just `y`, which is stamped with the seconds since the stream began.
+  when the ring is full the reader drops the newest samples and counts them, so a slow
+  frame never stalls the pipe and nothing grows
+ */
+
+#define STREAM_RING (1 << 16) // power of two
+#define STREAM_HISTORY (1 << 20) // samples kept for drawing, 16 MiB
+#define STREAM_READ 65536
+#define STREAM_POLL_MS 100 // how often a quiet reader checks for `stop`
+
+typedef struct {
+    double x, y;
+} StreamSample;
+
+typedef struct {
+    // producer side
+    alignas(64) atomic_size_t head; // next slot to write, only the reader stores it
+    size_t tail_cache; // last tail seen by the reader, saves reading the shared line
+    atomic_size_t dropped;
+    atomic_size_t lines;
+    // consumer side, on its own cache line
+    alignas(64) atomic_size_t tail; // next slot to read, only the render loop stores it
+    StreamSample ring[STREAM_RING];
+
+    int fd;
+    double t0; // monotonic seconds at start
+    atomic_bool stop;
+    atomic_bool eof;
+    pthread_t thread;
+    bool running;
+    atomic_bool asleep; // set by `stream_idle`, taken by the reader with the wake
+    void (*wake)(void); // optional, called from the reader thread
+
+    // render side only
+    StreamSample * history; // ring of STREAM_HISTORY
+    size_t history_count, history_begin;
+    bool follow; // keep the newest sample in view
+} Stream;
+
+int stream_start(Stream * s, int fd); // return 1 on failure
+void stream_stop(Stream * s);
+size_t stream_drain(Stream * s); // return samples moved into the history
+size_t stream_sample(Stream * s, Viewport vp, int width, int height, Polyline * out); // return samples in view
+bool stream_last(Stream * s, StreamSample * out); // newest sample in the history
+bool stream_idle(Stream * s); // return false if samples are waiting, otherwise the next ones call `wake`
+
+static double stream_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// @algo: spsc ring. head and tail only grow, the slot is the index mod STREAM_RING.
+// the release store of head publishes the slot written before it, and the release
+// store of tail hands the slot back; each side reloads the other's index only when
+// its cached copy says the ring is full or empty
+static void stream_push(Stream * s, StreamSample v) {
+    size_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+    if (head - s->tail_cache == STREAM_RING) {
+        s->tail_cache = atomic_load_explicit(&s->tail, memory_order_acquire);
+        if (head - s->tail_cache == STREAM_RING) {
+            atomic_fetch_add_explicit(&s->dropped, 1, memory_order_relaxed);
+            return;
+        }
+    }
+    s->ring[head & (STREAM_RING - 1)] = v;
+    atomic_store_explicit(&s->head, head + 1, memory_order_release);
+}
+
+static void stream_parse(Stream * s, const char * line) {
+    double a, b;
+    int fields = series_parse_line(line, &a, &b);
+    if (fields == 0) return;
+    atomic_fetch_add_explicit(&s->lines, 1, memory_order_relaxed);
+    if (fields == 1) stream_push(s, (StreamSample) {stream_now() - s->t0, a});
+    else stream_push(s, (StreamSample) {a, b});
+}
+
+// poll so that `stop` is seen even when the pipe is quiet
+static void * stream_reader(void * arg) {
+    Stream * s = arg;
+    static char buf[STREAM_READ + 1];
+    size_t len = 0;
+    struct pollfd pfd = {.fd = s->fd, .events = POLLIN};
+    while (!atomic_load_explicit(&s->stop, memory_order_relaxed)) {
+        if (poll(&pfd, 1, STREAM_POLL_MS) <= 0) continue;
+        ssize_t n = read(s->fd, buf + len, STREAM_READ - len);
+        if (n <= 0) break;
+        len += n;
+        buf[len] = 0;
+        size_t head = atomic_load_explicit(&s->head, memory_order_relaxed);
+        char * line = buf, * nl;
+        while ((nl = memchr(line, '\n', buf + len - line))) {
+            *nl = 0;
+            stream_parse(s, line);
+            line = nl + 1;
+        }
+        len = buf + len - line;
+        if (len == STREAM_READ) len = 0; // a line longer than the buffer is junk
+        memmove(buf, line, len);
+        if (atomic_load_explicit(&s->head, memory_order_relaxed) == head) continue;
+        atomic_thread_fence(memory_order_seq_cst); // the head store before the flag load, see `stream_idle`
+        if (atomic_exchange(&s->asleep, false) && s->wake) s->wake();
+    }
+    if (len > 0) {
+        buf[len] = 0;
+        stream_parse(s, buf);
+    }
+    atomic_store(&s->eof, true);
+    if (atomic_exchange(&s->asleep, false) && s->wake) s->wake();
+    return NULL;
+}
+
+int stream_start(Stream * s, int fd) {
+    s->fd = fd;
+    s->t0 = stream_now();
+    s->follow = true;
+    s->history = malloc(STREAM_HISTORY * sizeof(StreamSample));
+    if (!s->history) return 1;
+    if (pthread_create(&s->thread, NULL, stream_reader, s) != 0) {
+        free(s->history);
+        s->history = NULL;
+        return 1;
+    }
+    s->running = true;
+    return 0;
+}
+
+void stream_stop(Stream * s) {
+    if (s->running) {
+        atomic_store(&s->stop, true);
+        pthread_join(s->thread, NULL);
+        s->running = false;
+    }
+    free(s->history);
+    s->history = NULL;
+}
+
+size_t stream_drain(Stream * s) {
+    size_t tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&s->head, memory_order_acquire);
+    for (size_t i = tail; i != head; ++i) {
+        size_t at = (s->history_begin + s->history_count) & (STREAM_HISTORY - 1);
+        s->history[at] = s->ring[i & (STREAM_RING - 1)];
+        if (s->history_count == STREAM_HISTORY) s->history_begin = (s->history_begin + 1) & (STREAM_HISTORY - 1);
+        else s->history_count += 1;
+    }
+    atomic_store_explicit(&s->tail, head, memory_order_release);
+    return head - tail;
+}
+
+// @algo: the render loop announces it is going to sleep, then looks at head once more;
+// the reader publishes head, then takes the flag. both sequentially consistent, so either
+// the loop sees the samples or the reader sees the flag and wakes it, possibly both
+bool stream_idle(Stream * s) {
+    atomic_store(&s->asleep, true);
+    return atomic_load(&s->head) == atomic_load_explicit(&s->tail, memory_order_relaxed);
+}
+
+bool stream_last(Stream * s, StreamSample * out) {
+    if (s->history_count == 0) return false;
+    *out = s->history[(s->history_begin + s->history_count - 1) & (STREAM_HISTORY - 1)];
+    return true;
+}
+
+// like `series_sample` without a pyramid: the history is bounded, so one pass reduces
+// the samples in view to a min and a max per two pixel column
+size_t stream_sample(Stream * s, Viewport vp, int width, int height, Polyline * out) {
+    static SeriesBucket * cols = NULL;
+    static int cols_old = 0;
+    int columns = (width + 1) / 2;
+    if (columns > cols_old) {
+        cols_old = columns;
+        cols = reallocf(cols, columns * sizeof(SeriesBucket));
+        if (!cols) exit(1);
+    }
+    for (int c = 0; c < columns; ++c) cols[c] = (SeriesBucket) {INFINITY, -INFINITY};
+    double step_x = vp.span_x / width;
+    double step_y = vp.span_y / height;
+    double left = dd_to_double(vp.cx) - vp.span_x * 0.5;
+#define stream_tx(x) (width * 0.5f + (((x) - vp.cx.hi) - vp.cx.lo) / step_x)
+#define stream_ty(y) (height * 0.5f + (((y) - vp.cy.hi) - vp.cy.lo) / step_y)
+
+    out->count = 0;
+    // live x only grows, so the samples left of the view are skipped by binary search
+    size_t a = 0, b = s->history_count;
+    while (a < b) {
+        size_t m = a + (b - a) / 2;
+        if (s->history[(s->history_begin + m) & (STREAM_HISTORY - 1)].x < left) a = m + 1;
+        else b = m;
+    }
+    size_t seen = 0, first = a, last = a; // in view, [first, last) in history order
+    bool before = a > 0;
+    for (size_t i = a; i < s->history_count; ++i) {
+        StreamSample v = s->history[(s->history_begin + i) & (STREAM_HISTORY - 1)];
+        double c = floor((v.x - left) / (2 * step_x));
+        if (isnan(c)) continue;
+        if (c < 0) {
+            before = true;
+            first = i + 1;
+            continue;
+        }
+        if (c >= columns) break;
+        series_take(cols[(int)c].lo, cols[(int)c].hi, v.y);
+        seen += 1;
+        last = i + 1;
+    }
+    if (seen == 0) last = first;
+    size_t lo = before ? first - 1 : first, hi = last < s->history_count ? last + 1 : last;
+    if (seen <= (size_t)columns * 2) {
+        for (size_t i = lo; i < hi; ++i) {
+            StreamSample v = s->history[(s->history_begin + i) & (STREAM_HISTORY - 1)];
+            da_append(out, ((Vector2) {stream_tx(v.x), stream_ty(v.y)}));
+        }
+        return seen;
+    }
+    StreamSample v = s->history[(s->history_begin + lo) & (STREAM_HISTORY - 1)];
+    if (before) da_append(out, ((Vector2) {stream_tx(v.x), stream_ty(v.y)}));
+    for (int c = 0; c < columns; ++c) {
+        if (cols[c].lo > cols[c].hi) continue; // empty, or only NaN
+        float a = stream_ty(cols[c].lo), b = stream_ty(cols[c].hi);
+        float prev = out->count > 0 ? out->items[out->count - 1].y : a;
+        bool up = fabsf(prev - a) <= fabsf(prev - b);
+        da_append(out, ((Vector2) {2 * c + 1, up ? a : b}));
+        if (b != a) da_append(out, ((Vector2) {2 * c + 1, up ? b : a}));
+    }
+    if (hi > last) {
+        v = s->history[(s->history_begin + last) & (STREAM_HISTORY - 1)];
+        da_append(out, ((Vector2) {stream_tx(v.x), stream_ty(v.y)}));
+    }
+#undef stream_tx
+#undef stream_ty
+    return seen;
+}
+
+#endif // STREAM_H_
@@ -10,6 +10,8 @@ static const Color c_bg_primary   = WHITE;
 static const Color c_bg_secondary = (Color) {0xE9, 0xEA, 0xEB, 0xFF};
 static const Color c_bg_tertiary = (Color) {0xD0, 0xD2, 0xD3, 0xFF};
 static const Color c_bg_quaternary = (Color) {0x7E, 0x81, 0x81, 0xFF};
+static const Color c_grid_minor = (Color) {0xF3, 0xF4, 0xF4, 0xFF};
+static const Color c_grid_major = (Color) {0xDF, 0xE0, 0xE1, 0xFF};
 static const Color c_bg_highlighted = (Color) {0x65, 0x9A, 0xF9, 0xFF};
 
 static const Color c_fg_primary   = BLACK;
@@ -0,0 +1,366 @@
+#ifndef SURFACE_H_
+#define SURFACE_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // int64_t, uint64_t
+#include <stdbool.h>
+#include <stdlib.h> // malloc, free, exit
+#include <string.h> // memcpy
+#include <math.h> // floor, ceil, log2, sqrt
+
+#include <raylib.h> // Mesh, Vector3
+
+#include "dynarray.h"
+#include "viewport.h"
+#include "compile.h"
+#include "field.h" // g_field_pool, field_ramp, field_now
+
+/*
+  3d surface of `z = f(x, y)` over the view, in a box spanning [-1, 1] in x and z
+  (raylib is y up, graph y runs along -z) and [-SURFACE_HEIGHT, SURFACE_HEIGHT] in y.
+
+  the domain is cut into chunks on a lattice of power of two sizes in graph units, so
+  panning keeps the lattice and only the chunks at the edges are new. each chunk has its
+  own level of detail from its distance to the camera; an edge next to a coarser chunk is
+  pulled onto the coarser lattice, so there are no cracks.
+  a chunk is built once and reused for as long as everything it was built from matches:
+  lattice cell, clipped extent, detail, its neighbours' detail and `Surface.gen`
+  (program revision, span and vertical scale). vertices are relative to the chunk's
+  corner so that a pan only moves it; the caller owns the gpu side
+ */
+
+#define SURFACE_CHUNKS 8 // chunks across the view at least, 16 at most
+#define SURFACE_CHUNK_QUADS 32 // per side at full detail, 33² vertices fit unsigned short indices
+#define SURFACE_LODS 4 // 32, 16, 8, 4 quads per side
+#define SURFACE_LOD_NEAR 1.5 // world units, closer chunks get full detail, each doubling one level less
+#define SURFACE_HEIGHT 0.6
+#define SURFACE_PROBE 33 // samples per side for the vertical range
+#define SURFACE_HEADROOM 1.25 // box height over the probed range
+
+typedef struct {
+    Program * prog;
+    const double * params;
+    Viewport vp;
+    Vector3 camera; // world space
+} SurfaceJob;
+
+typedef struct {
+    int64_t i, j; // lattice cell: [i, i + 1) * 2^ex by [j, j + 1) * 2^ey
+    int lod;
+    int stitch[4]; // detail of the -x, +x, -y, +y neighbours where coarser, own otherwise
+    double x0, x1, y0, y1; // the part in view
+    uint64_t gen;
+
+    Mesh mesh; // cpu arrays from the build, `vaoId` and `vboId` are the caller's
+    bool used; // wanted by the last update
+} SurfaceChunk;
+
+typedef struct {
+    SurfaceChunk * items;
+    size_t count;
+    size_t capacity;
+
+    SurfaceJob job;
+    int ex, ey; // chunk size exponents
+    double zmid, zscale; // value -> world y
+    uint64_t revision; // bumped by `surface_invalidate`
+    uint64_t gen;
+    void (*release)(Mesh * mesh); // for meshes that are rebuilt or dropped, main thread only
+
+    // last update
+    size_t chunks, rebuilt, triangles;
+    double build_ms;
+} Surface;
+
+void surface_update(Surface * s, SurfaceJob job);
+void surface_invalidate(Surface * s); // the program or its parameters changed
+void surface_chunk_offset(Surface * s, SurfaceChunk * c, float * ox, float * oz); // translation to world space
+void surface_mesh_free(Mesh * mesh); // cpu arrays only, for meshes never uploaded
+void surface_free(Surface * s);
+
+static uint64_t surface_hash(uint64_t h, const void * data, size_t n) {
+    const unsigned char * p = data;
+    for (size_t i = 0; i < n; ++i) h = (h ^ p[i]) * 1099511628211ull; // FNV-1a
+    return h;
+}
+
+// probe the view on a coarse grid; the scale only changes when the values leave the box
+// or use less than half of it, and a new one leaves some headroom, so panning over a
+// similar landscape keeps every chunk
+static void surface_probe(Surface * s) {
+    SurfaceJob * j = &s->job;
+    double xs[EVAL_BLOCK], ys[EVAL_BLOCK], out[EVAL_BLOCK];
+    double lo = INFINITY, hi = -INFINITY;
+    double cx = dd_to_double(j->vp.cx), cy = dd_to_double(j->vp.cy);
+    size_t n = 0;
+    for (int k = 0; k < SURFACE_PROBE * SURFACE_PROBE; ++k) {
+        xs[n] = cx + ((double)(k % SURFACE_PROBE) / (SURFACE_PROBE - 1) - 0.5) * j->vp.span_x;
+        ys[n] = cy + ((double)(k / SURFACE_PROBE) / (SURFACE_PROBE - 1) - 0.5) * j->vp.span_y;
+        if (++n < EVAL_BLOCK && k + 1 < SURFACE_PROBE * SURFACE_PROBE) continue;
+        program_eval_field_d(j->prog, j->params, xs, ys, out, n);
+        for (size_t i = 0; i < n; ++i) {
+            if (out[i] < lo) lo = out[i];
+            if (out[i] > hi) hi = out[i];
+        }
+        n = 0;
+    }
+    if (!(lo < hi)) {
+        lo = isfinite(lo) ? lo - 1 : -1;
+        hi = lo + 2;
+    }
+    double top = s->zmid + SURFACE_HEIGHT / s->zscale, bottom = s->zmid - SURFACE_HEIGHT / s->zscale;
+    if (s->zscale > 0 && lo >= bottom && hi <= top && (hi - lo) * 2 >= top - bottom) return;
+    s->zmid = (lo + hi) * 0.5;
+    s->zscale = SURFACE_HEIGHT / ((hi - lo) * 0.5 * SURFACE_HEADROOM);
+}
+
+void surface_chunk_offset(Surface * s, SurfaceChunk * c, float * ox, float * oz) {
+    // the difference is taken in graph units first, like everywhere else
+    *ox = ((c->x0 - s->job.vp.cx.hi) - s->job.vp.cx.lo) / (s->job.vp.span_x * 0.5);
+    *oz = -((c->y0 - s->job.vp.cy.hi) - s->job.vp.cy.lo) / (s->job.vp.span_y * 0.5);
+}
+
+void surface_mesh_free(Mesh * mesh) {
+    free(mesh->vertices);
+    free(mesh->normals);
+    free(mesh->colors);
+    free(mesh->indices);
+    *mesh = (Mesh) {};
+}
+
+// @algo: one chunk: heights on an (n + 3)² grid, the ring outside the chunk only feeds the
+// central differences for the normals, so neighbouring chunks shade alike across the seam.
+// then the stitched edges, vertices with a lambert shade baked into the colour, and two
+// triangles per quad whose corners are all defined
+static void surface_build_chunk(Surface * s, SurfaceChunk * c) {
+    SurfaceJob * j = &s->job;
+    int n = SURFACE_CHUNK_QUADS >> c->lod, w = n + 3;
+    double dx = (c->x1 - c->x0) / n, dy = (c->y1 - c->y0) / n;
+    double h[(SURFACE_CHUNK_QUADS + 3) * (SURFACE_CHUNK_QUADS + 3)];
+#define H(a, b) h[((b) + 1) * w + (a) + 1]
+    double xs[EVAL_BLOCK], ys[EVAL_BLOCK];
+    for (int base = 0; base < w * w; base += EVAL_BLOCK) {
+        int m = w * w - base < EVAL_BLOCK ? w * w - base : EVAL_BLOCK;
+        for (int k = 0; k < m; ++k) {
+            xs[k] = c->x0 + ((base + k) % w - 1) * dx;
+            ys[k] = c->y0 + ((base + k) / w - 1) * dy;
+        }
+        program_eval_field_d(j->prog, j->params, xs, ys, h + base, m);
+    }
+
+    // world units per grid step
+    double wx = dx / (j->vp.span_x * 0.5), wz = dy / (j->vp.span_y * 0.5);
+    int nv = (n + 1) * (n + 1);
+    float * normals = malloc(nv * 3 * sizeof(float));
+    if (!normals) exit(1);
+    for (int b = 0; b <= n; ++b) {
+        for (int a = 0; a <= n; ++a) {
+            // gradient in world space, z runs against graph y
+            double gx = (H(a + 1, b) - H(a - 1, b)) * s->zscale / (2 * wx);
+            double gz = -(H(a, b + 1) - H(a, b - 1)) * s->zscale / (2 * wz);
+            double len = sqrt(gx * gx + 1 + gz * gz);
+            float * nr = normals + 3 * (b * (n + 1) + a);
+            nr[0] = -gx / len;
+            nr[1] = 1 / len;
+            nr[2] = -gz / len;
+            if (!isfinite(len)) nr[0] = 0, nr[1] = 1, nr[2] = 0;
+        }
+    }
+
+    // edges against coarser neighbours follow the coarser lattice
+    for (int e = 0; e < 4; ++e) {
+        int r = 1 << (c->stitch[e] - c->lod);
+        if (r == 1) continue;
+        for (int k = 0; k <= n; ++k) {
+            int q = k % r;
+            if (q == 0) continue;
+            double t = (double)q / r;
+            int k0 = k - q, k1 = k - q + r;
+            if (e < 2) {
+                int a = e == 0 ? 0 : n;
+                H(a, k) = H(a, k0) + (H(a, k1) - H(a, k0)) * t;
+            } else {
+                int b = e == 2 ? 0 : n;
+                H(k, b) = H(k0, b) + (H(k1, b) - H(k0, b)) * t;
+            }
+        }
+    }
+
+    float * vertices = malloc(nv * 3 * sizeof(float));
+    unsigned char * colors = malloc(nv * 4);
+    if (!vertices || !colors) exit(1);
+    static const double light[3] = {0.37, 0.84, 0.40}; // unit, from above and behind the default view
+    for (int b = 0; b <= n; ++b) {
+        for (int a = 0; a <= n; ++a) {
+            int v = b * (n + 1) + a;
+            double y = (H(a, b) - s->zmid) * s->zscale;
+            vertices[3 * v] = a * wx;
+            vertices[3 * v + 1] = isfinite(y) ? y : 0;
+            vertices[3 * v + 2] = -b * wz;
+            float * nr = normals + 3 * v;
+            double lambert = fabs(nr[0] * light[0] + nr[1] * light[1] + nr[2] * light[2]); // both sides
+            uint32_t rgba = field_ramp((y / SURFACE_HEIGHT + 1) * 0.5, 0.35 + 0.65 * lambert);
+            memcpy(colors + 4 * v, &rgba, 4);
+        }
+    }
+
+    unsigned short * indices = malloc(n * n * 6 * sizeof(unsigned short));
+    if (!indices) exit(1);
+    int nt = 0;
+    for (int b = 0; b < n; ++b) {
+        for (int a = 0; a < n; ++a) {
+            if (!isfinite(H(a, b)) || !isfinite(H(a + 1, b)) || !isfinite(H(a, b + 1)) || !isfinite(H(a + 1, b + 1))) continue;
+            unsigned short v = b * (n + 1) + a;
+            // counter clockwise seen from above, with graph y along -z
+            unsigned short quad[6] = {v, v + 1, v + n + 2, v, v + n + 2, v + n + 1};
+            memcpy(indices + 3 * nt, quad, sizeof(quad));
+            nt += 2;
+        }
+    }
+#undef H
+    c->mesh = (Mesh) {
+        .vertexCount = nv,
+        .triangleCount = nt,
+        .vertices = vertices,
+        .normals = normals,
+        .colors = colors,
+        .indices = indices,
+    };
+}
+
+typedef struct {
+    Surface * s;
+    size_t * queue; // indices into `items`
+    size_t count;
+    atomic_size_t next;
+} SurfaceBuild;
+
+static void surface_build_worker(void * arg) {
+    SurfaceBuild * b = arg;
+    for (size_t k; (k = atomic_fetch_add(&b->next, 1)) < b->count;) surface_build_chunk(b->s, b->s->items + b->queue[k]);
+}
+
+// detail from the camera's distance to a point of the chunk
+static int surface_lod(Surface * s, double x, double y) {
+    double wx = ((x - s->job.vp.cx.hi) - s->job.vp.cx.lo) / (s->job.vp.span_x * 0.5);
+    double wz = -((y - s->job.vp.cy.hi) - s->job.vp.cy.lo) / (s->job.vp.span_y * 0.5);
+    Vector3 cam = s->job.camera;
+    double d = sqrt((wx - cam.x) * (wx - cam.x) + cam.y * cam.y + (wz - cam.z) * (wz - cam.z));
+    if (d <= SURFACE_LOD_NEAR) return 0;
+    int lod = (int)log2(d / SURFACE_LOD_NEAR) + 1;
+    return lod < SURFACE_LODS ? lod : SURFACE_LODS - 1;
+}
+
+void surface_invalidate(Surface * s) {
+    s->revision += 1;
+}
+
+// @algo: lay the lattice over the view, pick a detail per cell, then keep every chunk
+// whose key is unchanged; the rest are released and rebuilt in parallel on the field pool
+void surface_update(Surface * s, SurfaceJob job) {
+    double t = field_now();
+    s->job = job;
+    surface_probe(s);
+    uint64_t gen = surface_hash(14695981039346656037ull, &s->revision, sizeof(s->revision));
+    gen = surface_hash(gen, &job.prog, sizeof(job.prog));
+    gen = surface_hash(gen, &job.vp.span_x, sizeof(double));
+    gen = surface_hash(gen, &job.vp.span_y, sizeof(double));
+    gen = surface_hash(gen, &s->zmid, sizeof(double));
+    s->gen = surface_hash(gen, &s->zscale, sizeof(double));
+
+    // SURFACE_CHUNKS to 2 * SURFACE_CHUNKS cells across, plus the partial ones at the edges
+    s->ex = (int)floor(log2(job.vp.span_x / SURFACE_CHUNKS));
+    s->ey = (int)floor(log2(job.vp.span_y / SURFACE_CHUNKS));
+    double sx = ldexp(1, s->ex), sy = ldexp(1, s->ey);
+    double left = dd_to_double(job.vp.cx) - job.vp.span_x * 0.5, right = left + job.vp.span_x;
+    double bottom = dd_to_double(job.vp.cy) - job.vp.span_y * 0.5, top = bottom + job.vp.span_y;
+    int64_t i0 = (int64_t)floor(left / sx), j0 = (int64_t)floor(bottom / sy);
+    int nx = (int)((int64_t)ceil(right / sx) - i0), ny = (int)((int64_t)ceil(top / sy) - j0);
+
+    static int * lods = NULL;
+    static SurfaceChunk * wanted = NULL;
+    static size_t * queue = NULL;
+    static int cells_old = 0;
+    if (nx * ny > cells_old) {
+        cells_old = nx * ny;
+        lods = reallocf(lods, cells_old * sizeof(int));
+        wanted = reallocf(wanted, cells_old * sizeof(SurfaceChunk));
+        queue = reallocf(queue, cells_old * sizeof(size_t));
+        if (!lods || !wanted || !queue) exit(1);
+    }
+    for (int b = 0; b < ny; ++b) {
+        for (int a = 0; a < nx; ++a) {
+            double x = fmax(left, fmin(right, (i0 + a + 0.5) * sx));
+            double y = fmax(bottom, fmin(top, (j0 + b + 0.5) * sy));
+            lods[b * nx + a] = surface_lod(s, x, y);
+        }
+    }
+
+    for (size_t k = 0; k < s->count; ++k) s->items[k].used = false;
+    size_t missing = 0;
+    for (int b = 0; b < ny; ++b) {
+        for (int a = 0; a < nx; ++a) {
+            SurfaceChunk want = {
+                .i = i0 + a, .j = j0 + b,
+                .lod = lods[b * nx + a],
+                .x0 = fmax(left, (i0 + a) * sx), .x1 = fmin(right, (i0 + a + 1) * sx),
+                .y0 = fmax(bottom, (j0 + b) * sy), .y1 = fmin(top, (j0 + b + 1) * sy),
+                .gen = s->gen,
+            };
+            int nb[4] = {
+                a > 0 ? lods[b * nx + a - 1] : 0, a + 1 < nx ? lods[b * nx + a + 1] : 0,
+                b > 0 ? lods[(b - 1) * nx + a] : 0, b + 1 < ny ? lods[(b + 1) * nx + a] : 0,
+            };
+            for (int e = 0; e < 4; ++e) want.stitch[e] = nb[e] > want.lod ? nb[e] : want.lod;
+
+            bool kept = false;
+            for (size_t k = 0; k < s->count && !kept; ++k) {
+                SurfaceChunk * o = s->items + k;
+                kept = !o->used && o->i == want.i && o->j == want.j && o->lod == want.lod && o->gen == want.gen &&
+                    o->x0 == want.x0 && o->x1 == want.x1 && o->y0 == want.y0 && o->y1 == want.y1 &&
+                    memcmp(o->stitch, want.stitch, sizeof(want.stitch)) == 0;
+                if (kept) o->used = true;
+            }
+            if (!kept) wanted[missing++] = want;
+        }
+    }
+
+    // chunks nobody kept are released and their slots refilled
+    for (size_t k = 0; k < s->count; ++k) {
+        SurfaceChunk * c = s->items + k;
+        if (c->used || !c->mesh.vertices) continue;
+        if (s->release) s->release(&c->mesh);
+        else surface_mesh_free(&c->mesh);
+        c->mesh = (Mesh) {};
+    }
+    size_t slot = 0;
+    for (size_t m = 0; m < missing; ++m) {
+        while (slot < s->count && s->items[slot].used) slot += 1;
+        if (slot == s->count) da_append(s, ((SurfaceChunk) {}));
+        s->items[slot] = wanted[m];
+        s->items[slot].used = true;
+        queue[m] = slot;
+    }
+    SurfaceBuild build = {.s = s, .queue = queue, .count = missing};
+    if (missing > 0) field_pool_run(surface_build_worker, &build);
+
+    s->chunks = 0;
+    s->triangles = 0;
+    for (size_t k = 0; k < s->count; ++k) {
+        if (!s->items[k].used) continue;
+        s->chunks += 1;
+        s->triangles += s->items[k].mesh.triangleCount;
+    }
+    s->rebuilt = missing;
+    s->build_ms = (field_now() - t) * 1000;
+}
+
+void surface_free(Surface * s) {
+    for (size_t k = 0; k < s->count; ++k) {
+        if (s->release && s->items[k].mesh.vertices) s->release(&s->items[k].mesh);
+        else surface_mesh_free(&s->items[k].mesh);
+    }
+    da_free(s);
+}
+
+#endif // SURFACE_H_
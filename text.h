@@ -0,0 +1,172 @@
+#ifndef TEXT_H_
+#define TEXT_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint64_t
+#include <string.h> // memcmp, memcpy
+#include <stdlib.h> // malloc, free
+
+#include <raylib.h>
+#include <rlgl.h>
+
+#include "dynarray.h"
+
+/*
+  monospace text on top of the font atlas:
+  a string is laid out once into glyph quads (cached by string and size),
+  then every draw is a single textured quad batch
+ */
+
+typedef struct {
+    Rectangle src; // atlas pixels
+    Rectangle dst; // relative to the run origin
+} GlyphQuad;
+
+typedef struct {
+    uint64_t hash; // 0 for empty slot
+    char * str; // owned copy, for collision check
+    size_t len;
+    int size;
+
+    // quads
+    GlyphQuad * items;
+    size_t count;
+    size_t capacity;
+} TextRun;
+
+typedef struct {
+    size_t batches; // quad submissions this frame
+    size_t glyphs; // quads drawn this frame, one `rlBegin` each before the atlas path
+    size_t layouts; // cache misses this frame
+} TextStats;
+
+#define TEXT_CACHE_CAP 1024 // power of 2
+static TextRun text_cache[TEXT_CACHE_CAP];
+static size_t text_cache_count = 0;
+static uint64_t text_cache_generation = 0; // bumped by every clear, a run kept from before is gone
+TextStats g_text_stats;
+
+int text_char_width(Font font, int size);
+TextRun * text_layout(Font font, const char * str, size_t len, int size);
+void text_draw_run(Font font, TextRun * run, Vector2 pos, Color c);
+void text_draw(Font font, const char * str, size_t len, Vector2 pos, int size, Color c);
+float text_width(Font font, size_t len, int size);
+void text_cache_clear();
+
+// advance of one cell, what `MeasureTextEx(font, " ", size, 0).x` gives
+int text_char_width(Font font, int size) {
+    static int widths[256] = {}; // by size, 0 for not measured
+    if (size <= 0) return 0;
+    if (size < 256 && widths[size]) return widths[size];
+    int index = GetGlyphIndex(font, ' ');
+    float advance = font.glyphs[index].advanceX
+        ? font.glyphs[index].advanceX
+        : font.recs[index].width;
+    int width = advance * size / font.baseSize;
+    if (size < 256) widths[size] = width;
+    return width;
+}
+
+static uint64_t text_hash(const char * str, size_t len, int size) { // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ull ^ (uint64_t)size;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)str[i];
+        h *= 0x100000001b3ull;
+    }
+    return h ? h : 1;
+}
+
+void text_cache_clear() {
+    for (size_t i = 0; i < TEXT_CACHE_CAP; ++i) {
+        free(text_cache[i].str);
+        da_free(&text_cache[i]);
+        text_cache[i] = (TextRun) {};
+    }
+    text_cache_count = 0;
+    text_cache_generation += 1;
+}
+
+TextRun * text_layout(Font font, const char * str, size_t len, int size) {
+    uint64_t h = text_hash(str, len, size);
+    size_t slot = h & (TEXT_CACHE_CAP - 1);
+    // linear probing
+    while (text_cache[slot].hash) {
+        TextRun * run = text_cache + slot;
+        if (run->hash == h && run->size == size && run->len == len &&
+            memcmp(run->str, str, len) == 0) return run;
+        slot = (slot + 1) & (TEXT_CACHE_CAP - 1);
+    }
+    // miss, keep the table at most half full
+    if (text_cache_count >= TEXT_CACHE_CAP / 2) {
+        text_cache_clear();
+        slot = h & (TEXT_CACHE_CAP - 1);
+    }
+    g_text_stats.layouts += 1;
+    text_cache_count += 1;
+
+    TextRun * run = text_cache + slot;
+    run->hash = h;
+    run->str = malloc(len + 1);
+    memcpy(run->str, str, len);
+    run->str[len] = 0;
+    run->len = len;
+    run->size = size;
+
+    // same placement as `DrawTextCodepoint`, on a fixed monospace grid
+    float scale = (float)size / font.baseSize;
+    float pad = font.glyphPadding;
+    int charw = text_char_width(font, size);
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char ch = str[i];
+        if (ch == ' ' || ch == '\t') continue;
+        int index = GetGlyphIndex(font, ch);
+        Rectangle rec = font.recs[index];
+        da_append(run, ((GlyphQuad) {
+            .src = {rec.x - pad, rec.y - pad, rec.width + 2 * pad, rec.height + 2 * pad},
+            .dst = {i * charw + (font.glyphs[index].offsetX - pad) * scale,
+                    (font.glyphs[index].offsetY - pad) * scale,
+                    (rec.width + 2 * pad) * scale,
+                    (rec.height + 2 * pad) * scale},
+        }));
+    }
+    return run;
+}
+
+void text_draw_run(Font font, TextRun * run, Vector2 pos, Color c) {
+    if (run->count == 0) return;
+    g_text_stats.batches += 1;
+    g_text_stats.glyphs += run->count;
+
+    float tw = font.texture.width, th = font.texture.height;
+    rlCheckRenderBatchLimit(4 * run->count);
+    rlSetTexture(font.texture.id);
+    rlBegin(RL_QUADS);
+    rlColor4ub(c.r, c.g, c.b, c.a);
+    for (size_t i = 0; i < run->count; ++i) {
+        Rectangle s = run->items[i].src;
+        Rectangle d = run->items[i].dst;
+        float x = pos.x + d.x, y = pos.y + d.y;
+        // counter-clockwise, as raylib does
+        rlTexCoord2f(s.x / tw, s.y / th);
+        rlVertex2f(x, y);
+        rlTexCoord2f(s.x / tw, (s.y + s.height) / th);
+        rlVertex2f(x, y + d.height);
+        rlTexCoord2f((s.x + s.width) / tw, (s.y + s.height) / th);
+        rlVertex2f(x + d.width, y + d.height);
+        rlTexCoord2f((s.x + s.width) / tw, s.y / th);
+        rlVertex2f(x + d.width, y);
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+void text_draw(Font font, const char * str, size_t len, Vector2 pos, int size, Color c) {
+    if (len == 0) return;
+    text_draw_run(font, text_layout(font, str, len, size), pos, c);
+}
+
+float text_width(Font font, size_t len, int size) {
+    return len * text_char_width(font, size);
+}
+
+#endif // TEXT_H_
@@ -0,0 +1,52 @@
+#ifndef VIEWPORT_H_
+#define VIEWPORT_H_
+
+#include <math.h> // fabs, pow
+
+#include "precision.h"
+
+// visible region of the graph, stored as centre + span so that
+// sample positions are small offsets from a (double-double) centre
+typedef struct {
+    ddouble cx, cy;
+    double span_x, span_y;
+} Viewport;
+
+Viewport viewport_default();
+void viewport_zoom(Viewport * vp, double factor, double ax, double ay); // ax ay: anchor offset from centre, in graph units
+void viewport_pan(Viewport * vp, double dx, double dy);
+ddouble viewport_x_at(Viewport vp, double px, int width);
+Precision viewport_precision(Viewport vp, int width, int height);
+
+Viewport viewport_default() {
+    return (Viewport) {
+        .span_x = 20,
+        .span_y = 10,
+    };
+}
+
+void viewport_zoom(Viewport * vp, double factor, double ax, double ay) {
+    // keep the anchor point fixed on screen
+    vp->cx = dd_add(vp->cx, dd_from(ax * (1 - factor)));
+    vp->cy = dd_add(vp->cy, dd_from(ay * (1 - factor)));
+    vp->span_x *= factor;
+    vp->span_y *= factor;
+}
+
+void viewport_pan(Viewport * vp, double dx, double dy) {
+    vp->cx = dd_add(vp->cx, dd_from(dx));
+    vp->cy = dd_add(vp->cy, dd_from(dy));
+}
+
+// graph x under pixel column `px`, counted from the left edge
+ddouble viewport_x_at(Viewport vp, double px, int width) {
+    return dd_add(vp.cx, dd_from((px - width * 0.5) * (vp.span_x / width)));
+}
+
+Precision viewport_precision(Viewport vp, int width, int height) {
+    Precision px = precision_pick(vp.span_x, fabs(vp.cx.hi) + vp.span_x * 0.5, width);
+    Precision py = precision_pick(vp.span_y, fabs(vp.cy.hi) + vp.span_y * 0.5, height);
+    return px > py ? px : py;
+}
+
+#endif // VIEWPORT_H_
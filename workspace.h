@@ -0,0 +1,329 @@
+#ifndef WORKSPACE_H_
+#define WORKSPACE_H_
+
+#include <stddef.h> // size_t, NULL
+#include <stdint.h> // uint32_t, uint64_t
+#include <stdio.h> // FILE, fopen, fprintf, getline
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcmp, memcpy, strlen
+#include <fcntl.h> // open
+#include <unistd.h> // close
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+
+#include "dynarray.h"
+#include "viewport.h"
+#include "equations.h"
+
+/*
+  binary workspace:
+  [header][equation records][program records][string pool][instruction pool]
+
+  loading maps the file read only, and the programs go into `g_program_cache` with their
+  instructions and text pointing into the mapping, so committing the equations afterwards
+  only hits the cache and nothing is parsed or copied.
+  the header and record layout are fixed per `WS_FORMAT`; the instruction pool is only
+  used when `compiler` matches `WS_COMPILER`, otherwise the text is parsed again.
+  the text form covers everything else (other byte order, hand editing)
+ */
+
+#define WS_MAGIC "GRAPHWS" // 8 bytes with the terminator
+#define WS_FORMAT 1 // header and records
+#define WS_COMPILER 3 // [!] bump whenever OpCode, Instr or the meaning of a program changes
+#define WS_BYTE_ORDER 0x01020304u
+#define WS_TEXT_MAGIC "grapher workspace 1"
+
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t format;
+    uint32_t compiler;
+    uint32_t instr_size;
+    double cx_hi, cx_lo, cy_hi, cy_lo, span_x, span_y;
+    uint64_t n_equations, n_programs;
+    uint64_t equations_offset, programs_offset, strings_offset, instrs_offset;
+    uint64_t size; // of the whole file, catches truncation
+} WsHeader;
+
+typedef struct {
+    uint64_t text, len; // into the string pool, null terminated
+} WsEquation;
+
+typedef struct {
+    uint64_t text, len; // cache key, into the string pool
+    uint64_t instrs, count; // into the instruction pool, in `Instr`s
+    uint64_t deps;
+    uint32_t inputs;
+    uint32_t valid;
+} WsProgram;
+
+typedef struct {
+    void * base;
+    size_t size;
+} WsMapping;
+
+typedef struct {
+    WsMapping * items;
+    size_t count;
+    size_t capacity;
+} WsMappings;
+
+// mapped programs may stay in the cache after their equations are gone,
+// so the mappings live until `workspace_unmap_all`, after `program_cache_free`
+static WsMappings ws_mappings;
+
+int workspace_save(const char * path, Equations * eqs, Viewport vp); // return 1 on failure
+int workspace_load(const char * path, Equations * eqs, Viewport * vp); // binary or text, return 1 on failure
+int workspace_save_text(const char * path, Equations * eqs, Viewport vp);
+int workspace_load_text(const char * path, Equations * eqs, Viewport * vp);
+void workspace_unmap_all();
+
+static uint64_t ws_align8(uint64_t n) {
+    return (n + 7) & ~(uint64_t)7;
+}
+
+// written next to `path` and renamed over it: the file may be the one we are mapping,
+// truncating it in place would pull the pages out from under the cached programs
+static FILE * ws_open_tmp(const char * path, char * tmp, size_t size, const char * mode) {
+    if ((size_t)snprintf(tmp, size, "%s.tmp", path) >= size) return NULL;
+    return fopen(tmp, mode);
+}
+
+static int ws_close_tmp(FILE * f, const char * tmp, const char * path) {
+    int failed = ferror(f);
+    failed = fclose(f) != 0 || failed;
+    if (failed || rename(tmp, path) != 0) {
+        remove(tmp);
+        return 1;
+    }
+    return 0;
+}
+
+int workspace_save(const char * path, Equations * eqs, Viewport vp) {
+    char tmp[4096];
+    FILE * f = ws_open_tmp(path, tmp, sizeof(tmp), "wb");
+    if (!f) return 1;
+
+    // every program an equation holds is referenced, and only equations hold programs
+    ProgramCache * cache = &g_program_cache;
+    size_t n_programs = 0;
+    for (size_t i = 0; i < cache->capacity; ++i) {
+        n_programs += cache->slots[i] && cache->slots[i]->refs > 0;
+    }
+
+    WsHeader h = {
+        .magic = WS_MAGIC,
+        .byte_order = WS_BYTE_ORDER,
+        .format = WS_FORMAT,
+        .compiler = WS_COMPILER,
+        .instr_size = sizeof(Instr),
+        .cx_hi = vp.cx.hi, .cx_lo = vp.cx.lo,
+        .cy_hi = vp.cy.hi, .cy_lo = vp.cy.lo,
+        .span_x = vp.span_x, .span_y = vp.span_y,
+        .n_equations = eqs->order.count,
+        .n_programs = n_programs,
+    };
+    h.equations_offset = sizeof(WsHeader);
+    h.programs_offset = h.equations_offset + h.n_equations * sizeof(WsEquation);
+    h.strings_offset = h.programs_offset + h.n_programs * sizeof(WsProgram);
+
+    // records first, the pools fill up behind them, the header goes in last
+    fwrite(&h, sizeof(h), 1, f);
+    uint64_t strings = 0, instrs = 0;
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        Equation * eq = eqs->items + eqs->order.items[row];
+        WsEquation rec = {strings, eq->text.count};
+        strings += rec.len + 1;
+        fwrite(&rec, sizeof(rec), 1, f);
+    }
+    for (size_t i = 0; i < cache->capacity; ++i) {
+        Program * p = cache->slots[i];
+        if (!p || p->refs == 0) continue;
+        WsProgram rec = {
+            .text = strings, .len = strlen(p->text),
+            .instrs = instrs, .count = p->valid ? p->count : 0,
+            .deps = p->deps,
+            .inputs = p->inputs,
+            .valid = p->valid,
+        };
+        strings += rec.len + 1;
+        instrs += rec.count;
+        fwrite(&rec, sizeof(rec), 1, f);
+    }
+    h.instrs_offset = ws_align8(h.strings_offset + strings);
+    h.size = h.instrs_offset + instrs * sizeof(Instr);
+
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        Equation * eq = eqs->items + eqs->order.items[row];
+        fwrite(string_cstr(&eq->text), eq->text.count + 1, 1, f);
+    }
+    for (size_t i = 0; i < cache->capacity; ++i) {
+        Program * p = cache->slots[i];
+        if (p && p->refs > 0) fwrite(p->text, strlen(p->text) + 1, 1, f);
+    }
+    static const char zeros[8] = {};
+    fwrite(zeros, h.instrs_offset - (h.strings_offset + strings), 1, f);
+    for (size_t i = 0; i < cache->capacity; ++i) {
+        Program * p = cache->slots[i];
+        if (p && p->refs > 0 && p->valid) fwrite(p->items, sizeof(Instr), p->count, f);
+    }
+
+    fseek(f, 0, SEEK_SET);
+    fwrite(&h, sizeof(h), 1, f);
+    return ws_close_tmp(f, tmp, path);
+}
+
+// `count` records of `size` at `offset` fit in the file
+static bool ws_fits(const WsHeader * h, uint64_t offset, uint64_t count, uint64_t size) {
+    return offset <= h->size && count <= (h->size - offset) / size;
+}
+
+// a null terminated string of `len` inside the string pool
+static const char * ws_string(const WsHeader * h, const char * base, uint64_t text, uint64_t len) {
+    uint64_t pool = h->instrs_offset - h->strings_offset;
+    if (text > pool || len >= pool - text) return NULL;
+    const char * s = base + h->strings_offset + text;
+    return s[len] == '\0' ? s : NULL;
+}
+
+static void ws_replace_equations(Equations * eqs) {
+    eqs_free(eqs);
+    *eqs = (Equations) {.selected = -1};
+}
+
+static void ws_add_equation(Equations * eqs, const char * text) {
+    Equation eq = {.editor = string_createFrom(text), .text = string_createEmpty()};
+    equation_commit(&eq);
+    eqs_add(eqs, eq);
+}
+
+int workspace_load(const char * path, Equations * eqs, Viewport * vp) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(WsHeader)) {
+        close(fd);
+        return workspace_load_text(path, eqs, vp);
+    }
+    char * base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file
+    if (base == MAP_FAILED) return 1;
+
+    const WsHeader * h = (const WsHeader *)base;
+    if (memcmp(h->magic, WS_MAGIC, sizeof(h->magic)) != 0 || h->byte_order != WS_BYTE_ORDER) {
+        munmap(base, st.st_size);
+        return workspace_load_text(path, eqs, vp);
+    }
+    if (h->format != WS_FORMAT || h->size != (uint64_t)st.st_size ||
+        !ws_fits(h, h->equations_offset, h->n_equations, sizeof(WsEquation)) ||
+        !ws_fits(h, h->programs_offset, h->n_programs, sizeof(WsProgram)) ||
+        h->strings_offset > h->instrs_offset || h->instrs_offset > h->size ||
+        h->instrs_offset % 8 != 0) {
+        munmap(base, st.st_size);
+        return 1;
+    }
+    da_append(&ws_mappings, ((WsMapping) {base, st.st_size}));
+
+    // programs: straight into the cache when the compiled form is ours
+    const WsProgram * programs = (const WsProgram *)(base + h->programs_offset);
+    const Instr * pool = (const Instr *)(base + h->instrs_offset);
+    uint64_t pool_count = (h->size - h->instrs_offset) / sizeof(Instr);
+    bool trusted = h->compiler == WS_COMPILER && h->instr_size == sizeof(Instr);
+    Program ** adopted = malloc(h->n_programs * sizeof(Program *));
+    size_t n_adopted = 0;
+    for (uint64_t i = 0; trusted && i < h->n_programs; ++i) {
+        const WsProgram * rec = programs + i;
+        const char * text = ws_string(h, base, rec->text, rec->len);
+        if (!text || !rec->valid || rec->instrs > pool_count || rec->count > pool_count - rec->instrs) continue;
+        Program * prog = malloc(sizeof(Program));
+        *prog = (Program) {
+            .items = (Instr *)(pool + rec->instrs),
+            .count = rec->count,
+            .capacity = 0, // not ours to grow or free
+            .deps = rec->deps,
+            .inputs = rec->inputs,
+            .valid = true,
+            .mapped = true,
+            .text = (char *)text,
+        };
+        if (program_verify(prog)) { // parsed again on demand
+            free(prog);
+            continue;
+        }
+        // held until the equations took their references, a rehash drops unreferenced ones
+        adopted[n_adopted++] = program_cache_adopt(prog);
+    }
+
+    const WsEquation * records = (const WsEquation *)(base + h->equations_offset);
+    ws_replace_equations(eqs);
+    for (uint64_t i = 0; i < h->n_equations; ++i) {
+        const char * text = ws_string(h, base, records[i].text, records[i].len);
+        ws_add_equation(eqs, text ? text : "");
+    }
+    for (size_t i = 0; i < n_adopted; ++i) program_release(adopted[i]);
+    free(adopted);
+
+    if (h->span_x > 0 && h->span_y > 0) {
+        *vp = (Viewport) {
+            .cx = {h->cx_hi, h->cx_lo},
+            .cy = {h->cy_hi, h->cy_lo},
+            .span_x = h->span_x,
+            .span_y = h->span_y,
+        };
+    }
+    eqs_rebuild_params(eqs);
+    eqs->selected = eqs_row_id(eqs, 0);
+    return 0;
+}
+
+// one equation per line after a viewport line, doubles in hex so nothing is rounded
+int workspace_save_text(const char * path, Equations * eqs, Viewport vp) {
+    char tmp[4096];
+    FILE * f = ws_open_tmp(path, tmp, sizeof(tmp), "w");
+    if (!f) return 1;
+    fprintf(f, "%s\n", WS_TEXT_MAGIC);
+    fprintf(f, "view %a %a %a %a %a %a\n", vp.cx.hi, vp.cx.lo, vp.cy.hi, vp.cy.lo, vp.span_x, vp.span_y);
+    for (size_t row = 0; row < eqs->order.count; ++row) {
+        Equation * eq = eqs->items + eqs->order.items[row];
+        fprintf(f, "%s\n", string_cstr(&eq->text));
+    }
+    return ws_close_tmp(f, tmp, path);
+}
+
+int workspace_load_text(const char * path, Equations * eqs, Viewport * vp) {
+    FILE * f = fopen(path, "r");
+    if (!f) return 1;
+    // lines of any length, an equation is one line however long it is
+    char * line = NULL;
+    size_t capacity = 0;
+    if (getline(&line, &capacity, f) < 0 || strncmp(line, WS_TEXT_MAGIC, strlen(WS_TEXT_MAGIC)) != 0) {
+        free(line);
+        fclose(f);
+        return 1;
+    }
+    ws_replace_equations(eqs);
+    Viewport v;
+    while (getline(&line, &capacity, f) >= 0) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (sscanf(line, "view %la %la %la %la %la %la",
+                   &v.cx.hi, &v.cx.lo, &v.cy.hi, &v.cy.lo, &v.span_x, &v.span_y) == 6) {
+            if (v.span_x > 0 && v.span_y > 0) *vp = v;
+            continue;
+        }
+        ws_add_equation(eqs, line);
+    }
+    free(line);
+    fclose(f);
+    eqs_rebuild_params(eqs);
+    eqs->selected = eqs_row_id(eqs, 0);
+    return 0;
+}
+
+void workspace_unmap_all() {
+    for (size_t i = 0; i < ws_mappings.count; ++i) {
+        munmap(ws_mappings.items[i].base, ws_mappings.items[i].size);
+    }
+    da_free(&ws_mappings);
+}
+
+#endif // WORKSPACE_H_